@@ -1,7 +1,7 @@
 /**
  * @file bitmap.c
  * @author SuperIlu (superilu@yahoo.com)
- * @brief BMP loading/saving/rendering incl. font rendering
+ * @brief BMP/PCX loading/saving, GIF loading and rendering incl. font rendering
  *
  * @copyright SuperIlu
  */
@@ -11,6 +11,8 @@
 
 #include "error.h"
 #include "bitmap.h"
+#include "modex.h"
+#include "span.h"
 
 /* ======================================================================
 ** defines
@@ -18,14 +20,58 @@
 #define BMP_INFO_HEADER_SIZE 40  //!< size of the info header
 #define BMP_NUM_PLANES 1         //!< single plane only
 #define BMP_BPP 8                //!< eight bit/pixel only
-#define BMP_COMPRESSION_NONE 0   //!< uncompressed images only
+#define BMP_COMPRESSION_NONE 0   //!< uncompressed images
 #define BMP_COLORS 256           //!< palette must have 256 entries
 #define BMP_NUM_CHARS 95         //!< number of characters rendered by font_convert.py (SPACE..TILDE)
 #define BMP_SCANLINE_PADDING 4   //!< scanlines in BMP files are a multiple of 4
+#define BMP_FLIP_CHUNK 64        //!< scanlines are swapped in pieces of this size
+#define BMP_COMPRESSION_RLE8 1   //!< run length encoded 8bit images
+#define BMP_BUFFER_SIZE 4096     //!< size of the file buffer
+
+#define BMP_RLE_ESCAPE 0   //!< RLE8: a count of 0 starts an escape
+#define BMP_RLE_EOL 0      //!< RLE8 escape: end of line
+#define BMP_RLE_EOB 1      //!< RLE8 escape: end of bitmap
+#define BMP_RLE_DELTA 2    //!< RLE8 escape: move right and up by the next two bytes
+#define BMP_RLE_MAX 255    //!< max number of pixels in a run
+#define BMP_RLE_MIN_RUN 3  //!< shorter runs are stored in absolute mode, which needs at least 3 pixels
+
+#define PCX_MANUFACTURER 0x0A    //!< first byte of every PCX file
+#define PCX_VERSION 5            //!< version with 256 color palette
+#define PCX_ENCODING_RLE 1       //!< the only PCX encoding
+#define PCX_PALETTE_COLOR 1      //!< palette_info: color image
+#define PCX_RUN 0xC0             //!< bytes with both top bits set are run counts
+#define PCX_MAX_RUN 0x3F         //!< max pixels in a run
+#define PCX_PALETTE_MARKER 0x0C  //!< starts the 256 color palette at the end of the file
+#define PCX_PALETTE_SIZE 769     //!< marker and 256 RGB colors
+
+#define GIF_SIGNATURE "GIF8"      //!< start of GIF87a and GIF89a files
+#define GIF_HEADER_SIZE 13        //!< signature, version and logical screen descriptor
+#define GIF_FLAGS 10              //!< offset of the flags in the header
+#define GIF_BACKGROUND 11         //!< offset of the background color in the header
+#define GIF_DESCRIPTOR_SIZE 9     //!< image descriptor without the separator
+#define GIF_CONTROL_SIZE 4        //!< size of the graphic control extension block
+#define GIF_EXTENSION 0x21        //!< starts an extension
+#define GIF_GRAPHIC_CONTROL 0xF9  //!< extension label of the graphic control extension
+#define GIF_IMAGE 0x2C            //!< starts an image descriptor
+#define GIF_TRAILER 0x3B          //!< end of the GIF file
+#define GIF_COLOR_TABLE 0x80      //!< flags: a color table follows
+#define GIF_INTERLACE 0x40        //!< flags: the image rows are interlaced
+#define GIF_TABLE_SIZE 0x07       //!< flags: the color table has 2 << n entries
+#define GIF_TRANSPARENT 0x01      //!< graphic control flags: the transparent color is valid
+#define GIF_DISPOSE_MASK 0x07     //!< graphic control flags: disposal method (shifted)
+#define GIF_DISPOSE_NONE 0        //!< leave the frame on the canvas (no disposal specified)
+#define GIF_DISPOSE_BACKGROUND 2  //!< clear the frame area to the background color
+#define GIF_DISPOSE_PREVIOUS 3    //!< restore the canvas under the frame
+#define GIF_PASSES 4              //!< number of passes of interlaced images
+#define GIF_MAX_BITS 12           //!< max LZW code size
+#define GIF_NO_CODE 0xFFFF        //!< no previous LZW code after a clear code
+#define GIF_MAX_PIXELS 0xFFF0     //!< the canvas must fit into a single allocation
 
 /* ======================================================================
 ** typedefs
 ** ====================================================================== */
+#pragma pack(__push, 1)  // make sure no padding is used
+
 //! BMP image header (http://www.ece.ualberta.ca/~elliott/ee552/studentAppNotes/2003_w/misc/bmp_file_format/bmp_file_format.htm)
 typedef struct __bmp_header {
     uint8_t B;
@@ -34,123 +80,1290 @@ typedef struct __bmp_header {
     uint32_t reserved01;
     uint32_t data_offset;
 
-    uint32_t info_header_size;
-    uint32_t width;
-    uint32_t height;
-    uint16_t planes;
-    uint16_t bit_per_pixel;
-    uint32_t compression;
-    uint32_t image_size;
-    uint32_t x_pixels_per_m;
-    uint32_t y_pixels_per_m;
-    uint32_t num_colors;
-    uint32_t important_colors;
-} bmp_header_t;
+    uint32_t info_header_size;
+    uint32_t width;
+    uint32_t height;
+    uint16_t planes;
+    uint16_t bit_per_pixel;
+    uint32_t compression;
+    uint32_t image_size;
+    uint32_t x_pixels_per_m;
+    uint32_t y_pixels_per_m;
+    uint32_t num_colors;
+    uint32_t important_colors;
+} bmp_header_t;
+
+//! BMP image color table entry (order of the colors is wrong in the HTML mentioned above!)
+typedef struct __bmp_color {
+    uint8_t blue;
+    uint8_t green;
+    uint8_t red;
+    uint8_t reserved02;
+} bmp_color_t;
+
+//! PCX image header
+typedef struct __pcx_header {
+    uint8_t manufacturer;
+    uint8_t version;
+    uint8_t encoding;
+    uint8_t bits_per_pixel;
+    uint16_t xmin;
+    uint16_t ymin;
+    uint16_t xmax;
+    uint16_t ymax;
+    uint16_t hdpi;
+    uint16_t vdpi;
+    uint8_t colormap[48];
+    uint8_t reserved;
+    uint8_t planes;
+    uint16_t bytes_per_line;
+    uint16_t palette_info;
+    uint16_t hscreen;
+    uint16_t vscreen;
+    uint8_t filler[54];
+} pcx_header_t;
+
+#pragma pack(__pop)  // end pack pragms
+
+/* ======================================================================
+** local variables
+** ====================================================================== */
+static uint8_t bitmap_buf[BMP_BUFFER_SIZE];  //!< BMP files are assembled here when saving and streamed through it when decoding
+static uint16_t bitmap_len;                  //!< number of bytes in bitmap_buf
+static uint16_t bitmap_pos;                  //!< read position in bitmap_buf
+
+/**
+ * @brief convert BMP color table entries to palette colors.
+ *
+ * @param dst the palette.
+ * @param src the BMP colors.
+ * @param n number of colors.
+ */
+static void bitmap_convert_colors(palette_color_t *dst, bmp_color_t *src, uint16_t n) {
+    for (; n; n--, dst++, src++) {
+        dst->red = src->red;
+        dst->green = src->green;
+        dst->blue = src->blue;
+    }
+}
+
+/**
+ * @brief read the palette that follows the header. The colors are read into the pixel memory of the bitmap with a
+ * single read (several for bitmaps with less than 1024 pixels) and converted from there, the pixels are cleared afterwards.
+ *
+ * @param bm the bitmap, num_colors must be set.
+ * @param f the file.
+ *
+ * @return true if the palette was read, else false.
+ */
+static bool bitmap_read_palette(bitmap_t *bm, FILE *f) {
+    bmp_color_t single, *colors;
+    uint16_t i, n, chunk;
+
+    chunk = (bm->width * bm->height) / sizeof(bmp_color_t);
+    colors = (bmp_color_t *)bm->data;
+    if (!chunk) {
+        chunk = 1;
+        colors = &single;
+    }
+
+    for (i = 0; i < bm->num_colors; i += n) {
+        n = bm->num_colors - i;
+        if (n > chunk) {
+            n = chunk;
+        }
+        if (fread(colors, sizeof(bmp_color_t), n, f) != n) {
+            return false;
+        }
+        bitmap_convert_colors(&bm->palette[i], colors, n);
+    }
+
+    // RLE8 images may not set every pixel
+    if (colors != &single) {
+        memset(bm->data, 0x00, (chunk < bm->num_colors ? chunk : bm->num_colors) * sizeof(bmp_color_t));
+    }
+    return true;
+}
+
+/**
+ * @brief read the pixel array. As many padded scanlines as fit into the unused end of the pixel memory are read at once
+ * and packed to the front, a scanline without padding needs a single read for the whole image. Afterwards the bottom-up
+ * image is flipped.
+ *
+ * @param bm the bitmap.
+ * @param f the file, positioned at the first pixel.
+ *
+ * @return true if the data was read, else false.
+ */
+static bool bitmap_read_data(bitmap_t *bm, FILE *f) {
+    uint16_t size, padding, stride, row, rows, i, len;
+    uint8_t *dst, *top, *bottom, tmp[BMP_FLIP_CHUNK];
+
+    size = bm->width * bm->height;
+    padding = (BMP_SCANLINE_PADDING - (bm->width % BMP_SCANLINE_PADDING)) % BMP_SCANLINE_PADDING;
+    stride = bm->width + padding;
+
+    for (row = 0; row < bm->height; row += rows) {
+        dst = &bm->data[row * bm->width];
+        rows = (size - row * bm->width) / stride;
+        if (rows) {
+            len = rows * stride;
+            if (row + rows == bm->height) {
+                len -= padding;  // the padding of the last scanline may be missing
+            }
+        } else {
+            // less than a padded scanline is left
+            rows = 1;
+            len = bm->width;
+        }
+        if (fread(dst, len, 1, f) != 1) {
+            return false;
+        }
+        if ((len == bm->width) && padding && (row + 1 < bm->height) && fseek(f, padding, SEEK_CUR)) {
+            return false;
+        }
+
+        // remove the padding
+        for (i = 1; padding && (i < rows); i++) {
+            memmove(&dst[i * bm->width], &dst[i * stride], bm->width);
+        }
+    }
+
+    // BMP scanlines are stored bottom-up
+    top = bm->data;
+    bottom = &bm->data[size - bm->width];
+    for (; top < bottom; top += bm->width, bottom -= bm->width) {
+        for (i = 0; i < bm->width; i += len) {
+            len = bm->width - i;
+            if (len > sizeof(tmp)) {
+                len = sizeof(tmp);
+            }
+            memcpy(tmp, &top[i], len);
+            memcpy(&top[i], &bottom[i], len);
+            memcpy(&bottom[i], tmp, len);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief write the content of the file buffer to disk.
+ *
+ * @param f the file.
+ *
+ * @return true if the data was written, else false.
+ */
+static bool bitmap_flush(FILE *f) {
+    bool ok = !bitmap_len || (fwrite(bitmap_buf, bitmap_len, 1, f) == 1);
+    bitmap_len = 0;
+    return ok;
+}
+
+/**
+ * @brief append data to the file buffer, it is written to disk whenever it is full.
+ *
+ * @param f the file.
+ * @param data the bytes or NULL for zeros.
+ * @param len number of bytes.
+ *
+ * @return true if the data could be written, else false.
+ */
+static bool bitmap_put(FILE *f, const uint8_t *data, uint16_t len) {
+    uint16_t n;
+
+    while (len) {
+        if ((bitmap_len == BMP_BUFFER_SIZE) && !bitmap_flush(f)) {
+            return false;
+        }
+        n = BMP_BUFFER_SIZE - bitmap_len;
+        if (n > len) {
+            n = len;
+        }
+        if (data) {
+            memcpy(&bitmap_buf[bitmap_len], data, n);
+            data += n;
+        } else {
+            memset(&bitmap_buf[bitmap_len], 0x00, n);
+        }
+        bitmap_len += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief append an RLE8 code pair to the file buffer.
+ *
+ * @param f the file.
+ * @param first count or 0 for an escape.
+ * @param second color or escape code.
+ *
+ * @return true if the data could be written, else false.
+ */
+static bool bitmap_put_code(FILE *f, uint8_t first, uint8_t second) {
+    uint8_t code[2];
+
+    code[0] = first;
+    code[1] = second;
+    return bitmap_put(f, code, sizeof(code));
+}
+
+/**
+ * @brief append a RLE8 compressed scanline to the file buffer, without the end of line code.
+ * Runs of three or more equal pixels are encoded, other pixels are stored in absolute mode.
+ *
+ * @param f the file.
+ * @param row the pixels.
+ * @param width number of pixels.
+ *
+ * @return true if the data could be written, else false.
+ */
+static bool bitmap_put_rle(FILE *f, const uint8_t *row, uint16_t width) {
+    uint16_t x, run, n;
+    bool ok = true;
+
+    for (x = 0; ok && (x < width); x += n) {
+        for (run = 1; (x + run < width) && (run < BMP_RLE_MAX) && (row[x + run] == row[x]); run++) {
+        }
+
+        n = 0;
+        if (run < BMP_RLE_MIN_RUN) {
+            // absolute mode up to the next run, it needs at least 3 pixels
+            for (; (x + n < width) && (n < BMP_RLE_MAX); n++) {
+                if ((x + n + 2 < width) && (row[x + n] == row[x + n + 1]) && (row[x + n] == row[x + n + 2])) {
+                    break;
+                }
+            }
+        }
+        if (n >= BMP_RLE_MIN_RUN) {
+            ok = bitmap_put_code(f, 0, n) && bitmap_put(f, &row[x], n) && bitmap_put(f, NULL, n & 1);  // padded to 16bit
+        } else {
+            n = run;
+            ok = bitmap_put_code(f, n, row[x]);
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief write an area of a surface as BMP file. Header, palette and scanlines are assembled in the file buffer,
+ * which is written to disk whenever it is full.
+ *
+ * @param fname file name
+ * @param s the surface, scanlines of planar surfaces are collected pixel by pixel.
+ * @param x start x
+ * @param y start y
+ * @param width width of the image, the area must be within the surface.
+ * @param height height of the image
+ * @param palette 256 colors or NULL to use the VGA palette.
+ * @param rle true to compress the image with RLE8.
+ *
+ * @return true if the image could be saved, else false.
+ */
+static bool bitmap_write(const char *fname, surface_t *s, uint16_t x, uint16_t y, uint16_t width, uint16_t height, palette_color_t *palette, bool rle) {
+    uint16_t i, row, padding;
+    FILE *f;
+    bool ok = true;
+    bmp_header_t header;
+    bmp_color_t color;
+    palette_color_t vga;
+    uint8_t *src, *line = NULL;
+
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        line = malloc(width);
+        if (!line) {
+            ERR_NOMEM();
+            return false;
+        }
+    }
+
+    f = fopen(fname, "wb");
+    if (!f) {
+        free(line);
+        ERR_CREAT();
+        return false;
+    }
+
+    // create header, the sizes of compressed images are set when the data was written
+    padding = (BMP_SCANLINE_PADDING - (width % BMP_SCANLINE_PADDING)) % BMP_SCANLINE_PADDING;
+
+    header.B = 'B';
+    header.M = 'M';
+    header.data_offset = sizeof(bmp_header_t) + BMP_COLORS * sizeof(bmp_color_t);
+    header.image_size = (uint32_t)(width + padding) * height;
+    header.file_size = header.data_offset + header.image_size;
+    header.reserved01 = 0x00;
+    header.info_header_size = BMP_INFO_HEADER_SIZE;
+    header.width = width;
+    header.height = height;
+    header.planes = BMP_NUM_PLANES;
+    header.bit_per_pixel = BMP_BPP;
+    header.compression = rle ? BMP_COMPRESSION_RLE8 : BMP_COMPRESSION_NONE;
+    header.x_pixels_per_m = 0xB12;  // (0xB12 = 72 dpi)
+    header.y_pixels_per_m = 0xB12;  // (0xB12 = 72 dpi)
+    header.num_colors = BMP_COLORS;
+    header.important_colors = 0;
+    bitmap_len = 0;
+    ok = bitmap_put(f, (uint8_t *)&header, sizeof(bmp_header_t));
+
+    // create color table
+    color.reserved02 = 0x00;
+    for (i = 0; ok && (i < BMP_COLORS); i++) {
+        if (palette) {
+            vga = palette[i];
+        } else {
+            vga_get_color(i, &vga);
+        }
+        color.red = vga.red;
+        color.green = vga.green;
+        color.blue = vga.blue;
+        ok = bitmap_put(f, (uint8_t *)&color, sizeof(bmp_color_t));
+    }
+
+    // add scanlines bottom-up, padded to multiples of 4 or compressed
+    for (row = height; ok && row; row--) {
+        if (line) {
+            for (i = 0; i < width; i++) {
+                line[i] = vga_surface_get_pixel(s, x + i, y + row - 1);
+            }
+            src = line;
+        } else {
+            src = &s->data[(y + row - 1) * s->stride + x];
+        }
+
+        if (rle) {
+            ok = bitmap_put_rle(f, src, width) && bitmap_put_code(f, BMP_RLE_ESCAPE, row > 1 ? BMP_RLE_EOL : BMP_RLE_EOB);
+        } else {
+            ok = bitmap_put(f, src, width) && bitmap_put(f, NULL, padding);
+        }
+    }
+    ok = ok && bitmap_flush(f);
+
+    // write the final sizes
+    if (ok && rle) {
+        header.file_size = ftell(f);
+        header.image_size = header.file_size - header.data_offset;
+        ok = !fseek(f, 0, SEEK_SET) && (fwrite(&header, sizeof(bmp_header_t), 1, f) == 1);
+    }
+
+    free(line);
+    if (fclose(f) || !ok) {
+        ERR_IOERR();
+        remove(fname);
+        return false;
+    }
+
+    // all done and ok
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief make sure the next bytes of a file are in the file buffer.
+ *
+ * @param f the file.
+ * @param n number of bytes needed, at most BMP_BUFFER_SIZE.
+ *
+ * @return true if the bytes are available, false at the end of the file.
+ */
+static bool bitmap_fill(FILE *f, uint16_t n) {
+    if (bitmap_len - bitmap_pos >= n) {
+        return true;
+    }
+    bitmap_len -= bitmap_pos;
+    memmove(bitmap_buf, &bitmap_buf[bitmap_pos], bitmap_len);
+    bitmap_pos = 0;
+    bitmap_len += fread(&bitmap_buf[bitmap_len], 1, BMP_BUFFER_SIZE - bitmap_len, f);
+    return bitmap_len >= n;
+}
+
+/**
+ * @brief decode RLE8 compressed pixels onto a surface while the file is read through the file buffer.
+ * Pixels outside of the image are ignored, pixels skipped by delta and end of line codes are not changed.
+ *
+ * @param f the file, positioned at the first pixel.
+ * @param s the surface, the area must be within it.
+ * @param x x position of the image on the surface.
+ * @param y y position of the image on the surface.
+ * @param width width of the image.
+ * @param height height of the image.
+ *
+ * @return true if the image was decoded, false if the data is truncated.
+ */
+static bool bitmap_read_rle(FILE *f, surface_t *s, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    uint16_t px = 0, line = 0, n, len;
+    uint8_t code;
+
+    bitmap_len = bitmap_pos = 0;
+    for (;;) {
+        if (!bitmap_fill(f, 2)) {
+            return line + 1 >= height;  // some encoders omit the end of bitmap
+        }
+        n = bitmap_buf[bitmap_pos++];
+        code = bitmap_buf[bitmap_pos++];
+
+        // visible part of the run
+        len = (px < width) ? width - px : 0;
+        if (line >= height) {
+            len = 0;
+        }
+
+        if (n) {
+            // encoded mode
+            if (len > n) {
+                len = n;
+            }
+            if (len) {
+                vga_surface_fill_span(s, y + height - 1 - line, x + px, x + px + len - 1, code);
+            }
+            px += n;
+        } else if (code == BMP_RLE_EOL) {
+            px = 0;
+            line++;
+        } else if (code == BMP_RLE_EOB) {
+            return true;
+        } else if (code == BMP_RLE_DELTA) {
+            if (!bitmap_fill(f, 2)) {
+                return false;
+            }
+            px += bitmap_buf[bitmap_pos++];
+            line += bitmap_buf[bitmap_pos++];
+        } else {
+            // absolute mode, padded to 16bit
+            if (!bitmap_fill(f, code + (code & 1))) {
+                return false;
+            }
+            if (len > code) {
+                len = code;
+            }
+            if (len) {
+                vga_surface_put_span(s, x + px, y + height - 1 - line, &bitmap_buf[bitmap_pos], len);
+            }
+            bitmap_pos += code + (code & 1);
+            px += code;
+        }
+    }
+}
+
+/**
+ * @brief open a PCX file and check its header.
+ *
+ * @param fname file name
+ * @param header the header is read into this.
+ *
+ * @return the file positioned after the header or NULL if it could not be read or is no 8bit, single plane PCX.
+ */
+static FILE *bitmap_open_pcx(char *fname, pcx_header_t *header) {
+    FILE *f;
+
+    f = fopen(fname, "rb");
+    if (!f) {
+        ERR_NOENT();
+        return NULL;
+    }
+
+    // read header
+    if (fread(header, sizeof(pcx_header_t), 1, f) != 1) {
+        ERR_IOERR();
+        fclose(f);
+        return NULL;
+    }
+
+    // check format
+    if ((header->manufacturer != PCX_MANUFACTURER) || (header->encoding != PCX_ENCODING_RLE) || (header->bits_per_pixel != BMP_BPP) ||
+        (header->planes != BMP_NUM_PLANES) || (header->xmax < header->xmin) || (header->ymax < header->ymin) ||
+        (header->bytes_per_line < header->xmax - header->xmin + 1)) {
+        ERR_PARAM();
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+/**
+ * @brief read the 256 color palette from the end of a PCX file. The file position is changed.
+ *
+ * @param f the file.
+ * @param palette VGA_MAX_COLORS entries for the colors.
+ *
+ * @return true if the palette was read, false if the file has none.
+ */
+static bool bitmap_read_pcx_palette(FILE *f, palette_color_t *palette) {
+    uint16_t i;
+    uint8_t *src;
+
+    bitmap_len = bitmap_pos = 0;
+    if (fseek(f, -(long)PCX_PALETTE_SIZE, SEEK_END) || !bitmap_fill(f, PCX_PALETTE_SIZE) || (bitmap_buf[0] != PCX_PALETTE_MARKER)) {
+        return false;
+    }
+    src = &bitmap_buf[1];
+    for (i = 0; i < VGA_MAX_COLORS; i++) {
+        palette[i].red = *src++;
+        palette[i].green = *src++;
+        palette[i].blue = *src++;
+    }
+    return true;
+}
+
+/**
+ * @brief decode the PCX scanlines onto a surface while the file is read through the file buffer. Linear surfaces
+ * are written directly, scanlines of planar surfaces are collected first.
+ *
+ * @param f the file, positioned at the first pixel.
+ * @param s the surface, the area must be within it.
+ * @param x x position of the image on the surface.
+ * @param y y position of the image on the surface.
+ * @param width width of the image.
+ * @param height height of the image.
+ * @param bytes_per_line number of encoded bytes per scanline, >= width.
+ *
+ * @return true if the image was decoded, false if the data is truncated or out of memory.
+ */
+static bool bitmap_read_pcx(FILE *f, surface_t *s, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t bytes_per_line) {
+    uint16_t row, px, len, n = 0;
+    uint8_t *line = NULL, *dst, c = 0;
+    bool ok = true;
+
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        line = malloc(width);
+        if (!line) {
+            return false;
+        }
+    }
+
+    bitmap_len = bitmap_pos = 0;
+    for (row = 0; ok && (row < height); row++) {
+        dst = line ? line : &s->data[(y + row) * s->stride + x];
+        for (px = 0; px < bytes_per_line; px += len) {
+            // runs may continue on the next scanline
+            if (!n) {
+                if ((bitmap_len - bitmap_pos < 2) && !bitmap_fill(f, 2) && (bitmap_len == bitmap_pos)) {
+                    ok = false;
+                    break;
+                }
+                c = bitmap_buf[bitmap_pos++];
+                n = 1;
+                if ((c & PCX_RUN) == PCX_RUN) {
+                    if (bitmap_len == bitmap_pos) {
+                        ok = false;
+                        break;
+                    }
+                    n = c & PCX_MAX_RUN;
+                    c = bitmap_buf[bitmap_pos++];
+                    if (!n) {
+                        len = 0;  // an empty run does not advance
+                        continue;
+                    }
+                }
+            }
+
+            len = bytes_per_line - px;
+            if (len > n) {
+                len = n;
+            }
+            n -= len;
+            if (px + len <= width) {
+                if (len == 1) {
+                    dst[px] = c;
+                } else {
+                    memset(&dst[px], c, len);
+                }
+            } else if (px < width) {
+                memset(&dst[px], c, width - px);  // the padding is dropped
+            }
+        }
+        if (ok && line) {
+            vga_surface_put_span(s, x, y + row, line, width);
+        }
+    }
+
+    free(line);
+    return ok;
+}
+
+/**
+ * @brief append a PCX run to the file buffer.
+ *
+ * @param f the file.
+ * @param c the color.
+ * @param n number of pixels, at most PCX_MAX_RUN.
+ *
+ * @return true if the data could be written, else false.
+ */
+static bool bitmap_put_pcx_run(FILE *f, uint8_t c, uint8_t n) {
+    uint8_t code[2];
+
+    // single pixels that look like a run count must be stored as run
+    if ((n == 1) && ((c & PCX_RUN) != PCX_RUN)) {
+        return bitmap_put(f, &c, 1);
+    }
+    code[0] = PCX_RUN | n;
+    code[1] = c;
+    return bitmap_put(f, code, sizeof(code));
+}
+
+/**
+ * @brief get the next byte of a GIF file through its file buffer.
+ *
+ * @param g the GIF.
+ *
+ * @return the byte or -1 at the end of the file.
+ */
+static int16_t bitmap_gif_get(bitmap_gif_t *g) {
+    if (g->pos == g->len) {
+        g->pos = 0;
+        g->len = fread(g->buf, 1, GIF_BUFFER_SIZE, g->f);
+        if (!g->len) {
+            return -1;
+        }
+    }
+    return g->buf[g->pos++];
+}
+
+/**
+ * @brief read bytes of a GIF file through its file buffer.
+ *
+ * @param g the GIF.
+ * @param dst destination.
+ * @param n number of bytes.
+ *
+ * @return true if all bytes were read, false at the end of the file.
+ */
+static bool bitmap_gif_read(bitmap_gif_t *g, uint8_t *dst, uint16_t n) {
+    uint16_t len;
+
+    while (n) {
+        if (g->pos == g->len) {
+            g->pos = 0;
+            g->len = fread(g->buf, 1, GIF_BUFFER_SIZE, g->f);
+            if (!g->len) {
+                return false;
+            }
+        }
+        len = g->len - g->pos;
+        if (len > n) {
+            len = n;
+        }
+        memcpy(dst, &g->buf[g->pos], len);
+        g->pos += len;
+        dst += len;
+        n -= len;
+    }
+    return true;
+}
+
+/**
+ * @brief skip a sequence of data sub-blocks up to and including the block terminator.
+ *
+ * @param g the GIF.
+ * @param n number of bytes left in the current sub-block.
+ *
+ * @return true if the terminator was found, false at the end of the file.
+ */
+static bool bitmap_gif_skip(bitmap_gif_t *g, uint16_t n) {
+    int16_t c;
+    uint16_t len;
+
+    for (;;) {
+        while (n) {
+            if (g->pos == g->len) {
+                g->pos = 0;
+                g->len = fread(g->buf, 1, GIF_BUFFER_SIZE, g->f);
+                if (!g->len) {
+                    return false;
+                }
+            }
+            len = g->len - g->pos;
+            if (len > n) {
+                len = n;
+            }
+            g->pos += len;
+            n -= len;
+        }
+        c = bitmap_gif_get(g);
+        if (c <= 0) {
+            return c == 0;
+        }
+        n = c;
+    }
+}
+
+/**
+ * @brief read a GIF color table. Missing entries of tables with less than 256 colors are black.
+ *
+ * @param g the GIF.
+ * @param palette VGA_MAX_COLORS entries for the colors.
+ * @param flags the flags of the screen or image descriptor with the size of the table.
+ *
+ * @return true if the table was read, false at the end of the file.
+ */
+static bool bitmap_gif_palette(bitmap_gif_t *g, palette_color_t *palette, uint8_t flags) {
+    uint16_t i, n = 2 << (flags & GIF_TABLE_SIZE);
+    uint8_t rgb[3];
+
+    memset(palette, 0x00, sizeof(palette_color_t) * VGA_MAX_COLORS);
+    for (i = 0; i < n; i++) {
+        if (!bitmap_gif_read(g, rgb, sizeof(rgb))) {
+            return false;
+        }
+        palette[i].red = rgb[0];
+        palette[i].green = rgb[1];
+        palette[i].blue = rgb[2];
+    }
+    return true;
+}
+
+/**
+ * @brief apply the disposal method of the current frame before the next one is drawn.
+ *
+ * @param g the GIF.
+ */
+static void bitmap_gif_dispose(bitmap_gif_t *g) {
+    uint16_t row;
+    uint8_t *dst = &g->bm->data[g->top * g->bm->width + g->left];
+
+    if (g->disposal == GIF_DISPOSE_BACKGROUND) {
+        for (row = 0; row < g->height; row++, dst += g->bm->width) {
+            memset(dst, g->background, g->width);
+        }
+    } else if ((g->disposal == GIF_DISPOSE_PREVIOUS) && g->previous) {
+        for (row = 0; row < g->height; row++, dst += g->bm->width) {
+            memcpy(dst, &g->previous[row * g->width], g->width);
+        }
+    }
+    free(g->previous);
+    g->previous = NULL;
+    g->disposal = GIF_DISPOSE_NONE;
+}
+
+/**
+ * @brief decode an image onto the canvas. The image descriptor is read after the image separator, pixels outside of
+ * the canvas and transparent pixels are not drawn.
+ *
+ * @param g the GIF.
+ *
+ * @return true if the image was decoded, false if the data is truncated or corrupt. err_no is set.
+ */
+static bool bitmap_gif_image(bitmap_gif_t *g) {
+    static const uint8_t pass_start[GIF_PASSES] = {0, 4, 2, 1};
+    static const uint8_t pass_step[GIF_PASSES] = {8, 8, 4, 2};
+    uint8_t desc[GIF_DESCRIPTOR_SIZE];
+    uint16_t left, top, width, height, x, y, step, pass;
+    uint16_t code, in, old, clear, next, mask, sp;
+    uint8_t *row, first = 0, size, min, block = 0;
+    uint32_t bits = 0, remaining;
+    uint8_t nbits = 0;
+    int16_t c;
+
+    if (!bitmap_gif_read(g, desc, sizeof(desc))) {
+        ERR_IOERR();
+        return false;
+    }
+    left = desc[0] | (uint16_t)desc[1] << 8;
+    top = desc[2] | (uint16_t)desc[3] << 8;
+    width = desc[4] | (uint16_t)desc[5] << 8;
+    height = desc[6] | (uint16_t)desc[7] << 8;
+
+    // the palette of the image
+    if (desc[8] & GIF_COLOR_TABLE) {
+        if (!bitmap_gif_palette(g, g->bm->palette, desc[8])) {
+            ERR_IOERR();
+            return false;
+        }
+    } else {
+        memcpy(g->bm->palette, g->global, sizeof(g->global));
+    }
+
+    // remember the visible area for the disposal and save it if it must be restored
+    g->left = left < g->bm->width ? left : g->bm->width;
+    g->top = top < g->bm->height ? top : g->bm->height;
+    g->width = (width < g->bm->width - g->left) ? width : g->bm->width - g->left;
+    g->height = (height < g->bm->height - g->top) ? height : g->bm->height - g->top;
+    g->disposal = g->next_disposal;
+    if ((g->disposal == GIF_DISPOSE_PREVIOUS) && g->width && g->height) {
+        g->previous = malloc(g->width * g->height);
+        if (g->previous) {
+            row = &g->bm->data[g->top * g->bm->width + g->left];
+            for (y = 0; y < g->height; y++, row += g->bm->width) {
+                memcpy(&g->previous[y * g->width], row, g->width);
+            }
+        }
+    }
+
+    // start LZW decoding
+    c = bitmap_gif_get(g);
+    if (c < 0) {
+        ERR_IOERR();
+        return false;
+    }
+    min = c;
+    if (!min || (min > BMP_BPP)) {
+        ERR_PARAM();
+        return false;
+    }
+    clear = 1 << min;
+    for (code = 0; code < clear; code++) {
+        g->suffix[code] = code;
+    }
+    size = min + 1;
+    mask = (1 << size) - 1;
+    next = clear + 2;
+    old = GIF_NO_CODE;
+
+    x = 0;
+    y = 0;
+    pass = 0;
+    step = (desc[8] & GIF_INTERLACE) ? pass_step[0] : 1;
+    row = (y < g->height) ? &g->bm->data[(g->top + y) * g->bm->width + g->left] : NULL;
+    remaining = (uint32_t)width * height;
+    while (remaining) {
+        // read the next code from the data sub-blocks
+        while (nbits < size) {
+            if (!block) {
+                c = bitmap_gif_get(g);
+                if (c <= 0) {
+                    if (c < 0) {
+                        ERR_IOERR();
+                        return false;
+                    }
+                    // the image data ends early, keep what was decoded
+                    ERR_OK();
+                    return true;
+                }
+                block = c;
+            }
+            c = bitmap_gif_get(g);
+            if (c < 0) {
+                ERR_IOERR();
+                return false;
+            }
+            block--;
+            bits |= (uint32_t)c << nbits;
+            nbits += 8;
+        }
+        code = (uint16_t)bits & mask;
+        bits >>= size;
+        nbits -= size;
+
+        if (code == clear) {
+            size = min + 1;
+            mask = (1 << size) - 1;
+            next = clear + 2;
+            old = GIF_NO_CODE;
+            continue;
+        } else if (code == clear + 1) {
+            break;
+        }
+
+        // expand the code onto the stack, the pixels are in reverse order
+        sp = 0;
+        in = code;
+        if (old == GIF_NO_CODE) {
+            if (code >= clear) {
+                ERR_PARAM();
+                return false;
+            }
+        } else if (code >= next) {
+            if (code > next) {
+                ERR_PARAM();
+                return false;
+            }
+            g->stack[sp++] = first;
+            code = old;
+        }
+        while (code >= clear) {
+            if (sp >= GIF_MAX_CODES - 1) {
+                ERR_PARAM();
+                return false;
+            }
+            g->stack[sp++] = g->suffix[code];
+            code = g->prefix[code];
+        }
+        first = g->suffix[code];
+        g->stack[sp++] = first;
+
+        // add a new code to the table
+        if ((old != GIF_NO_CODE) && (next < GIF_MAX_CODES)) {
+            g->prefix[next] = old;
+            g->suffix[next] = first;
+            next++;
+            if ((next > mask) && (size < GIF_MAX_BITS)) {
+                size++;
+                mask = (1 << size) - 1;
+            }
+        }
+        old = in;
+
+        // draw the pixels
+        while (sp && remaining) {
+            c = g->stack[--sp];
+            if (row && (x < g->width) && (c != g->transparent)) {
+                row[x] = c;
+            }
+            remaining--;
+            if (++x == width) {
+                x = 0;
+                y += step;
+                while ((y >= height) && (step != 1) && (pass < GIF_PASSES - 1)) {
+                    pass++;
+                    y = pass_start[pass];
+                    step = pass_step[pass];
+                }
+                row = (y < g->height) ? &g->bm->data[(g->top + y) * g->bm->width + g->left] : NULL;
+            }
+        }
+    }
+
+    // skip the end of information code and the rest of the data
+    if (!bitmap_gif_skip(g, block)) {
+        ERR_IOERR();
+        return false;
+    }
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief open a BMP file and check its header.
+ *
+ * @param fname file name
+ * @param header the header is read into this.
+ *
+ * @return the file positioned after the header or NULL if it could not be read or has an unsupported format.
+ */
+static FILE *bitmap_open(char *fname, bmp_header_t *header) {
+    FILE *f;
+
+    f = fopen(fname, "rb");
+    if (!f) {
+        ERR_NOENT();
+        return NULL;
+    }
+
+    // read header
+    if (fread(header, sizeof(bmp_header_t), 1, f) != 1) {
+        ERR_IOERR();
+        fclose(f);
+        return NULL;
+    }
+
+    // check for "BM" and right format
+    if ((header->B != 'B') || (header->M != 'M') || (header->info_header_size != BMP_INFO_HEADER_SIZE) || (header->planes != BMP_NUM_PLANES) ||
+        (header->bit_per_pixel != BMP_BPP) || ((header->compression != BMP_COMPRESSION_NONE) && (header->compression != BMP_COMPRESSION_RLE8)) ||
+        (header->num_colors > BMP_COLORS)) {
+        ERR_PARAM();
+        fclose(f);
+        return NULL;
+    }
+    if (!header->num_colors) {
+        header->num_colors = BMP_COLORS;  // 0 means all colors
+    }
+    return f;
+}
+
+/**
+ * @brief load an uncompressed or RLE8 compressed, 8bit BMP from disk.
+ * The palette and the pixel array are read with a few large reads directly into the bitmap, the padding of the
+ * scanlines is removed and the bottom-up image is flipped in place. RLE8 data is decoded while it is read.
+ *
+ * @param fname file name
+ * @param palette true to also load the palette, false to just load the image data.
+ * @return a bitmap_t or NULL if loading fails.
+ */
+bitmap_t *bitmap_load(char *fname, bool palette) {
+    FILE *f;
+    bitmap_t *bm = NULL;
+    bmp_header_t header;
+    surface_t s;
+    bool ok;
+
+    f = bitmap_open(fname, &header);
+    if (!f) {
+        return NULL;
+    }
+
+    // create bitmap
+    bm = bitmap_create(header.width, header.height, palette ? header.num_colors : 0);
+    if (!bm) {
+        ERR_NOMEM();
+        fclose(f);
+        return NULL;
+    }
+
+    // load palette (if wanted) and image data, the image data does not need to follow the palette directly
+    ok = (!palette || bitmap_read_palette(bm, f)) && ((ftell(f) == header.data_offset) || !fseek(f, header.data_offset, SEEK_SET));
+    if (ok && (header.compression == BMP_COMPRESSION_RLE8)) {
+        bitmap_get_surface(bm, &s);
+        ok = bitmap_read_rle(f, &s, 0, 0, bm->width, bm->height);
+    } else if (ok) {
+        ok = bitmap_read_data(bm, f);
+    }
+    if (!ok) {
+        ERR_IOERR();
+        bitmap_free(bm);
+        fclose(f);
+        return NULL;
+    }
+
+    // all done and ok
+    fclose(f);
+    ERR_OK();
+    return bm;
+}
+
+/**
+ * @brief draw an uncompressed or RLE8 compressed, 8bit BMP from disk directly to the screen (the back buffer if
+ * vga_begin_frame() was used). The file is streamed through a small buffer, no bitmap is allocated.
+ *
+ * @param fname file name
+ * @param x screen x
+ * @param y screen y
+ * @param palette true to also set the VGA palette.
+ *
+ * @return true if the image was drawn, else false.
+ */
+bool bitmap_load_screen(char *fname, uint16_t x, uint16_t y, bool palette) {
+    FILE *f;
+    bmp_header_t header;
+    surface_t *s = vga_screen();
+    palette_color_t color;
+    bmp_color_t *src;
+    uint16_t i, row, stride;
+    bool ok;
+
+    f = bitmap_open(fname, &header);
+    if (!f) {
+        return false;
+    }
+
+    stride = (header.width + BMP_SCANLINE_PADDING - 1) & ~(BMP_SCANLINE_PADDING - 1);
+    if (!header.width || !header.height || (x + header.width > s->width) || (y + header.height > s->height)) {
+        ERR_PARAM();
+        fclose(f);
+        return false;
+    }
+
+    // set palette (if wanted)
+    bitmap_len = bitmap_pos = 0;
+    ok = !palette || bitmap_fill(f, header.num_colors * sizeof(bmp_color_t));
+    if (ok && palette) {
+        src = (bmp_color_t *)bitmap_buf;
+        for (i = 0; i < header.num_colors; i++, src++) {
+            color.red = src->red;
+            color.green = src->green;
+            color.blue = src->blue;
+            vga_set_color(i, &color);
+        }
+    }
+
+    // draw image data
+    ok = ok && !fseek(f, header.data_offset, SEEK_SET);
+    if (ok && (header.compression == BMP_COMPRESSION_RLE8)) {
+        ok = bitmap_read_rle(f, s, x, y, header.width, header.height);
+    } else if (ok) {
+        bitmap_len = bitmap_pos = 0;
+        for (row = header.height; ok && row; row--) {
+            ok = bitmap_fill(f, row > 1 ? stride : header.width);  // the padding of the last scanline may be missing
+            if (ok) {
+                vga_surface_put_span(s, x, y + row - 1, &bitmap_buf[bitmap_pos], header.width);
+                bitmap_pos += stride;
+            }
+        }
+    }
+    vga_surface_dirty(s, x, y, x + header.width - 1, y + header.height - 1);
+    fclose(f);
+
+    if (!ok) {
+        ERR_IOERR();
+        return false;
+    }
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief save an uncompressed, 8bit BMP to disk.
+ *
+ * @param bm pointer to the bitmap. It must contain a pallete with 256 colors!
+ * @param fname file name
+ *
+ * @return true if the image could be saved, else false.
+ */
+bool bitmap_save(bitmap_t *bm, const char *fname) {
+    surface_t s;
+
+    if (!bm->palette || (bm->num_colors != BMP_COLORS)) {
+        ERR_PARAM();
+        return false;
+    }
+
+    bitmap_get_surface(bm, &s);
+    return bitmap_write(fname, &s, 0, 0, bm->width, bm->height, bm->palette, false);
+}
+
+/**
+ * @brief save a RLE8 compressed, 8bit BMP to disk.
+ *
+ * @param bm pointer to the bitmap. It must contain a pallete with 256 colors!
+ * @param fname file name
+ *
+ * @return true if the image could be saved, else false.
+ */
+bool bitmap_save_rle(bitmap_t *bm, const char *fname) {
+    surface_t s;
+
+    if (!bm->palette || (bm->num_colors != BMP_COLORS)) {
+        ERR_PARAM();
+        return false;
+    }
+
+    bitmap_get_surface(bm, &s);
+    return bitmap_write(fname, &s, 0, 0, bm->width, bm->height, bm->palette, true);
+}
+
+/**
+ * @brief save an area of the screen (the back buffer if vga_begin_frame() was used) with the current VGA palette as
+ * 8bit BMP to disk without copying it into a bitmap first.
+ *
+ * @param fname file name
+ * @param x screen start x
+ * @param y screen start y
+ * @param width width of the image
+ * @param height height of the image
+ * @param rle true to compress the image with RLE8.
+ *
+ * @return true if the image could be saved, else false.
+ */
+bool bitmap_save_screen(const char *fname, uint16_t x, uint16_t y, uint16_t width, uint16_t height, bool rle) {
+    surface_t *s = vga_screen();
+
+    if (!width || !height || (x + width > s->width) || (y + height > s->height)) {
+        ERR_PARAM();
+        return false;
+    }
 
-//! BMP image color table entry (order of the colors is wrong in the HTML mentioned above!)
-typedef struct __bmp_color {
-    uint8_t blue;
-    uint8_t green;
-    uint8_t red;
-    uint8_t reserved02;
-} bmp_color_t;
+    return bitmap_write(fname, s, x, y, width, height, NULL, rle);
+}
 
 /**
- * @brief load an uncompressed, 8bit BMP from disk.
+ * @brief load an 8bit PCX from disk. The file is decoded while it is read through a small buffer.
  *
  * @param fname file name
- * @param palette true to also load the palette, false to just load the image data.
+ * @param palette true to also load the 256 color palette from the end of the file.
+ *
  * @return a bitmap_t or NULL if loading fails.
  */
-bitmap_t *bitmap_load(char *fname, bool palette) {
-    uint16_t offset;
-    int i;
+bitmap_t *bitmap_load_pcx(char *fname, bool palette) {
     FILE *f;
-    bitmap_t *bm = NULL;
-    bmp_header_t header;
-    bmp_color_t color;
+    bitmap_t *bm;
+    pcx_header_t header;
+    surface_t s;
 
-    f = fopen(fname, "rb");
+    f = bitmap_open_pcx(fname, &header);
     if (!f) {
-        ERR_NOENT();
         return NULL;
     }
 
-    // read header
-    if ((i = fread(&header, sizeof(bmp_header_t), 1, f)) != 1) {
-        ERR_IOERR();
+    // create bitmap
+    bm = bitmap_create(header.xmax - header.xmin + 1, header.ymax - header.ymin + 1, palette ? VGA_MAX_COLORS : 0);
+    if (!bm) {
+        ERR_NOMEM();
         fclose(f);
         return NULL;
     }
 
-    // check for "BM" and right format
-    if ((header.B != 'B') || (header.M != 'M') || (header.info_header_size != BMP_INFO_HEADER_SIZE) || (header.planes != BMP_NUM_PLANES) || (header.bit_per_pixel != BMP_BPP) ||
-        (header.compression != BMP_COMPRESSION_NONE)) {
+    // load palette (if wanted)
+    if (palette && !bitmap_read_pcx_palette(f, bm->palette)) {
         ERR_PARAM();
+        bitmap_free(bm);
         fclose(f);
         return NULL;
     }
 
-    // create bitmap
-    bm = bitmap_create(header.width, header.height, palette ? header.num_colors : 0);
-    if (!bm) {
-        ERR_NOMEM();
+    // load image data
+    bitmap_get_surface(bm, &s);
+    if (fseek(f, sizeof(pcx_header_t), SEEK_SET) || !bitmap_read_pcx(f, &s, 0, 0, bm->width, bm->height, header.bytes_per_line)) {
+        ERR_IOERR();
+        bitmap_free(bm);
         fclose(f);
         return NULL;
     }
 
-    // load palette (if wanted), if not skip data
-    if (palette) {
-        for (i = 0; i < header.num_colors; i++) {
-            if (fread(&color, sizeof(bmp_color_t), 1, f) != 1) {
-                ERR_IOERR();
-                bitmap_free(bm);
-                fclose(f);
-                return NULL;
-            }
-            bm->palette[i].red = color.red;
-            bm->palette[i].green = color.green;
-            bm->palette[i].blue = color.blue;
-        }
-    } else {
-        fseek(f, sizeof(bmp_color_t) * header.num_colors, SEEK_CUR);
+    // all done and ok
+    fclose(f);
+    ERR_OK();
+    return bm;
+}
+
+/**
+ * @brief draw an 8bit PCX from disk directly to the screen (the back buffer if vga_begin_frame() was used).
+ * The file is streamed through a small buffer, no bitmap is allocated.
+ *
+ * @param fname file name
+ * @param x screen x
+ * @param y screen y
+ * @param palette true to also set the VGA palette from the end of the file.
+ *
+ * @return true if the image was drawn, else false.
+ */
+bool bitmap_load_pcx_screen(char *fname, uint16_t x, uint16_t y, bool palette) {
+    FILE *f;
+    pcx_header_t header;
+    surface_t *s = vga_screen();
+    palette_color_t colors[VGA_MAX_COLORS];
+    uint16_t width, height;
+    bool ok;
+
+    f = bitmap_open_pcx(fname, &header);
+    if (!f) {
+        return false;
     }
 
-    // load image data
-    offset = bm->width * (bm->height - 1);
-    for (i = 0; i < bm->height; i++, offset -= bm->width) {
-        if (fread(&bm->data[offset], bm->width, 1, f) != 1) {
-            ERR_IOERR();
-            bitmap_free(bm);
+    width = header.xmax - header.xmin + 1;
+    height = header.ymax - header.ymin + 1;
+    if ((x + width > s->width) || (y + height > s->height)) {
+        ERR_PARAM();
+        fclose(f);
+        return false;
+    }
+
+    // set palette (if wanted)
+    if (palette) {
+        if (!bitmap_read_pcx_palette(f, colors)) {
+            ERR_PARAM();
             fclose(f);
-            return NULL;
-        }
-        // scanlines are padded to multiples of 4
-        if (bm->width % BMP_SCANLINE_PADDING) {
-            fseek(f, BMP_SCANLINE_PADDING - (bm->width % BMP_SCANLINE_PADDING), SEEK_CUR);
+            return false;
         }
+        vga_set_palette(colors, VGA_MAX_COLORS);
     }
 
-    // all done and ok
+    // draw image data
+    ok = !fseek(f, sizeof(pcx_header_t), SEEK_SET) && bitmap_read_pcx(f, s, x, y, width, height, header.bytes_per_line);
+    vga_surface_dirty(s, x, y, x + width - 1, y + height - 1);
     fclose(f);
+
+    if (!ok) {
+        ERR_IOERR();
+        return false;
+    }
     ERR_OK();
-    return bm;
+    return true;
 }
 
 /**
- * @brief save an uncompressed, 8bit BMP to disk.
+ * @brief save an 8bit PCX to disk. The image is assembled in a small buffer and written in a few large writes.
  *
  * @param bm pointer to the bitmap. It must contain a pallete with 256 colors!
  * @param fname file name
  *
  * @return true if the image could be saved, else false.
  */
-bool bitmap_save(bitmap_t *bm, const char *fname) {
-    uint16_t data_size, offset;
-    int i, p;
+bool bitmap_save_pcx(bitmap_t *bm, const char *fname) {
     FILE *f;
-    bmp_header_t header;
-    bmp_color_t color;
+    pcx_header_t header;
+    uint16_t row, x, n;
+    uint8_t *src, c;
+    bool ok;
 
     if (!bm->palette || (bm->num_colors != BMP_COLORS)) {
         ERR_PARAM();
@@ -163,70 +1376,232 @@ bool bitmap_save(bitmap_t *bm, const char *fname) {
         return false;
     }
 
-    // create header
-    data_size = bm->width * bm->height;
-
-    header.B = 'B';
-    header.M = 'M';
-    header.file_size = sizeof(bmp_header_t) + BMP_COLORS * sizeof(bmp_color_t) + data_size;
-    header.reserved01 = 0x00;
-    header.data_offset = sizeof(bmp_header_t) + BMP_COLORS * sizeof(bmp_color_t);
-    header.info_header_size = BMP_INFO_HEADER_SIZE;
-    header.width = bm->width;
-    header.height = bm->height;
+    // create header, scanlines have an even number of bytes
+    memset(&header, 0x00, sizeof(pcx_header_t));
+    header.manufacturer = PCX_MANUFACTURER;
+    header.version = PCX_VERSION;
+    header.encoding = PCX_ENCODING_RLE;
+    header.bits_per_pixel = BMP_BPP;
+    header.xmax = bm->width - 1;
+    header.ymax = bm->height - 1;
+    header.hdpi = 72;
+    header.vdpi = 72;
     header.planes = BMP_NUM_PLANES;
-    header.bit_per_pixel = BMP_BPP;
-    header.compression = BMP_COMPRESSION_NONE;
-    header.image_size = bm->width * bm->height;
-    header.x_pixels_per_m = 0xB12;  // (0xB12 = 72 dpi)
-    header.y_pixels_per_m = 0xB12;  // (0xB12 = 72 dpi)
-    header.num_colors = BMP_COLORS;
-    header.important_colors = 0;
+    header.bytes_per_line = (bm->width + 1) & ~1;
+    header.palette_info = PCX_PALETTE_COLOR;
+    bitmap_len = 0;
+    ok = bitmap_put(f, (uint8_t *)&header, sizeof(pcx_header_t));
+
+    // compress scanlines, runs do not cross scanlines
+    src = bm->data;
+    for (row = 0; ok && (row < bm->height); row++, src += bm->width) {
+        for (x = 0; ok && (x < header.bytes_per_line); x += n) {
+            c = (x < bm->width) ? src[x] : 0x00;
+            for (n = 1; (x + n < bm->width) && (n < PCX_MAX_RUN) && (src[x + n] == c); n++) {
+            }
+            ok = bitmap_put_pcx_run(f, c, n);
+        }
+    }
+
+    // add palette
+    c = PCX_PALETTE_MARKER;
+    ok = ok && bitmap_put(f, &c, 1);
+    for (x = 0; ok && (x < VGA_MAX_COLORS); x++) {
+        ok = bitmap_put(f, &bm->palette[x].red, 1) && bitmap_put(f, &bm->palette[x].green, 1) && bitmap_put(f, &bm->palette[x].blue, 1);
+    }
+    ok = ok && bitmap_flush(f);
 
-    // write header
-    if (fwrite(&header, sizeof(bmp_header_t), 1, f) != 1) {
+    if (fclose(f) || !ok) {
         ERR_IOERR();
-        fclose(f);
         remove(fname);
         return false;
     }
 
-    // write color
-    color.reserved02 = 0x00;
-    for (i = 0; i < BMP_COLORS; i++) {
-        color.red = bm->palette[i].red;
-        color.green = bm->palette[i].green;
-        color.blue = bm->palette[i].blue;
+    // all done and ok
+    ERR_OK();
+    return true;
+}
 
-        if (fwrite(&color, sizeof(bmp_color_t), 1, f) != 1) {
-            ERR_IOERR();
-            fclose(f);
-            remove(fname);
-            return false;
-        }
+/**
+ * @brief open a GIF for decoding one frame at a time with bitmap_gif_frame(). Only the current frame is kept in memory.
+ *
+ * @param fname file name
+ *
+ * @return the GIF or NULL if the file could not be opened or is no GIF. The canvas must be smaller than 64KiB.
+ */
+bitmap_gif_t *bitmap_gif_open(char *fname) {
+    bitmap_gif_t *g;
+    uint8_t header[GIF_HEADER_SIZE];
+    uint16_t width, height;
+
+    g = calloc(sizeof(bitmap_gif_t), 1);
+    if (!g) {
+        ERR_NOMEM();
+        return NULL;
     }
+    g->transparent = GIF_NO_TRANSPARENT;
 
-    // write data
-    offset = bm->width * (bm->height - 1);
-    for (i = 0; i < bm->height; i++, offset -= bm->width) {
-        if (fwrite(&bm->data[offset], bm->width, 1, f) != 1) {
-            ERR_IOERR();
-            fclose(f);
-            remove(fname);
+    g->f = fopen(fname, "rb");
+    if (!g->f) {
+        ERR_NOENT();
+        bitmap_gif_close(g);
+        return NULL;
+    }
+
+    // read logical screen descriptor and global color table
+    if (!bitmap_gif_read(g, header, sizeof(header)) || ((header[GIF_FLAGS] & GIF_COLOR_TABLE) && !bitmap_gif_palette(g, g->global, header[GIF_FLAGS]))) {
+        ERR_IOERR();
+        bitmap_gif_close(g);
+        return NULL;
+    }
+    width = header[6] | (uint16_t)header[7] << 8;
+    height = header[8] | (uint16_t)header[9] << 8;
+    if (memcmp(header, GIF_SIGNATURE, sizeof(GIF_SIGNATURE) - 1) || !width || !height) {
+        ERR_PARAM();
+        bitmap_gif_close(g);
+        return NULL;
+    }
+    if ((uint32_t)width * height > GIF_MAX_PIXELS) {
+        ERR_NOMEM();
+        bitmap_gif_close(g);
+        return NULL;
+    }
+    g->background = header[GIF_BACKGROUND];
+    g->frame1 = ftell(g->f) - (g->len - g->pos);
+
+    // create the canvas
+    g->bm = bitmap_create(width, height, VGA_MAX_COLORS);
+    if (!g->bm) {
+        bitmap_gif_close(g);
+        return NULL;
+    }
+    memset(g->bm->data, g->background, width * height);
+    memcpy(g->bm->palette, g->global, sizeof(g->global));
+
+    ERR_OK();
+    return g;
+}
+
+/**
+ * @brief decode the next frame of a GIF onto its canvas g->bm and set its palette. After the last frame the animation
+ * starts over with the first one.
+ *
+ * @param g the GIF.
+ *
+ * @return true if a frame was decoded, false if the file is truncated or corrupt.
+ */
+bool bitmap_gif_frame(bitmap_gif_t *g) {
+    uint8_t control[GIF_CONTROL_SIZE + 1];
+    bool rewound = false;
+    int16_t c;
+
+    bitmap_gif_dispose(g);
+    for (;;) {
+        c = bitmap_gif_get(g);
+        if (c == GIF_IMAGE) {
+            if (!bitmap_gif_image(g)) {
+                return false;
+            }
+            g->frame++;
+            g->delay = g->next_delay;
+            g->next_delay = 0;
+            g->next_disposal = GIF_DISPOSE_NONE;
+            g->transparent = GIF_NO_TRANSPARENT;
+            return true;
+        } else if (c == GIF_EXTENSION) {
+            c = bitmap_gif_get(g);
+            if (c < 0) {
+                break;
+            }
+            if (c == GIF_GRAPHIC_CONTROL) {
+                // block size, flags, delay and transparent color
+                if (!bitmap_gif_read(g, control, sizeof(control))) {
+                    break;
+                }
+                if (control[0] != GIF_CONTROL_SIZE) {
+                    ERR_PARAM();
+                    return false;
+                }
+                g->next_disposal = (control[1] >> 2) & GIF_DISPOSE_MASK;
+                g->next_delay = (control[2] | (uint16_t)control[3] << 8) * 10;
+                g->transparent = (control[1] & GIF_TRANSPARENT) ? control[4] : GIF_NO_TRANSPARENT;
+            }
+            if (!bitmap_gif_skip(g, 0)) {
+                break;
+            }
+        } else if ((c == GIF_TRAILER) || (c < 0)) {
+            // start over, files without trailer are accepted
+            if (!g->frame || rewound) {
+                break;
+            }
+            if (fseek(g->f, g->frame1, SEEK_SET)) {
+                break;
+            }
+            g->pos = g->len = 0;
+            g->frame = 0;
+            g->next_delay = 0;
+            g->next_disposal = GIF_DISPOSE_NONE;
+            g->transparent = GIF_NO_TRANSPARENT;
+            memset(g->bm->data, g->background, g->bm->width * g->bm->height);
+            rewound = true;
+        } else {
+            ERR_PARAM();
             return false;
         }
-        // scanlines are padded to multiples of 4
-        if (bm->width % BMP_SCANLINE_PADDING) {
-            for (p = 0; p < BMP_SCANLINE_PADDING - (bm->width % BMP_SCANLINE_PADDING); p++) {
-                fputc(0x00, f);
-            }
+    }
+    ERR_IOERR();
+    return false;
+}
+
+/**
+ * @brief close a GIF and free its canvas.
+ *
+ * @param g the GIF or NULL.
+ */
+void bitmap_gif_close(bitmap_gif_t *g) {
+    if (g) {
+        if (g->f) {
+            fclose(g->f);
         }
+        free(g->previous);
+        bitmap_free(g->bm);
+        free(g);
+    }
+}
+
+/**
+ * @brief load the first frame of a GIF from disk.
+ *
+ * @param fname file name
+ * @param palette true to also load the palette of the image.
+ *
+ * @return a bitmap_t or NULL if loading fails.
+ */
+bitmap_t *bitmap_load_gif(char *fname, bool palette) {
+    bitmap_gif_t *g;
+    bitmap_t *bm;
+
+    g = bitmap_gif_open(fname);
+    if (!g) {
+        return NULL;
+    }
+    if (!bitmap_gif_frame(g)) {
+        bitmap_gif_close(g);
+        return NULL;
+    }
+
+    // keep the canvas
+    bm = g->bm;
+    g->bm = NULL;
+    bitmap_gif_close(g);
+    if (!palette) {
+        free(bm->palette);
+        bm->palette = NULL;
+        bm->num_colors = 0;
     }
 
-    // all done and ok
-    fclose(f);
     ERR_OK();
-    return true;
+    return bm;
 }
 
 /**
@@ -309,9 +1684,11 @@ bitmap_t *bitmap_copy(uint16_t x, uint16_t y, uint16_t width, uint16_t height, b
     uint16_t bitmap_offset = 0;
     int copy_x, copy_y;
     bitmap_t *bm;
+    surface_t *s = vga_screen();
+    uint8_t *buf = s->data;
 
     // check parameters
-    if ((x + width > VGA_SCREEN_WIDTH) || (y + height > VGA_SCREEN_HEIGHT)) {
+    if ((x + width > s->width) || (y + height > s->height)) {
         ERR_PARAM();
         return NULL;
     }
@@ -329,11 +1706,17 @@ bitmap_t *bitmap_copy(uint16_t x, uint16_t y, uint16_t width, uint16_t height, b
     }
 
     // copy data
-    for (copy_y = 0; copy_y < height; copy_y++) {
-        for (copy_x = 0; copy_x < width; copy_x++, bitmap_offset++) {
-            bm->data[bitmap_offset] = VGA_MEMORY[(uint16_t)(screen_offset + x + copy_x)];
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        for (copy_y = 0; copy_y < height; copy_y++) {
+            for (copy_x = 0; copy_x < width; copy_x++, bitmap_offset++) {
+                bm->data[bitmap_offset] = vga_surface_get_pixel(s, x + copy_x, y + copy_y);
+            }
+        }
+    } else {
+        for (copy_y = 0; copy_y < height; copy_y++, bitmap_offset += width) {
+            span_copy(&bm->data[bitmap_offset], &buf[(uint16_t)(screen_offset + x)], width);
+            screen_offset += s->stride;
         }
-        screen_offset += VGA_SCREEN_WIDTH;
     }
     ERR_OK();
     return bm;
@@ -350,12 +1733,10 @@ bitmap_t *bitmap_copy(uint16_t x, uint16_t y, uint16_t width, uint16_t height, b
  * @return true if all ok or false if  x_width/y+height are out of bounds.
  */
 bool bitmap_draw(bitmap_t *bm, uint16_t x, uint16_t y, bool apply_colors) {
-    uint16_t screen_offset = (y << 8) + (y << 6) + x;
-    uint16_t bitmap_offset = 0;
-    int j;
+    surface_t *s = vga_screen();
 
     // check parameters
-    if ((x + bm->width > VGA_SCREEN_WIDTH) || (y + bm->height > VGA_SCREEN_HEIGHT)) {
+    if ((x + bm->width > s->width) || (y + bm->height > s->height)) {
         ERR_PARAM();
         return false;
     }
@@ -364,18 +1745,59 @@ bool bitmap_draw(bitmap_t *bm, uint16_t x, uint16_t y, bool apply_colors) {
         vga_set_palette(bm->palette, bm->num_colors);
     }
 
-    // copy data
-    for (j = 0; j < bm->height; j++) {
-        memcpy(&VGA_MEMORY[screen_offset], &bm->data[bitmap_offset], bm->width);
-
-        bitmap_offset += bm->width;
-        screen_offset += VGA_SCREEN_WIDTH;
-    }
+    bitmap_surface_draw(s, bm, x, y);
 
     ERR_OK();
     return true;
 }
 
+/**
+ * @brief get a surface that draws into a bitmap, e.g. to pre-render images off-screen.
+ *
+ * @param bm the bitmap to draw into.
+ * @param s the surface to initialize.
+ */
+void bitmap_get_surface(bitmap_t *bm, surface_t *s) { vga_surface_init(s, bm->data, bm->width, bm->width, bm->height); }
+
+/**
+ * @brief draw a bitmap onto a surface. The bitmap is clipped to the clipping rectangle of the surface.
+ *
+ * @param s the surface to draw on.
+ * @param bm the bitmap to draw.
+ * @param x x pos
+ * @param y y pos
+ */
+void bitmap_surface_draw(surface_t *s, bitmap_t *bm, int16_t x, int16_t y) {
+    int16_t left = x, top = y, right = x + bm->width - 1, bottom = y + bm->height - 1;
+    uint16_t bitmap_offset, width;
+
+    if (left < s->clip.left) {
+        left = s->clip.left;
+    }
+    if (top < s->clip.top) {
+        top = s->clip.top;
+    }
+    if (right > s->clip.right) {
+        right = s->clip.right;
+    }
+    if (bottom > s->clip.bottom) {
+        bottom = s->clip.bottom;
+    }
+    if ((left > right) || (top > bottom)) {
+        return;
+    }
+
+    bitmap_offset = (uint16_t)(top - y) * bm->width + (left - x);
+    width = right - left + 1;
+
+    // copy data
+    for (y = top; y <= bottom; y++) {
+        vga_surface_put_span(s, left, y, &bm->data[bitmap_offset], width);
+        bitmap_offset += bm->width;
+    }
+    vga_surface_dirty(s, left, top, right, bottom);
+}
+
 /**
  * @brief change the color in a bitmap. This function is a NOP if the bitmap has no palette or idx is out of range.
  *
@@ -402,35 +1824,84 @@ void bitmap_set_color(bitmap_t *bm, uint8_t idx, palette_color_t *c) {
  *
  * @return width of the character rendered or 0 if nothing was rendered.
  */
-uint16_t bitmap_render_char(bitmap_t *bm, uint16_t x, uint16_t y, char ch, color_t c) {
-    uint16_t ch_offset;
-    uint16_t screen_offset = (y << 8) + (y << 6) + x;
-    uint16_t bitmap_offset;
+uint16_t bitmap_render_char(bitmap_t *bm, uint16_t x, uint16_t y, char ch, color_t c) { return bitmap_surface_render_char(vga_screen(), bm, x, y, ch, c); }
+
+/**
+ * @brief render a string to screen using a bitmap font. Multi line strings can be rendered using '\n' in the string.
+ *
+ * @param bm the bitmap to use as font
+ * @param x x pos
+ * @param y y pos
+ * @param str the string to render.
+ * @param c color to use for rendering
+ *
+ * @return width of the rendered string. For multi line string this is the width of the last line.
+ */
+uint16_t bitmap_render_string(bitmap_t *bm, uint16_t x, uint16_t y, char *str, color_t c) { return bitmap_surface_render_string(vga_screen(), bm, x, y, str, c); }
+
+/**
+ * @brief render a single character from a bitmap font onto a surface. The character is clipped to the clipping rectangle of the surface.
+ *
+ * @param s the surface to draw on.
+ * @param bm the bitmap to use as font
+ * @param x x pos
+ * @param y y pos
+ * @param ch the character to render.
+ * @param c color to use for rendering
+ *
+ * @return width of the character or 0 if the character is not in the font.
+ */
+uint16_t bitmap_surface_render_char(surface_t *s, bitmap_t *bm, int16_t x, int16_t y, char ch, color_t c) {
+    int16_t left = x, top = y, right = x + bm->ch_width - 1, bottom = y + bm->height - 1;
+    uint16_t screen_offset, bitmap_offset;
     int16_t ch_idx = ((uint8_t)ch) - ((uint8_t)' ');  // space is first character
-    uint16_t j, w;
-
-    if (bm->ch_width && (ch_idx >= 0) && (ch_idx < BMP_NUM_CHARS) && (x + bm->ch_width < VGA_SCREEN_WIDTH) && (y + bm->height < VGA_SCREEN_HEIGHT)) {  // check bounds
-        ch_offset = ch_idx * bm->ch_width;
-        bitmap_offset = ch_offset;
-        // copy data
-        for (j = 0; j < bm->height; j++) {
-            for (w = 0; w < bm->ch_width; w++) {
-                if (bm->data[bitmap_offset + w]) {
-                    VGA_MEMORY[screen_offset + x + w] = c;
+    int16_t j, w;
+
+    if (!bm->ch_width || (ch_idx < 0) || (ch_idx >= BMP_NUM_CHARS)) {
+        return 0;  // nothing was rendered
+    }
+
+    if (left < s->clip.left) {
+        left = s->clip.left;
+    }
+    if (top < s->clip.top) {
+        top = s->clip.top;
+    }
+    if (right > s->clip.right) {
+        right = s->clip.right;
+    }
+    if (bottom > s->clip.bottom) {
+        bottom = s->clip.bottom;
+    }
+    if ((left > right) || (top > bottom)) {
+        return bm->ch_width;  // completely clipped
+    }
+
+    screen_offset = (uint16_t)top * s->stride + left;
+    bitmap_offset = (uint16_t)(top - y) * bm->width + ch_idx * bm->ch_width + (left - x);
+
+    // copy data
+    for (j = top; j <= bottom; j++) {
+        for (w = 0; w <= right - left; w++) {
+            if (bm->data[bitmap_offset + w]) {
+                if (s->flags & VGA_SURFACE_PLANAR) {
+                    modex_put_pixel(s, left + w, j, c);
+                } else {
+                    s->data[screen_offset + w] = c;
                 }
             }
-            bitmap_offset += bm->width;
-            screen_offset += VGA_SCREEN_WIDTH;
         }
-        return bm->ch_width;
-    } else {
-        return 0;  // nothing was rendered
+        bitmap_offset += bm->width;
+        screen_offset += s->stride;
     }
+    vga_surface_dirty(s, left, top, right, bottom);
+    return bm->ch_width;
 }
 
 /**
- * @brief render a string to screen using a bitmap font. Multi line strings can be rendered using '\n' in the string.
+ * @brief render a string onto a surface using a bitmap font. Multi line strings can be rendered using '\n' in the string.
  *
+ * @param s the surface to draw on.
  * @param bm the bitmap to use as font
  * @param x x pos
  * @param y y pos
@@ -439,15 +1910,15 @@ uint16_t bitmap_render_char(bitmap_t *bm, uint16_t x, uint16_t y, char ch, color
  *
  * @return width of the rendered string. For multi line string this is the width of the last line.
  */
-uint16_t bitmap_render_string(bitmap_t *bm, uint16_t x, uint16_t y, char *str, color_t c) {
-    uint16_t xPos = x;
-    uint16_t yPos = y;
+uint16_t bitmap_surface_render_string(surface_t *s, bitmap_t *bm, int16_t x, int16_t y, char *str, color_t c) {
+    int16_t xPos = x;
+    int16_t yPos = y;
     while (*str) {
         if (*str == '\n') {
             xPos = x;
             yPos += bm->height;
         } else if (*str != '\r') {
-            xPos += bitmap_render_char(bm, xPos, yPos, *str, c);
+            xPos += bitmap_surface_render_char(s, bm, xPos, yPos, *str, c);
         }
         str++;
     }
@@ -1,7 +1,7 @@
 /**
  * @file bitmap.c
  * @author SuperIlu (superilu@yahoo.com)
- * @brief BMP loading/saving/rendering incl. font rendering
+ * @brief BMP/PCX loading/saving, GIF loading and rendering incl. font rendering
  *
  * @copyright SuperIlu
  */
@@ -9,6 +9,7 @@
 #define __BITMAP_H_
 
 #include <stdint.h>
+#include <stdio.h>
 
 #include "vga.h"
 
@@ -22,8 +23,48 @@ typedef struct __bitmap {
     uint8_t *data;             // pointer to bitmap data
 } bitmap_t;
 
+#define GIF_MAX_CODES 4096         //!< number of LZW codes with 12 bits
+#define GIF_BUFFER_SIZE 2048       //!< GIF files are read in blocks of this size
+#define GIF_NO_TRANSPARENT (-1)    //!< the frame has no transparent color
+
+//! a GIF that is decoded one frame at a time
+typedef struct __bitmap_gif {
+    FILE *f;                                 //!< the file
+    bitmap_t *bm;                            //!< the canvas with the current frame and its palette
+    uint32_t frame1;                         //!< file offset of the first frame
+    uint16_t frame;                          //!< number of the current frame, starting with 1
+    uint16_t delay;                          //!< display time of the current frame in ms, 0 if not specified
+    uint8_t background;                      //!< background color
+    palette_color_t global[VGA_MAX_COLORS];  //!< global color table
+    uint16_t next_delay;                     //!< display time of the next frame in ms
+    uint8_t next_disposal;                   //!< disposal method of the next frame
+    int16_t transparent;                     //!< transparent color of the next frame or GIF_NO_TRANSPARENT
+    uint8_t disposal;                        //!< disposal method of the current frame
+    uint16_t left;                           //!< area of the current frame on the canvas
+    uint16_t top;                            //!< area of the current frame on the canvas
+    uint16_t width;                          //!< area of the current frame on the canvas
+    uint16_t height;                         //!< area of the current frame on the canvas
+    uint8_t *previous;                       //!< the canvas under the current frame if it must be restored
+    uint16_t prefix[GIF_MAX_CODES];          //!< LZW table: previous code of every code
+    uint8_t suffix[GIF_MAX_CODES];           //!< LZW table: last pixel of every code
+    uint8_t stack[GIF_MAX_CODES];            //!< pixels of the current code in reverse order
+    uint16_t pos;                            //!< index of the next byte in buf
+    uint16_t len;                            //!< number of bytes in buf
+    uint8_t buf[GIF_BUFFER_SIZE];            //!< read buffer
+} bitmap_gif_t;
+
 extern bitmap_t *bitmap_load(char *fname, bool palette);
 extern bool bitmap_save(bitmap_t *bm, const char *fname);
+extern bool bitmap_load_screen(char *fname, uint16_t x, uint16_t y, bool palette);
+extern bool bitmap_save_rle(bitmap_t *bm, const char *fname);
+extern bool bitmap_save_screen(const char *fname, uint16_t x, uint16_t y, uint16_t width, uint16_t height, bool rle);
+extern bitmap_t *bitmap_load_pcx(char *fname, bool palette);
+extern bool bitmap_load_pcx_screen(char *fname, uint16_t x, uint16_t y, bool palette);
+extern bool bitmap_save_pcx(bitmap_t *bm, const char *fname);
+extern bitmap_t *bitmap_load_gif(char *fname, bool palette);
+extern bitmap_gif_t *bitmap_gif_open(char *fname);
+extern bool bitmap_gif_frame(bitmap_gif_t *g);
+extern void bitmap_gif_close(bitmap_gif_t *g);
 extern bitmap_t *bitmap_create(uint16_t width, uint16_t height, uint16_t palette);
 extern bitmap_t *bitmap_copy(uint16_t x, uint16_t y, uint16_t width, uint16_t height, bool palette);
 extern void bitmap_set_color(bitmap_t *bm, uint8_t idx, palette_color_t *color);
@@ -31,5 +72,9 @@ extern void bitmap_free(bitmap_t *bm);
 extern bool bitmap_draw(bitmap_t *bm, uint16_t x, uint16_t y, bool apply_colors);
 extern uint16_t bitmap_render_char(bitmap_t *bm, uint16_t x, uint16_t y, char ch, color_t c);
 extern uint16_t bitmap_render_string(bitmap_t *bm, uint16_t x, uint16_t y, char *str, color_t c);
+extern void bitmap_get_surface(bitmap_t *bm, surface_t *s);
+extern void bitmap_surface_draw(surface_t *s, bitmap_t *bm, int16_t x, int16_t y);
+extern uint16_t bitmap_surface_render_char(surface_t *s, bitmap_t *bm, int16_t x, int16_t y, char ch, color_t c);
+extern uint16_t bitmap_surface_render_string(surface_t *s, bitmap_t *bm, int16_t x, int16_t y, char *str, color_t c);
 
 #endif  // __BITMAP_H_
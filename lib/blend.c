@@ -0,0 +1,393 @@
+/**
+ * @file blend.c
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief translucency lookup tables and blended drawing.
+ *
+ * @copyright SuperIlu
+ *
+ * A blend table maps every pair of source and destination colors to the palette entry that is closest to their mix, so
+ * drawing translucent pixels costs one table lookup per pixel instead of RGB maths. Building a table searches the palette
+ * 65536 times and takes a while on old machines, tables should be created once and stored with blend_save().
+ * A table only matches the palette it was built for.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "blend.h"
+#include "modex.h"
+#include "error.h"
+
+/* ======================================================================
+** private functions
+** ====================================================================== */
+/**
+ * @brief allocate an empty table.
+ *
+ * @return a new table or NULL if out of memory.
+ */
+static blend_t *blend_alloc(void) {
+    blend_t *bt;
+    uint16_t i;
+
+    bt = calloc(sizeof(blend_t), 1);
+    if (!bt) {
+        ERR_NOMEM();
+        return NULL;
+    }
+    for (i = 0; i < BLEND_BLOCKS; i++) {
+        bt->blocks[i] = malloc(BLEND_BLOCK_SIZE);
+        if (!bt->blocks[i]) {
+            blend_free(bt);
+            ERR_NOMEM();
+            return NULL;
+        }
+    }
+    for (i = 0; i < VGA_MAX_COLORS; i++) {
+        bt->rows[i] = &bt->blocks[i / BLEND_BLOCK_ROWS][(i % BLEND_BLOCK_ROWS) * VGA_MAX_COLORS];
+    }
+    return bt;
+}
+
+/**
+ * @brief mix one channel.
+ *
+ * @param src source value.
+ * @param dst destination value.
+ * @param alpha weight of the source in 1/256.
+ * @param additive true to add the weighted source to the destination.
+ *
+ * @return the mixed value.
+ */
+static int16_t blend_channel(uint8_t src, uint8_t dst, uint16_t alpha, bool additive) {
+    uint16_t v;
+
+    if (additive) {
+        v = dst + (((uint16_t)src * alpha) >> 8);
+        return v > 255 ? 255 : v;
+    } else {
+        return ((uint16_t)src * alpha + (uint16_t)dst * (BLEND_FULL - alpha) + 128) >> 8;
+    }
+}
+
+/* ======================================================================
+** public functions
+** ====================================================================== */
+/**
+ * @brief find the palette entry closest to a color.
+ *
+ * @param palette VGA_MAX_COLORS colors.
+ * @param r red
+ * @param g green
+ * @param b blue
+ *
+ * @return the index of the closest color.
+ */
+uint8_t blend_nearest(palette_color_t *palette, int16_t r, int16_t g, int16_t b) {
+    uint32_t dist, best_dist = 0xFFFFFFFFUL;
+    uint16_t i, best = 0;
+    int16_t d;
+
+    for (i = 0; i < VGA_MAX_COLORS; i++) {
+        d = palette[i].red - r;
+        dist = (int32_t)d * d;
+        if (dist >= best_dist) {
+            continue;
+        }
+        d = palette[i].green - g;
+        dist += (int32_t)d * d;
+        if (dist >= best_dist) {
+            continue;
+        }
+        d = palette[i].blue - b;
+        dist += (int32_t)d * d;
+        if (dist < best_dist) {
+            best_dist = dist;
+            best = i;
+            if (!dist) {
+                break;
+            }
+        }
+    }
+    return (uint8_t)best;
+}
+
+/**
+ * @brief build a blend table for a palette.
+ *
+ * @param palette VGA_MAX_COLORS colors.
+ * @param alpha weight of the source color in 1/256, e.g. BLEND_25, BLEND_50, BLEND_75 or BLEND_FULL.
+ * @param additive false to mix source and destination, true to add the weighted source to the destination.
+ *
+ * @return a new table or NULL if out of memory.
+ */
+blend_t *blend_create(palette_color_t *palette, uint16_t alpha, bool additive) {
+    blend_t *bt;
+    uint16_t src, dst;
+    bool symmetric = additive ? (alpha == BLEND_FULL) : (alpha == BLEND_50);
+
+    if (alpha > BLEND_FULL) {
+        ERR_PARAM();
+        return NULL;
+    }
+
+    bt = blend_alloc();
+    if (!bt) {
+        return NULL;
+    }
+
+    for (src = 0; src < VGA_MAX_COLORS; src++) {
+        for (dst = 0; dst < VGA_MAX_COLORS; dst++) {
+            if (symmetric && (dst < src)) {
+                bt->rows[src][dst] = bt->rows[dst][src];
+            } else {
+                bt->rows[src][dst] = blend_nearest(palette, blend_channel(palette[src].red, palette[dst].red, alpha, additive),
+                                                   blend_channel(palette[src].green, palette[dst].green, alpha, additive),
+                                                   blend_channel(palette[src].blue, palette[dst].blue, alpha, additive));
+            }
+        }
+    }
+
+    ERR_OK();
+    return bt;
+}
+
+/**
+ * @brief load a table written by blend_save().
+ *
+ * @param fname file name
+ *
+ * @return a new table or NULL if loading fails.
+ */
+blend_t *blend_load(const char *fname) {
+    blend_t *bt;
+    FILE *f;
+    uint16_t i;
+
+    f = fopen(fname, "rb");
+    if (!f) {
+        ERR_NOENT();
+        return NULL;
+    }
+
+    bt = blend_alloc();
+    if (!bt) {
+        fclose(f);
+        return NULL;
+    }
+
+    for (i = 0; i < BLEND_BLOCKS; i++) {
+        if (fread(bt->blocks[i], BLEND_BLOCK_SIZE, 1, f) != 1) {
+            ERR_IOERR();
+            blend_free(bt);
+            fclose(f);
+            return NULL;
+        }
+    }
+
+    fclose(f);
+    ERR_OK();
+    return bt;
+}
+
+/**
+ * @brief save a table to disk. The file contains the 64KB of the table without any header.
+ *
+ * @param bt the table.
+ * @param fname file name
+ *
+ * @return true if the table could be saved, else false.
+ */
+bool blend_save(blend_t *bt, const char *fname) {
+    FILE *f;
+    uint16_t i;
+
+    f = fopen(fname, "wb");
+    if (!f) {
+        ERR_CREAT();
+        return false;
+    }
+
+    for (i = 0; i < BLEND_BLOCKS; i++) {
+        if (fwrite(bt->blocks[i], BLEND_BLOCK_SIZE, 1, f) != 1) {
+            ERR_IOERR();
+            fclose(f);
+            remove(fname);
+            return false;
+        }
+    }
+
+    fclose(f);
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief free a table.
+ *
+ * @param bt the table.
+ */
+void blend_free(blend_t *bt) {
+    uint16_t i;
+
+    if (bt) {
+        for (i = 0; i < BLEND_BLOCKS; i++) {
+            if (bt->blocks[i]) {
+                free(bt->blocks[i]);
+                bt->blocks[i] = NULL;
+            }
+        }
+        free(bt);
+    }
+}
+
+/**
+ * @brief blend a row of pixels onto a surface, no clipping is done.
+ *
+ * @param s the surface.
+ * @param bt the blend table.
+ * @param x x pos of the first pixel
+ * @param y y pos
+ * @param src source pixels
+ * @param len number of pixels
+ */
+void blend_surface_span(surface_t *s, blend_t *bt, int16_t x, int16_t y, const uint8_t *src, uint16_t len) {
+    uint8_t *dst;
+    uint16_t i;
+
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        for (i = 0; i < len; i++, x++) {
+            modex_put_pixel(s, x, y, bt->rows[src[i]][modex_get_pixel(s, x, y)]);
+        }
+    } else {
+        dst = &s->data[(uint16_t)y * s->stride + x];
+        for (i = 0; i < len; i++) {
+            dst[i] = bt->rows[src[i]][dst[i]];
+        }
+    }
+}
+
+/**
+ * @brief draw a translucent filled rectangle onto a surface. The rectangle is clipped to the clipping rectangle of the surface.
+ *
+ * @param s the surface.
+ * @param bt the blend table.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ * @param c the color.
+ */
+void blend_surface_filled_rect(surface_t *s, blend_t *bt, int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c) {
+    uint8_t *row = bt->rows[c], *dst;
+    int16_t temp, x;
+    uint16_t offset, width, i;
+
+    if (top > bottom) {
+        temp = top;
+        top = bottom;
+        bottom = temp;
+    }
+    if (left > right) {
+        temp = left;
+        left = right;
+        right = temp;
+    }
+
+    if (left < s->clip.left) {
+        left = s->clip.left;
+    }
+    if (right > s->clip.right) {
+        right = s->clip.right;
+    }
+    if (top < s->clip.top) {
+        top = s->clip.top;
+    }
+    if (bottom > s->clip.bottom) {
+        bottom = s->clip.bottom;
+    }
+    if ((left > right) || (top > bottom)) {
+        return;
+    }
+
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        for (temp = top; temp <= bottom; temp++) {
+            for (x = left; x <= right; x++) {
+                modex_put_pixel(s, x, temp, row[modex_get_pixel(s, x, temp)]);
+            }
+        }
+    } else {
+        width = right - left + 1;
+        offset = (uint16_t)top * s->stride + left;
+        for (temp = top; temp <= bottom; temp++, offset += s->stride) {
+            dst = &s->data[offset];
+            for (i = 0; i < width; i++) {
+                dst[i] = row[dst[i]];
+            }
+        }
+    }
+    vga_surface_dirty(s, left, top, right, bottom);
+}
+
+/**
+ * @brief draw a translucent filled rectangle on screen.
+ *
+ * @param bt the blend table.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ * @param c the color.
+ */
+void blend_filled_rect(blend_t *bt, int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c) {
+    blend_surface_filled_rect(vga_screen(), bt, left, top, right, bottom, c);
+}
+
+/**
+ * @brief draw a translucent bitmap onto a surface. The bitmap is clipped to the clipping rectangle of the surface.
+ *
+ * @param s the surface.
+ * @param bt the blend table.
+ * @param bm the bitmap.
+ * @param x x pos
+ * @param y y pos
+ */
+void blend_surface_bitmap(surface_t *s, blend_t *bt, bitmap_t *bm, int16_t x, int16_t y) {
+    int16_t left = x, top = y, right = x + bm->width - 1, bottom = y + bm->height - 1;
+    uint16_t bitmap_offset, width;
+
+    if (left < s->clip.left) {
+        left = s->clip.left;
+    }
+    if (top < s->clip.top) {
+        top = s->clip.top;
+    }
+    if (right > s->clip.right) {
+        right = s->clip.right;
+    }
+    if (bottom > s->clip.bottom) {
+        bottom = s->clip.bottom;
+    }
+    if ((left > right) || (top > bottom)) {
+        return;
+    }
+
+    bitmap_offset = (uint16_t)(top - y) * bm->width + (left - x);
+    width = right - left + 1;
+
+    for (y = top; y <= bottom; y++) {
+        blend_surface_span(s, bt, left, y, &bm->data[bitmap_offset], width);
+        bitmap_offset += bm->width;
+    }
+    vga_surface_dirty(s, left, top, right, bottom);
+}
+
+/**
+ * @brief draw a translucent bitmap on screen. The bitmap is clipped to the screen.
+ *
+ * @param bt the blend table.
+ * @param bm the bitmap.
+ * @param x x pos
+ * @param y y pos
+ */
+void blend_bitmap_draw(blend_t *bt, bitmap_t *bm, int16_t x, int16_t y) { blend_surface_bitmap(vga_screen(), bt, bm, x, y); }
@@ -0,0 +1,52 @@
+/**
+ * @file blend.h
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief translucency lookup tables and blended drawing.
+ *
+ * @copyright SuperIlu
+ */
+#ifndef __BLEND_H_
+#define __BLEND_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vga.h"
+#include "bitmap.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define BLEND_25 64     //!< 25% source, 75% destination
+#define BLEND_50 128    //!< 50% source, 50% destination
+#define BLEND_75 192    //!< 75% source, 25% destination
+#define BLEND_FULL 256  //!< 100% source, use with additive tables
+
+#define BLEND_BLOCKS 4                                  //!< number of allocations a table is split into
+#define BLEND_BLOCK_ROWS (VGA_MAX_COLORS / BLEND_BLOCKS)  //!< number of table rows in each allocation
+#define BLEND_BLOCK_SIZE (BLEND_BLOCK_ROWS * VGA_MAX_COLORS)  //!< size of each allocation in bytes
+
+/* ======================================================================
+** typedefs
+** ====================================================================== */
+//! a 256x256 color mixing table, rows[src][dst] is the palette entry closest to the mix of src and dst
+typedef struct __blend {
+    uint8_t *rows[VGA_MAX_COLORS];    //!< one row of VGA_MAX_COLORS entries for every source color
+    uint8_t *blocks[BLEND_BLOCKS];    //!< the 64KB table does not fit into one allocation, the rows point into these blocks
+} blend_t;
+
+/* ======================================================================
+** prototypes
+** ====================================================================== */
+extern uint8_t blend_nearest(palette_color_t *palette, int16_t r, int16_t g, int16_t b);
+extern blend_t *blend_create(palette_color_t *palette, uint16_t alpha, bool additive);
+extern blend_t *blend_load(const char *fname);
+extern bool blend_save(blend_t *bt, const char *fname);
+extern void blend_free(blend_t *bt);
+extern void blend_surface_span(surface_t *s, blend_t *bt, int16_t x, int16_t y, const uint8_t *src, uint16_t len);
+extern void blend_surface_filled_rect(surface_t *s, blend_t *bt, int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c);
+extern void blend_filled_rect(blend_t *bt, int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c);
+extern void blend_surface_bitmap(surface_t *s, blend_t *bt, bitmap_t *bm, int16_t x, int16_t y);
+extern void blend_bitmap_draw(blend_t *bt, bitmap_t *bm, int16_t x, int16_t y);
+
+#endif  // __BLEND_H_
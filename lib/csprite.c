@@ -0,0 +1,270 @@
+/**
+ * @file csprite.c
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief compiled sprites: transparent images turned into a stream of immediate stores.
+ *
+ * @copyright SuperIlu
+ *
+ * The builder emits one 8086 instruction for every opaque pixel (or pair of adjacent opaque pixels):
+ *   mov byte ptr es:[di + offset], color   26 C6 85 <offset16> <color>
+ *   mov word ptr es:[di + offset], colors  26 C7 85 <offset16> <color> <color>
+ * followed by a "retf" (CB). Transparent pixels simply produce no instruction. The offsets are calculated for a fixed stride.
+ *
+ * With 16bit OpenWatcom the code is called directly with ES:DI pointing to the destination. All other compilers
+ * use csprite_run() which interprets the same instruction stream, so both produce identical output.
+ * Sprites crossing the clipping rectangle or drawn onto surfaces with another stride are always interpreted pixel by pixel.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "csprite.h"
+#include "error.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define CSPRITE_ES 0x26          //!< ES segment override prefix
+#define CSPRITE_MOV_BYTE 0xC6    //!< mov r/m8, imm8
+#define CSPRITE_MOV_WORD 0xC7    //!< mov r/m16, imm16
+#define CSPRITE_MODRM_DI 0x85    //!< ModR/M for [di + disp16]
+#define CSPRITE_RETF 0xCB        //!< return far
+#define CSPRITE_BYTE_SIZE 6      //!< size of a byte store
+#define CSPRITE_WORD_SIZE 7      //!< size of a word store
+#define CSPRITE_MAX_SIZE 0xFFF0UL  //!< max size of the generated code
+
+#if defined(__WATCOMC__) && defined(__I86__)
+/**
+ * @brief call a compiled sprite with ES:DI pointing to the destination.
+ */
+extern void csprite_call(uint8_t *dst, uint8_t *code);
+#pragma aux csprite_call = \
+    "push dx"              \
+    "push ax"              \
+    "mov bx, sp"           \
+    "call dword ptr ss:[bx]" \
+    "add sp, 4"            \
+    parm[es di][dx ax] modify[bx];
+
+#define CSPRITE_NATIVE  //!< compiled sprites are executed directly
+#endif
+
+/* ======================================================================
+** private functions
+** ====================================================================== */
+/**
+ * @brief generate the code for a sprite.
+ *
+ * @param pixels the image.
+ * @param width width of the image.
+ * @param height height of the image.
+ * @param key transparent color.
+ * @param stride scanline length of the destination.
+ * @param out buffer for the code or NULL to only calculate the size.
+ *
+ * @return size of the code in bytes.
+ */
+static uint32_t csprite_generate(const uint8_t *pixels, uint16_t width, uint16_t height, color_t key, uint16_t stride, uint8_t *out) {
+    uint32_t size = 0;
+    uint16_t x, y, offset;
+    const uint8_t *src;
+
+    for (y = 0; y < height; y++) {
+        src = &pixels[(uint16_t)y * width];
+        for (x = 0; x < width; x++) {
+            if (src[x] == key) {
+                continue;
+            }
+            offset = (uint16_t)y * stride + x;
+            if (out) {
+                out[size] = CSPRITE_ES;
+                out[size + 2] = CSPRITE_MODRM_DI;
+                out[size + 3] = offset & 0xFF;
+                out[size + 4] = offset >> 8;
+                out[size + 5] = src[x];
+            }
+            if ((x + 1 < width) && (src[x + 1] != key)) {
+                // two adjacent pixels with one store
+                if (out) {
+                    out[size + 1] = CSPRITE_MOV_WORD;
+                    out[size + 6] = src[x + 1];
+                }
+                size += CSPRITE_WORD_SIZE;
+                x++;
+            } else {
+                if (out) {
+                    out[size + 1] = CSPRITE_MOV_BYTE;
+                }
+                size += CSPRITE_BYTE_SIZE;
+            }
+        }
+    }
+    if (out) {
+        out[size] = CSPRITE_RETF;
+    }
+    return size + 1;
+}
+
+/**
+ * @brief interpret the code of a sprite and clip every pixel to the clipping rectangle of a surface.
+ *
+ * @param s the surface to draw on.
+ * @param cs the sprite.
+ * @param x x pos
+ * @param y y pos
+ */
+static void csprite_run_clipped(surface_t *s, csprite_t *cs, int16_t x, int16_t y) {
+    uint8_t *p = cs->code;
+    uint16_t offset;
+    int16_t px, py;
+    uint8_t n, i;
+
+    while (*p != CSPRITE_RETF) {
+        offset = p[3] | ((uint16_t)p[4] << 8);
+        n = p[1] == CSPRITE_MOV_WORD ? 2 : 1;
+        px = x + offset % cs->stride;
+        py = y + offset / cs->stride;
+        for (i = 0; i < n; i++, px++) {
+            if ((px >= s->clip.left) && (px <= s->clip.right) && (py >= s->clip.top) && (py <= s->clip.bottom)) {
+                vga_surface_put_pixel(s, px, py, p[5 + i]);
+            }
+        }
+        p += n == 2 ? CSPRITE_WORD_SIZE : CSPRITE_BYTE_SIZE;
+    }
+}
+
+/* ======================================================================
+** public functions
+** ====================================================================== */
+/**
+ * @brief compile a bitmap into a sprite.
+ *
+ * @param bm the bitmap.
+ * @param key the transparent color.
+ * @param stride scanline length of the surfaces the sprite is drawn on, e.g. VGA_SCREEN_WIDTH.
+ *
+ * @return a new sprite or NULL if out of memory or the code would be larger than 64KB.
+ */
+csprite_t *csprite_create(bitmap_t *bm, color_t key, uint16_t stride) { return csprite_create_raw(bm->data, bm->width, bm->height, key, stride); }
+
+/**
+ * @brief compile an image into a sprite.
+ *
+ * @param pixels the image, width * height bytes.
+ * @param width width of the image.
+ * @param height height of the image.
+ * @param key the transparent color.
+ * @param stride scanline length of the surfaces the sprite is drawn on, e.g. VGA_SCREEN_WIDTH.
+ *
+ * @return a new sprite or NULL if out of memory or the code would be larger than 64KB.
+ */
+csprite_t *csprite_create_raw(const uint8_t *pixels, uint16_t width, uint16_t height, color_t key, uint16_t stride) {
+    csprite_t *cs;
+    uint32_t size;
+
+    if ((width > stride) || ((uint32_t)height * stride > 0x10000UL)) {
+        ERR_PARAM();
+        return NULL;
+    }
+    size = csprite_generate(pixels, width, height, key, stride, NULL);
+    if (size > CSPRITE_MAX_SIZE) {
+        ERR_PARAM();
+        return NULL;
+    }
+
+    cs = calloc(sizeof(csprite_t), 1);
+    if (!cs) {
+        ERR_NOMEM();
+        return NULL;
+    }
+    cs->width = width;
+    cs->height = height;
+    cs->stride = stride;
+    cs->size = (uint16_t)size;
+    cs->code = malloc(cs->size);
+    if (!cs->code) {
+        csprite_free(cs);
+        ERR_NOMEM();
+        return NULL;
+    }
+    csprite_generate(pixels, width, height, key, stride, cs->code);
+
+    ERR_OK();
+    return cs;
+}
+
+/**
+ * @brief free a compiled sprite.
+ *
+ * @param cs the sprite.
+ */
+void csprite_free(csprite_t *cs) {
+    if (cs) {
+        if (cs->code) {
+            free(cs->code);
+            cs->code = NULL;
+        }
+        free(cs);
+    }
+}
+
+/**
+ * @brief portable interpreter for the generated code. No clipping is done.
+ *
+ * @param cs the sprite.
+ * @param dst destination of the top left pixel, the scanline length must be the stride the sprite was compiled for.
+ */
+void csprite_run(csprite_t *cs, uint8_t *dst) {
+    uint8_t *p = cs->code;
+    uint16_t offset;
+
+    while (*p != CSPRITE_RETF) {
+        offset = p[3] | ((uint16_t)p[4] << 8);
+        dst[offset] = p[5];
+        if (p[1] == CSPRITE_MOV_WORD) {
+            dst[offset + 1] = p[6];
+            p += CSPRITE_WORD_SIZE;
+        } else {
+            p += CSPRITE_BYTE_SIZE;
+        }
+    }
+}
+
+/**
+ * @brief draw a compiled sprite to the screen.
+ *
+ * @param cs the sprite.
+ * @param x x pos
+ * @param y y pos
+ */
+void csprite_draw(csprite_t *cs, int16_t x, int16_t y) { csprite_surface_draw(vga_screen(), cs, x, y); }
+
+/**
+ * @brief draw a compiled sprite onto a surface. The generated code is used if the sprite is completely inside the clipping rectangle
+ * of a linear surface with the stride the sprite was compiled for, else the sprite is clipped pixel by pixel.
+ *
+ * @param s the surface to draw on.
+ * @param cs the sprite.
+ * @param x x pos
+ * @param y y pos
+ */
+void csprite_surface_draw(surface_t *s, csprite_t *cs, int16_t x, int16_t y) {
+    int16_t right = x + cs->width - 1, bottom = y + cs->height - 1;
+    uint8_t *dst;
+
+    if ((right < s->clip.left) || (x > s->clip.right) || (bottom < s->clip.top) || (y > s->clip.bottom)) {
+        return;  // completely outside
+    }
+
+    if (!(s->flags & VGA_SURFACE_PLANAR) && (s->stride == cs->stride) && (x >= s->clip.left) && (right <= s->clip.right) && (y >= s->clip.top) &&
+        (bottom <= s->clip.bottom)) {
+        dst = &s->data[(uint16_t)y * s->stride + x];
+#ifdef CSPRITE_NATIVE
+        csprite_call(dst, cs->code);
+#else
+        csprite_run(cs, dst);
+#endif
+    } else {
+        csprite_run_clipped(s, cs, x, y);
+    }
+    vga_surface_dirty(s, x, y, right, bottom);
+}
@@ -0,0 +1,39 @@
+/**
+ * @file csprite.h
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief compiled sprites: transparent images turned into a stream of immediate stores.
+ *
+ * @copyright SuperIlu
+ */
+#ifndef __CSPRITE_H_
+#define __CSPRITE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vga.h"
+#include "bitmap.h"
+
+/* ======================================================================
+** typedefs
+** ====================================================================== */
+//! a compiled sprite
+typedef struct __csprite {
+    uint16_t width;   //!< width in pixels
+    uint16_t height;  //!< height in pixels
+    uint16_t stride;  //!< scanline length the code was generated for
+    uint16_t size;    //!< number of bytes in code
+    uint8_t *code;    //!< the generated 8086 code
+} csprite_t;
+
+/* ======================================================================
+** prototypes
+** ====================================================================== */
+extern csprite_t *csprite_create(bitmap_t *bm, color_t key, uint16_t stride);
+extern csprite_t *csprite_create_raw(const uint8_t *pixels, uint16_t width, uint16_t height, color_t key, uint16_t stride);
+extern void csprite_free(csprite_t *cs);
+extern void csprite_run(csprite_t *cs, uint8_t *dst);
+extern void csprite_draw(csprite_t *cs, int16_t x, int16_t y);
+extern void csprite_surface_draw(surface_t *s, csprite_t *cs, int16_t x, int16_t y);
+
+#endif  // __CSPRITE_H_
@@ -0,0 +1,510 @@
+/**
+ * @file dlist.c
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief display lists: record drawing commands and submit them at once.
+ *
+ * @copyright SuperIlu
+ *
+ * Commands are appended to a preallocated arena and executed by dl_submit(). A list can be submitted any number of times,
+ * e.g. to record a static frame once and replay it. Before the first submit the list is optimized:
+ * - commands completely covered by a later filled rectangle or bitmap are dropped.
+ * - commands are sorted by type. A command is only moved in front of another one if their bounding boxes do not overlap,
+ *   so the result is the same as drawing them in the recorded order.
+ * Filled rectangles and bitmaps on linear surfaces are drawn using a row offset table shared by all commands.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <mem.h>
+
+#include "dlist.h"
+#include "span.h"
+#include "error.h"
+
+/* ======================================================================
+** local variables
+** ====================================================================== */
+//! offset of each scanline for the stride in dl_rows_stride
+static uint16_t dl_rows[DL_MAX_ROWS];
+
+//! stride dl_rows was calculated for, 0 if not calculated yet
+static uint16_t dl_rows_stride = 0;
+
+/* ======================================================================
+** private functions
+** ====================================================================== */
+/**
+ * @brief append a command to a display list.
+ *
+ * @param dl the display list.
+ * @param type the command type.
+ * @param a first coordinate.
+ * @param b second coordinate.
+ * @param c third coordinate.
+ * @param d fourth coordinate.
+ * @param color color index.
+ *
+ * @return pointer to the new command or NULL if the list is full.
+ */
+static dl_cmd_t *dl_add(dlist_t *dl, dl_type_t type, int16_t a, int16_t b, int16_t c, int16_t d, color_t color) {
+    dl_cmd_t *cmd;
+
+    if (dl->num_cmds >= dl->max_cmds) {
+        ERR_NOMEM();
+        return NULL;
+    }
+    cmd = &dl->cmds[dl->num_cmds++];
+    cmd->type = type;
+    cmd->color = color;
+    cmd->a = a;
+    cmd->b = b;
+    cmd->c = c;
+    cmd->d = d;
+    cmd->bm = NULL;
+    cmd->text = 0;
+    dl->optimized = false;
+
+    ERR_OK();
+    return cmd;
+}
+
+/**
+ * @brief calculate the bounding box of a command.
+ *
+ * @param dl the display list.
+ * @param cmd the command.
+ * @param r receives the bounding box.
+ */
+static void dl_bounds(dlist_t *dl, dl_cmd_t *cmd, rect_t *r) {
+    const char *str;
+    uint16_t len = 0, max_len = 0, lines = 1;
+
+    switch (cmd->type) {
+        case DL_PIXEL:
+            r->left = r->right = cmd->a;
+            r->top = r->bottom = cmd->b;
+            break;
+        case DL_FILLED_CIRCLE:
+        case DL_CIRCLE:
+            r->left = cmd->a - cmd->c;
+            r->top = cmd->b - cmd->c;
+            r->right = cmd->a + cmd->c;
+            r->bottom = cmd->b + cmd->c;
+            break;
+        case DL_BLIT:
+            r->left = cmd->a;
+            r->top = cmd->b;
+            r->right = cmd->a + cmd->bm->width - 1;
+            r->bottom = cmd->b + cmd->bm->height - 1;
+            break;
+        case DL_TEXT:
+            for (str = &dl->text[cmd->text]; *str; str++) {
+                if (*str == '\n') {
+                    lines++;
+                    len = 0;
+                } else if ((*str != '\r') && (++len > max_len)) {
+                    max_len = len;
+                }
+            }
+            r->left = cmd->a;
+            r->top = cmd->b;
+            r->right = cmd->a + max_len * cmd->bm->ch_width;
+            r->bottom = cmd->b + lines * cmd->bm->height;
+            break;
+        default:  // lines and rectangles
+            r->left = cmd->a < cmd->c ? cmd->a : cmd->c;
+            r->top = cmd->b < cmd->d ? cmd->b : cmd->d;
+            r->right = cmd->a < cmd->c ? cmd->c : cmd->a;
+            r->bottom = cmd->b < cmd->d ? cmd->d : cmd->b;
+            break;
+    }
+}
+
+/**
+ * @brief check if a rectangle covers another one completely.
+ *
+ * @param outer the covering rectangle.
+ * @param inner the covered rectangle.
+ *
+ * @return true if inner is completely inside outer.
+ */
+static bool dl_contains(rect_t *outer, rect_t *inner) {
+    return (inner->left >= outer->left) && (inner->right <= outer->right) && (inner->top >= outer->top) && (inner->bottom <= outer->bottom);
+}
+
+/**
+ * @brief check if two rectangles overlap.
+ *
+ * @param a first rectangle.
+ * @param b second rectangle.
+ *
+ * @return true if at least one pixel is in both rectangles.
+ */
+static bool dl_overlaps(rect_t *a, rect_t *b) { return (a->left <= b->right) && (b->left <= a->right) && (a->top <= b->bottom) && (b->top <= a->bottom); }
+
+/**
+ * @brief drop occluded commands and sort the remaining ones by type without changing the visible result.
+ *
+ * @param dl the display list.
+ */
+static void dl_optimize(dlist_t *dl) {
+    uint16_t i, j, n = 0;
+    rect_t ri, rj;
+    dl_cmd_t cmd;
+    bool occluded;
+
+    // drop commands that are completely painted over by a later opaque command
+    for (i = 0; i < dl->num_cmds; i++) {
+        dl_bounds(dl, &dl->cmds[i], &ri);
+        occluded = false;
+        for (j = i + 1; j < dl->num_cmds; j++) {
+            if ((dl->cmds[j].type == DL_FILLED_RECT) || (dl->cmds[j].type == DL_BLIT)) {
+                dl_bounds(dl, &dl->cmds[j], &rj);
+                if (dl_contains(&rj, &ri)) {
+                    occluded = true;
+                    break;
+                }
+            }
+        }
+        if (!occluded) {
+            dl->cmds[n++] = dl->cmds[i];
+        }
+    }
+    dl->num_cmds = n;
+
+    // stable insertion sort by type, a command never passes one it overlaps
+    for (i = 1; i < dl->num_cmds; i++) {
+        cmd = dl->cmds[i];
+        dl_bounds(dl, &cmd, &ri);
+        for (j = i; j > 0; j--) {
+            if (dl->cmds[j - 1].type <= cmd.type) {
+                break;
+            }
+            dl_bounds(dl, &dl->cmds[j - 1], &rj);
+            if (dl_overlaps(&ri, &rj)) {
+                break;
+            }
+            dl->cmds[j] = dl->cmds[j - 1];
+        }
+        dl->cmds[j] = cmd;
+    }
+    dl->optimized = true;
+}
+
+/**
+ * @brief clip a rectangle to the clipping rectangle of a surface.
+ *
+ * @param s the surface.
+ * @param r the rectangle, modified.
+ *
+ * @return true if a part of the rectangle is visible.
+ */
+static bool dl_clip(surface_t *s, rect_t *r) {
+    if (r->left < s->clip.left) {
+        r->left = s->clip.left;
+    }
+    if (r->top < s->clip.top) {
+        r->top = s->clip.top;
+    }
+    if (r->right > s->clip.right) {
+        r->right = s->clip.right;
+    }
+    if (r->bottom > s->clip.bottom) {
+        r->bottom = s->clip.bottom;
+    }
+    return (r->left <= r->right) && (r->top <= r->bottom);
+}
+
+/**
+ * @brief draw a filled rectangle on a linear surface using the row offset table.
+ *
+ * @param s the surface.
+ * @param cmd the command.
+ */
+static void dl_filled_rect_rows(surface_t *s, dl_cmd_t *cmd) {
+    rect_t r;
+    uint16_t width;
+    int16_t y;
+
+    dl_bounds(NULL, cmd, &r);
+    if (!dl_clip(s, &r)) {
+        return;
+    }
+    width = r.right - r.left + 1;
+    for (y = r.top; y <= r.bottom; y++) {
+        span_fill(&s->data[dl_rows[y] + r.left], cmd->color, width);
+    }
+    vga_surface_dirty(s, r.left, r.top, r.right, r.bottom);
+}
+
+/**
+ * @brief draw a bitmap on a linear surface using the row offset table.
+ *
+ * @param s the surface.
+ * @param cmd the command.
+ */
+static void dl_blit_rows(surface_t *s, dl_cmd_t *cmd) {
+    rect_t r;
+    uint16_t width, offset;
+    int16_t y;
+
+    dl_bounds(NULL, cmd, &r);
+    if (!dl_clip(s, &r)) {
+        return;
+    }
+    width = r.right - r.left + 1;
+    offset = (uint16_t)(r.top - cmd->b) * cmd->bm->width + (r.left - cmd->a);
+    for (y = r.top; y <= r.bottom; y++, offset += cmd->bm->width) {
+        span_copy(&s->data[dl_rows[y] + r.left], &cmd->bm->data[offset], width);
+    }
+    vga_surface_dirty(s, r.left, r.top, r.right, r.bottom);
+}
+
+/* ======================================================================
+** public functions
+** ====================================================================== */
+/**
+ * @brief create a display list. Commands and strings are stored in a single allocation.
+ *
+ * @param max_cmds max number of commands.
+ * @param text_size number of bytes for the strings of dl_text() commands.
+ *
+ * @return a new display list or NULL if out of memory or the arena would be larger than 64KB.
+ */
+dlist_t *dl_create(uint16_t max_cmds, uint16_t text_size) {
+    uint32_t size = sizeof(dlist_t) + (uint32_t)max_cmds * sizeof(dl_cmd_t) + text_size;
+    dlist_t *dl;
+
+    if (!max_cmds || (size > 0xFFF0UL)) {
+        ERR_PARAM();
+        return NULL;
+    }
+    dl = malloc((size_t)size);
+    if (!dl) {
+        ERR_NOMEM();
+        return NULL;
+    }
+    dl->cmds = (dl_cmd_t *)(dl + 1);
+    dl->max_cmds = max_cmds;
+    dl->text = (char *)&dl->cmds[max_cmds];
+    dl->text_size = text_size;
+    dl_clear(dl);
+
+    ERR_OK();
+    return dl;
+}
+
+/**
+ * @brief free a display list.
+ *
+ * @param dl the display list.
+ */
+void dl_free(dlist_t *dl) {
+    if (dl) {
+        free(dl);
+    }
+}
+
+/**
+ * @brief remove all commands from a display list.
+ *
+ * @param dl the display list.
+ */
+void dl_clear(dlist_t *dl) {
+    dl->num_cmds = 0;
+    dl->text_used = 0;
+    dl->optimized = true;
+}
+
+/**
+ * @brief record a pixel.
+ *
+ * @param dl the display list.
+ * @param x x position.
+ * @param y y position.
+ * @param c color index.
+ *
+ * @return true if the command was recorded, false if the list is full.
+ */
+bool dl_pixel(dlist_t *dl, int16_t x, int16_t y, color_t c) { return dl_add(dl, DL_PIXEL, x, y, x, y, c) != NULL; }
+
+/**
+ * @brief record a line.
+ *
+ * @param dl the display list.
+ * @param x1 x start
+ * @param y1 y start
+ * @param x2 x end
+ * @param y2 y end
+ * @param c color index.
+ *
+ * @return true if the command was recorded, false if the list is full.
+ */
+bool dl_line(dlist_t *dl, int16_t x1, int16_t y1, int16_t x2, int16_t y2, color_t c) { return dl_add(dl, DL_LINE, x1, y1, x2, y2, c) != NULL; }
+
+/**
+ * @brief record a rectangle (outline).
+ *
+ * @param dl the display list.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ * @param c color index.
+ *
+ * @return true if the command was recorded, false if the list is full.
+ */
+bool dl_rect(dlist_t *dl, int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c) { return dl_add(dl, DL_RECT, left, top, right, bottom, c) != NULL; }
+
+/**
+ * @brief record a filled rectangle.
+ *
+ * @param dl the display list.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ * @param c color index.
+ *
+ * @return true if the command was recorded, false if the list is full.
+ */
+bool dl_filled_rect(dlist_t *dl, int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c) {
+    return dl_add(dl, DL_FILLED_RECT, left, top, right, bottom, c) != NULL;
+}
+
+/**
+ * @brief record a circle (outline).
+ *
+ * @param dl the display list.
+ * @param x center x position.
+ * @param y center y position.
+ * @param radius radius.
+ * @param c color index.
+ *
+ * @return true if the command was recorded, false if the list is full.
+ */
+bool dl_circle(dlist_t *dl, int16_t x, int16_t y, uint16_t radius, color_t c) { return dl_add(dl, DL_CIRCLE, x, y, radius, 0, c) != NULL; }
+
+/**
+ * @brief record a filled circle.
+ *
+ * @param dl the display list.
+ * @param x center x position.
+ * @param y center y position.
+ * @param radius radius.
+ * @param c color index.
+ *
+ * @return true if the command was recorded, false if the list is full.
+ */
+bool dl_filled_circle(dlist_t *dl, int16_t x, int16_t y, uint16_t radius, color_t c) { return dl_add(dl, DL_FILLED_CIRCLE, x, y, radius, 0, c) != NULL; }
+
+/**
+ * @brief record a bitmap. The bitmap is not copied and must stay valid until the list is cleared.
+ *
+ * @param dl the display list.
+ * @param bm the bitmap.
+ * @param x x pos
+ * @param y y pos
+ *
+ * @return true if the command was recorded, false if the list is full.
+ */
+bool dl_blit(dlist_t *dl, bitmap_t *bm, int16_t x, int16_t y) {
+    dl_cmd_t *cmd = dl_add(dl, DL_BLIT, x, y, 0, 0, 0);
+    if (cmd) {
+        cmd->bm = bm;
+    }
+    return cmd != NULL;
+}
+
+/**
+ * @brief record a string. The string is copied to the text arena, the font must stay valid until the list is cleared.
+ *
+ * @param dl the display list.
+ * @param font the bitmap to use as font.
+ * @param x x pos
+ * @param y y pos
+ * @param str the string.
+ * @param c color index.
+ *
+ * @return true if the command was recorded, false if the list or the text arena is full.
+ */
+bool dl_text(dlist_t *dl, bitmap_t *font, int16_t x, int16_t y, const char *str, color_t c) {
+    dl_cmd_t *cmd;
+    uint16_t len = 0;
+
+    // length including the terminating 0
+    while (str[len++]) {
+    }
+    if (len > dl->text_size - dl->text_used) {
+        ERR_NOMEM();
+        return false;
+    }
+    cmd = dl_add(dl, DL_TEXT, x, y, 0, 0, c);
+    if (cmd) {
+        cmd->bm = font;
+        cmd->text = dl->text_used;
+        memcpy(&dl->text[dl->text_used], str, len);
+        dl->text_used += len;
+    }
+    return cmd != NULL;
+}
+
+/**
+ * @brief draw all commands of a display list onto a surface. The list is kept and can be submitted again.
+ *
+ * @param dl the display list.
+ * @param s the surface to draw on.
+ */
+void dl_submit(dlist_t *dl, surface_t *s) {
+    uint16_t i;
+    dl_cmd_t *cmd;
+    bool rows = !(s->flags & VGA_SURFACE_PLANAR) && (s->height <= DL_MAX_ROWS);
+
+    if (!dl->optimized) {
+        dl_optimize(dl);
+    }
+
+    if (rows && (dl_rows_stride != s->stride)) {
+        for (i = 0; i < DL_MAX_ROWS; i++) {
+            dl_rows[i] = i * s->stride;
+        }
+        dl_rows_stride = s->stride;
+    }
+
+    for (i = 0; i < dl->num_cmds; i++) {
+        cmd = &dl->cmds[i];
+        switch (cmd->type) {
+            case DL_FILLED_RECT:
+                if (rows) {
+                    dl_filled_rect_rows(s, cmd);
+                } else {
+                    vga_surface_filled_rect(s, cmd->a, cmd->b, cmd->c, cmd->d, cmd->color);
+                }
+                break;
+            case DL_BLIT:
+                if (rows) {
+                    dl_blit_rows(s, cmd);
+                } else {
+                    bitmap_surface_draw(s, cmd->bm, cmd->a, cmd->b);
+                }
+                break;
+            case DL_FILLED_CIRCLE:
+                vga_surface_filled_circle(s, cmd->a, cmd->b, cmd->c, cmd->color);
+                break;
+            case DL_CIRCLE:
+                vga_surface_circle(s, cmd->a, cmd->b, cmd->c, cmd->color);
+                break;
+            case DL_RECT:
+                vga_surface_rect(s, cmd->a, cmd->b, cmd->c, cmd->d, cmd->color);
+                break;
+            case DL_LINE:
+                vga_surface_line(s, cmd->a, cmd->b, cmd->c, cmd->d, cmd->color);
+                break;
+            case DL_PIXEL:
+                vga_surface_set_pixel(s, cmd->a, cmd->b, cmd->color);
+                break;
+            case DL_TEXT:
+                bitmap_surface_render_string(s, cmd->bm, cmd->a, cmd->b, &dl->text[cmd->text], cmd->color);
+                break;
+        }
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * @file dlist.h
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief display lists: record drawing commands and submit them at once.
+ *
+ * @copyright SuperIlu
+ */
+#ifndef __DLIST_H_
+#define __DLIST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vga.h"
+#include "bitmap.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define DL_MAX_ROWS 256  //!< surfaces up to this height use the shared row offset table
+
+/* ======================================================================
+** typedefs
+** ====================================================================== */
+//! command types, commands are sorted in this order when possible
+typedef enum __dl_type {
+    DL_FILLED_RECT = 0,    // filled rectangle
+    DL_BLIT = 1,           // bitmap
+    DL_FILLED_CIRCLE = 2,  // filled circle
+    DL_CIRCLE = 3,         // circle outline
+    DL_RECT = 4,           // rectangle outline
+    DL_LINE = 5,           // line
+    DL_PIXEL = 6,          // single pixel
+    DL_TEXT = 7            // string rendered with a bitmap font
+} dl_type_t;
+
+//! a recorded drawing command
+typedef struct __dl_cmd {
+    uint8_t type;   //!< dl_type_t
+    color_t color;  //!< color index
+    int16_t a;      //!< x/left/x1
+    int16_t b;      //!< y/top/y1
+    int16_t c;      //!< right/x2/radius
+    int16_t d;      //!< bottom/y2
+    bitmap_t *bm;   //!< bitmap for DL_BLIT, font for DL_TEXT
+    uint16_t text;  //!< offset of the string in the text arena for DL_TEXT
+} dl_cmd_t;
+
+//! a display list, commands and strings live in one preallocated arena
+typedef struct __dlist {
+    dl_cmd_t *cmds;      //!< recorded commands
+    uint16_t num_cmds;   //!< number of recorded commands
+    uint16_t max_cmds;   //!< max number of commands
+    char *text;          //!< storage for the strings of DL_TEXT commands
+    uint16_t text_used;  //!< bytes used in text
+    uint16_t text_size;  //!< size of text
+    bool optimized;      //!< true if occluded commands were dropped and the list was sorted
+} dlist_t;
+
+/* ======================================================================
+** prototypes
+** ====================================================================== */
+extern dlist_t *dl_create(uint16_t max_cmds, uint16_t text_size);
+extern void dl_free(dlist_t *dl);
+extern void dl_clear(dlist_t *dl);
+extern bool dl_pixel(dlist_t *dl, int16_t x, int16_t y, color_t c);
+extern bool dl_line(dlist_t *dl, int16_t x1, int16_t y1, int16_t x2, int16_t y2, color_t c);
+extern bool dl_rect(dlist_t *dl, int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c);
+extern bool dl_filled_rect(dlist_t *dl, int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c);
+extern bool dl_circle(dlist_t *dl, int16_t x, int16_t y, uint16_t radius, color_t c);
+extern bool dl_filled_circle(dlist_t *dl, int16_t x, int16_t y, uint16_t radius, color_t c);
+extern bool dl_blit(dlist_t *dl, bitmap_t *bm, int16_t x, int16_t y);
+extern bool dl_text(dlist_t *dl, bitmap_t *font, int16_t x, int16_t y, const char *str, color_t c);
+extern void dl_submit(dlist_t *dl, surface_t *s);
+
+#endif  // __DLIST_H_
@@ -21,5 +21,6 @@ typedef long fixed16_16;  //!< used for fixed-point math
 #define TO_FIXED(x) ((x)*FIXED_POINT_FACTOR)
 #define FROM_FIXED_F(x) (((float)x) / FIXED_POINT_FACTOR)
 #define FROM_FIXED_I(x) ((x) / FIXED_POINT_FACTOR)
+#define FROM_FIXED_CEIL(x) (((x) + (FIXED_POINT_FACTOR - 1)) >> 16)
 
 #endif  // __FIXED_H_
@@ -0,0 +1,1259 @@
+/**
+ * @file flc.c
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief record the screen into delta compressed FLC animations and play FLI/FLC animations.
+ *
+ * Only the scanline ranges that changed since the last frame are diffed and encoded. With a back buffer
+ * (vga_begin_frame()) the search is limited to the dirty rectangles, so flc_frame() must be called before vga_present().
+ *
+ * @copyright SuperIlu
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <mem.h>
+
+#include "error.h"
+#include "flc.h"
+#include "util.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define FLC_HEADER_SIZE 128  //!< size of the file header
+#define FLC_FRAME_SIZE 16    //!< size of a frame chunk header
+#define FLC_CHUNK_SIZE 6     //!< size of a sub chunk header
+#define FLC_READ_MASK (FLC_BUFFER_SIZE * 2 - 1)  //!< wraps indices into the read buffer
+
+#define FLC_FLI_TYPE 0xAF11    //!< file type for FLI
+#define FLC_TYPE 0xAF12        //!< file type for FLC
+#define FLC_FINISHED 3         //!< header flags of a completely written and updated file
+#define FLC_FRAME_TYPE 0xF1FA  //!< frame chunk
+#define FLC_COLOR_256 4        //!< palette chunk with 8bit components
+#define FLC_DELTA_FLC 7        //!< word oriented line delta chunk
+#define FLC_COLOR_64 11        //!< palette chunk with 6bit components (FLI)
+#define FLC_LC 12              //!< byte oriented line delta chunk (FLI)
+#define FLC_BLACK 13           //!< all pixels are 0
+#define FLC_BRUN 15            //!< byte run length compressed full frame
+#define FLC_COPY 16            //!< uncompressed full frame
+
+#define FLC_MAX_PACKET 127  //!< max number of bytes/words in a run length packet
+#define FLC_MAX_SKIP 255    //!< max number of pixels a delta packet can skip
+#define FLC_MIN_RUN 3       //!< shorter runs are stored as literals
+#define FLC_FLI_JIFFIES 70  //!< FLI speed is in 1/70 seconds
+
+//! compare a word of two scanlines
+#define FLC_SAME_WORD(a, b, x) (*(const uint16_t *)&(a)[x] == *(const uint16_t *)&(b)[x])
+
+/* ======================================================================
+** global variables
+** ====================================================================== */
+uint32_t flc_last_size = 0;  //!< number of bytes written by the last call to flc_frame()
+
+/* ======================================================================
+** local variables
+** ====================================================================== */
+static palette_color_t flc_dac[VGA_MAX_COLORS];  //!< the current DAC content
+
+/* ======================================================================
+** private functions
+** ====================================================================== */
+/**
+ * @brief current write position in the file.
+ *
+ * @param flc the recording.
+ *
+ * @return file offset of the next byte.
+ */
+static uint32_t flc_tell(flc_t *flc) { return flc->buf_pos + flc->buf_len; }
+
+/**
+ * @brief write the buffered data to disk.
+ *
+ * @param flc the recording.
+ */
+static void flc_flush(flc_t *flc) {
+    if (flc->buf_len && !flc->failed) {
+        if (fwrite(flc->buf, flc->buf_len, 1, flc->f) != 1) {
+            flc->failed = true;
+        }
+    }
+    flc->buf_pos += flc->buf_len;
+    flc->buf_len = 0;
+}
+
+/**
+ * @brief append data to the file.
+ *
+ * @param flc the recording.
+ * @param data the bytes to write.
+ * @param len number of bytes.
+ */
+static void flc_put(flc_t *flc, const uint8_t *data, uint16_t len) {
+    uint16_t n;
+
+    while (len) {
+        if (flc->buf_len == FLC_BUFFER_SIZE) {
+            flc_flush(flc);
+        }
+        n = FLC_BUFFER_SIZE - flc->buf_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(&flc->buf[flc->buf_len], data, n);
+        flc->buf_len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief append a byte to the file.
+ *
+ * @param flc the recording.
+ * @param v the value.
+ */
+static void flc_put8(flc_t *flc, uint8_t v) {
+    if (flc->buf_len == FLC_BUFFER_SIZE) {
+        flc_flush(flc);
+    }
+    flc->buf[flc->buf_len++] = v;
+}
+
+/**
+ * @brief append a little endian word to the file.
+ *
+ * @param flc the recording.
+ * @param v the value.
+ */
+static void flc_put16(flc_t *flc, uint16_t v) {
+    flc_put8(flc, v & 0xFF);
+    flc_put8(flc, v >> 8);
+}
+
+/**
+ * @brief append a little endian double word to the file.
+ *
+ * @param flc the recording.
+ * @param v the value.
+ */
+static void flc_put32(flc_t *flc, uint32_t v) {
+    flc_put16(flc, v & 0xFFFF);
+    flc_put16(flc, v >> 16);
+}
+
+/**
+ * @brief overwrite a little endian value that was already written, e.g. the size of a chunk.
+ * Bytes still in the write buffer are changed in memory, bytes already on disk are rewritten in place.
+ *
+ * @param flc the recording.
+ * @param pos file offset of the value.
+ * @param v the value.
+ * @param bytes size of the value in bytes.
+ */
+static void flc_patch(flc_t *flc, uint32_t pos, uint32_t v, uint8_t bytes) {
+    for (; bytes; bytes--, pos++, v >>= 8) {
+        if (pos >= flc->buf_pos) {
+            flc->buf[pos - flc->buf_pos] = v & 0xFF;
+        } else if (!flc->failed) {
+            if (fseek(flc->f, pos, SEEK_SET) || (fputc(v & 0xFF, flc->f) == EOF) || fseek(flc->f, flc->buf_pos, SEEK_SET)) {
+                flc->failed = true;
+            }
+        }
+    }
+}
+
+/**
+ * @brief start a sub chunk, the size is written by flc_end_chunk().
+ *
+ * @param flc the recording.
+ * @param type chunk type.
+ *
+ * @return file offset of the chunk.
+ */
+static uint32_t flc_begin_chunk(flc_t *flc, uint16_t type) {
+    uint32_t start = flc_tell(flc);
+    flc_put32(flc, 0);
+    flc_put16(flc, type);
+    return start;
+}
+
+/**
+ * @brief finish a sub chunk, it is padded to an even size.
+ *
+ * @param flc the recording.
+ * @param start file offset of the chunk.
+ */
+static void flc_end_chunk(flc_t *flc, uint32_t start) {
+    if (flc_tell(flc) & 1) {
+        flc_put8(flc, 0);
+    }
+    flc_patch(flc, start, flc_tell(flc) - start, 4);
+}
+
+/**
+ * @brief write a COLOR_256 chunk with the colors that changed since the last frame.
+ *
+ * @param flc the recording.
+ * @param all true to write the whole palette.
+ *
+ * @return true if a chunk was written.
+ */
+static bool flc_color(flc_t *flc, bool all) {
+    uint16_t i, j, last, packets;
+    uint32_t start;
+
+    if (!all && (vga_palette_changes == flc->pal_changes)) {
+        return false;
+    }
+    flc->pal_changes = vga_palette_changes;
+    vga_get_palette(flc_dac, VGA_MAX_COLORS);
+    if (!all && !memcmp(flc_dac, flc->palette, sizeof(flc_dac))) {
+        return false;
+    }
+
+    start = flc_begin_chunk(flc, FLC_COLOR_256);
+    flc_put16(flc, 0);
+    last = 0;
+    packets = 0;
+    for (i = 0; i < VGA_MAX_COLORS;) {
+        if (!all && !memcmp(&flc_dac[i], &flc->palette[i], sizeof(palette_color_t))) {
+            i++;
+            continue;
+        }
+        j = i + 1;
+        while ((j < VGA_MAX_COLORS) && (all || memcmp(&flc_dac[j], &flc->palette[j], sizeof(palette_color_t)))) {
+            j++;
+        }
+
+        // skip, count (0 means 256), colors
+        flc_put8(flc, i - last);
+        flc_put8(flc, (j - i) & 0xFF);
+        for (; i < j; i++) {
+            flc_put8(flc, flc_dac[i].red);
+            flc_put8(flc, flc_dac[i].green);
+            flc_put8(flc, flc_dac[i].blue);
+            flc->palette[i] = flc_dac[i];
+        }
+        last = j;
+        packets++;
+    }
+    flc_patch(flc, start + FLC_CHUNK_SIZE, packets, 2);
+    flc_end_chunk(flc, start);
+    return true;
+}
+
+/**
+ * @brief write a BRUN chunk with the whole frame.
+ *
+ * @param flc the recording.
+ * @param src the frame.
+ */
+static void flc_brun(flc_t *flc, const uint8_t *src) {
+    uint32_t start;
+    uint16_t y;
+    int16_t x, n, len;
+    uint8_t *out, packets;
+
+    start = flc_begin_chunk(flc, FLC_BRUN);
+    for (y = 0; y < VGA_SCREEN_HEIGHT; y++, src += VGA_SCREEN_WIDTH) {
+        out = flc->line;
+        packets = 0;
+        for (x = 0; x < VGA_SCREEN_WIDTH; packets++) {
+            // positive count: replicate the next byte
+            for (n = 1; (x + n < VGA_SCREEN_WIDTH) && (n < FLC_MAX_PACKET) && (src[x + n] == src[x]); n++) {
+            }
+            if (n >= FLC_MIN_RUN) {
+                *out++ = n;
+                *out++ = src[x];
+                x += n;
+                continue;
+            }
+
+            // negative count: copy literal bytes up to the next run
+            for (n = 0; (x + n < VGA_SCREEN_WIDTH) && (n < FLC_MAX_PACKET); n++) {
+                if ((x + n + 2 < VGA_SCREEN_WIDTH) && (src[x + n] == src[x + n + 1]) && (src[x + n] == src[x + n + 2])) {
+                    break;
+                }
+            }
+            *out++ = (uint8_t)-n;
+            memcpy(out, &src[x], n);
+            out += n;
+            x += n;
+        }
+        len = out - flc->line;
+        flc_put8(flc, packets);  // obsolete, readers use the width
+        flc_put(flc, flc->line, len);
+    }
+    flc_end_chunk(flc, start);
+}
+
+/**
+ * @brief find the changed pixels of an area and widen the changed range of its scanlines.
+ *
+ * @param flc the recording.
+ * @param src the frame.
+ * @param r the area, must be on screen.
+ */
+static void flc_diff(flc_t *flc, const uint8_t *src, const rect_t *r) {
+    const uint8_t *a, *b;
+    int16_t x, y;
+
+    for (y = r->top; y <= r->bottom; y++) {
+        a = &src[y * VGA_SCREEN_WIDTH];
+        b = &flc->prev[y * VGA_SCREEN_WIDTH];
+
+        for (x = r->left; (x <= r->right) && (a[x] == b[x]); x++) {
+        }
+        if (x > r->right) {
+            continue;
+        }
+        if (x < flc->first[y]) {
+            flc->first[y] = x;
+        }
+
+        for (x = r->right; a[x] == b[x]; x--) {
+        }
+        if (x > flc->last[y]) {
+            flc->last[y] = x;
+        }
+    }
+}
+
+/**
+ * @brief encode the changed words of a scanline into DELTA_FLC packets in flc->line.
+ *
+ * @param flc the recording.
+ * @param src the scanline of the frame.
+ * @param prev the scanline of the last frame.
+ * @param first first changed pixel.
+ * @param last last changed pixel.
+ * @param packets number of packets is stored here.
+ *
+ * @return number of bytes in flc->line.
+ */
+static uint16_t flc_delta_line(flc_t *flc, const uint8_t *src, const uint8_t *prev, int16_t first, int16_t last, uint16_t *packets) {
+    uint8_t *out = flc->line;
+    int16_t pos, x, p, q, n, end;
+    uint8_t skip;
+
+    *packets = 0;
+    pos = 0;
+    x = first & ~1;
+    end = last | 1;
+    while (x <= end) {
+        while ((x <= end) && FLC_SAME_WORD(src, prev, x)) {
+            x += 2;
+        }
+        if (x > end) {
+            break;
+        }
+
+        // the skip is a byte, longer gaps are bridged by copying a single word
+        while (x - pos > FLC_MAX_SKIP) {
+            *out++ = FLC_MAX_SKIP - 1;
+            *out++ = 1;
+            *out++ = src[pos + FLC_MAX_SKIP - 1];
+            *out++ = src[pos + FLC_MAX_SKIP];
+            pos += FLC_MAX_SKIP + 1;
+            (*packets)++;
+        }
+        skip = x - pos;
+
+        // changed words, a single unchanged word is cheaper to copy than to start a new packet
+        p = x;
+        while (x <= end) {
+            if (!FLC_SAME_WORD(src, prev, x)) {
+                x += 2;
+            } else if ((x + 2 <= end) && !FLC_SAME_WORD(src, prev, x + 2)) {
+                x += 4;
+            } else {
+                break;
+            }
+        }
+
+        while (p < x) {
+            // negative count: replicate the next word
+            for (n = 1; (p + n * 2 < x) && (n < FLC_MAX_PACKET) && FLC_SAME_WORD(src, src + n * 2, p); n++) {
+            }
+            *out++ = skip;
+            if (n >= FLC_MIN_RUN) {
+                *out++ = (uint8_t)-n;
+                *out++ = src[p];
+                *out++ = src[p + 1];
+                p += n * 2;
+            } else {
+                // positive count: copy literal words up to the next run
+                for (q = p, n = 0; (q < x) && (n < FLC_MAX_PACKET); q += 2, n++) {
+                    if ((q + 4 < x) && FLC_SAME_WORD(src, src + 2, q) && FLC_SAME_WORD(src, src + 4, q)) {
+                        break;
+                    }
+                }
+                *out++ = n;
+                memcpy(out, &src[p], n * 2);
+                out += n * 2;
+                p = q;
+            }
+            skip = 0;
+            (*packets)++;
+        }
+        pos = x;
+    }
+    return out - flc->line;
+}
+
+/**
+ * @brief write a DELTA_FLC chunk with the changed scanline ranges and update the last frame.
+ *
+ * @param flc the recording.
+ * @param src the frame.
+ *
+ * @return true if a chunk was written, false if nothing changed.
+ */
+static bool flc_delta(flc_t *flc, const uint8_t *src) {
+    uint32_t start = 0;
+    uint16_t y, lines, skipped, len, packets;
+    uint16_t offset;
+
+    lines = 0;
+    skipped = 0;
+    for (y = 0; y < VGA_SCREEN_HEIGHT; y++) {
+        if (flc->last[y] < flc->first[y]) {
+            skipped++;
+            continue;
+        }
+        if (!lines) {
+            start = flc_begin_chunk(flc, FLC_DELTA_FLC);
+            flc_put16(flc, 0);
+        }
+        if (skipped) {
+            flc_put16(flc, (uint16_t)-skipped);
+            skipped = 0;
+        }
+
+        offset = y * VGA_SCREEN_WIDTH;
+        len = flc_delta_line(flc, &src[offset], &flc->prev[offset], flc->first[y], flc->last[y], &packets);
+        flc_put16(flc, packets);
+        flc_put(flc, flc->line, len);
+        lines++;
+
+        offset += flc->first[y];
+        memcpy(&flc->prev[offset], &src[offset], flc->last[y] - flc->first[y] + 1);
+    }
+    if (!lines) {
+        return false;
+    }
+    flc_patch(flc, start + FLC_CHUNK_SIZE, lines, 2);
+    flc_end_chunk(flc, start);
+    return true;
+}
+
+/**
+ * @brief fill in the file header.
+ *
+ * @param flc the recording.
+ * @param h 128 bytes of memory for the header.
+ * @param finished true if all frames are written and the header is final.
+ */
+static void flc_header(flc_t *flc, uint8_t *h, bool finished) {
+    memset(h, 0, FLC_HEADER_SIZE);
+    *(uint32_t *)&h[0] = flc_tell(flc);
+    *(uint16_t *)&h[4] = FLC_TYPE;
+    *(uint16_t *)&h[6] = flc->frames;
+    *(uint16_t *)&h[8] = VGA_SCREEN_WIDTH;
+    *(uint16_t *)&h[10] = VGA_SCREEN_HEIGHT;
+    *(uint16_t *)&h[12] = 8;                // bits per pixel
+    *(uint16_t *)&h[14] = finished ? FLC_FINISHED : 0;  // flags
+    *(uint32_t *)&h[16] = flc->speed;       // ms per frame
+    *(uint16_t *)&h[38] = 6;                // aspect ratio of 320x200 on a 4:3 monitor is 6:5
+    *(uint16_t *)&h[40] = 5;                // height part of the aspect ratio
+    *(uint32_t *)&h[80] = FLC_HEADER_SIZE;  // first frame
+    *(uint32_t *)&h[84] = flc->frame2;      // second frame
+}
+
+/**
+ * @brief start reading at a new file offset.
+ *
+ * @param p the player.
+ * @param pos file offset.
+ */
+static void flc_play_seek(flc_player_t *p, uint32_t pos) {
+    if (fseek(p->f, pos, SEEK_SET)) {
+        p->failed = true;
+    }
+    p->pos = pos;
+    p->rd = 0;
+    p->avail = 0;
+    p->eof = false;
+}
+
+/**
+ * @brief make sure the next bytes are in the read buffer. The half after the buffered bytes is read from disk
+ * until enough bytes are available, so the get functions below need no further checks.
+ *
+ * @param p the player.
+ * @param n number of bytes needed, at most FLC_BUFFER_SIZE.
+ *
+ * @return true if the bytes are available, false if the file is truncated.
+ */
+static bool flc_need(flc_player_t *p, uint16_t n) {
+    uint16_t half;
+    size_t got;
+
+    while (p->avail < n) {
+        if (p->eof) {
+            p->failed = true;
+            return false;
+        }
+        half = (p->rd + p->avail) & FLC_READ_MASK;
+        got = fread(&p->buf[half], 1, FLC_BUFFER_SIZE, p->f);
+        if (got < FLC_BUFFER_SIZE) {
+            p->eof = true;
+        }
+        p->avail += got;
+    }
+    return true;
+}
+
+/**
+ * @brief get a byte from the read buffer, see flc_need().
+ *
+ * @param p the player.
+ *
+ * @return the byte.
+ */
+static uint8_t flc_get8(flc_player_t *p) {
+    uint8_t v = p->buf[p->rd];
+    p->rd = (p->rd + 1) & FLC_READ_MASK;
+    p->avail--;
+    p->pos++;
+    return v;
+}
+
+/**
+ * @brief get a little endian word from the read buffer, see flc_need().
+ *
+ * @param p the player.
+ *
+ * @return the word.
+ */
+static uint16_t flc_get16(flc_player_t *p) {
+    uint16_t v = flc_get8(p);
+    return v | ((uint16_t)flc_get8(p) << 8);
+}
+
+/**
+ * @brief get a little endian double word from the read buffer, see flc_need().
+ *
+ * @param p the player.
+ *
+ * @return the double word.
+ */
+static uint32_t flc_get32(flc_player_t *p) {
+    uint32_t v = flc_get16(p);
+    return v | ((uint32_t)flc_get16(p) << 16);
+}
+
+/**
+ * @brief copy bytes from the read buffer, see flc_need().
+ *
+ * @param p the player.
+ * @param dst destination.
+ * @param n number of bytes.
+ */
+static void flc_get(flc_player_t *p, uint8_t *dst, uint16_t n) {
+    uint16_t part = FLC_READ_MASK + 1 - p->rd;
+
+    if (part > n) {
+        part = n;
+    }
+    memcpy(dst, &p->buf[p->rd], part);
+    memcpy(dst + part, p->buf, n - part);
+    p->rd = (p->rd + n) & FLC_READ_MASK;
+    p->avail -= n;
+    p->pos += n;
+}
+
+/**
+ * @brief copy bytes of the file that may be more than fit into the read buffer.
+ *
+ * @param p the player.
+ * @param dst destination.
+ * @param n number of bytes.
+ *
+ * @return true if the bytes were copied, false if the file is truncated.
+ */
+static bool flc_read(flc_player_t *p, uint8_t *dst, uint16_t n) {
+    uint16_t part;
+
+    while (n) {
+        part = n > FLC_BUFFER_SIZE ? FLC_BUFFER_SIZE : n;
+        if (!flc_need(p, part)) {
+            return false;
+        }
+        flc_get(p, dst, part);
+        dst += part;
+        n -= part;
+    }
+    return true;
+}
+
+/**
+ * @brief skip bytes of the file.
+ *
+ * @param p the player.
+ * @param n number of bytes.
+ *
+ * @return true if the bytes were skipped, false if the file is truncated.
+ */
+static bool flc_skip(flc_player_t *p, uint32_t n) {
+    uint16_t part;
+
+    while (n) {
+        part = n > FLC_BUFFER_SIZE ? FLC_BUFFER_SIZE : n;
+        if (!flc_need(p, part)) {
+            return false;
+        }
+        p->rd = (p->rd + part) & FLC_READ_MASK;
+        p->avail -= part;
+        p->pos += part;
+        n -= part;
+    }
+    return true;
+}
+
+/**
+ * @brief decode a COLOR_256 or COLOR_64 chunk.
+ *
+ * @param p the player.
+ * @param shift 0 for 8bit components, 2 for 6bit components.
+ *
+ * @return true if the chunk was valid.
+ */
+static bool flc_play_color(flc_player_t *p, uint8_t shift) {
+    uint16_t packets, idx, n;
+
+    if (!flc_need(p, 2)) {
+        return false;
+    }
+    idx = 0;
+    for (packets = flc_get16(p); packets; packets--) {
+        if (!flc_need(p, 2)) {
+            return false;
+        }
+        idx += flc_get8(p);
+        n = flc_get8(p);
+        if (!n) {
+            n = VGA_MAX_COLORS;
+        }
+        if ((idx + n > VGA_MAX_COLORS) || !flc_need(p, n * 3)) {
+            return false;
+        }
+        for (; n; n--, idx++) {
+            p->palette[idx].red = flc_get8(p) << shift;
+            p->palette[idx].green = flc_get8(p) << shift;
+            p->palette[idx].blue = flc_get8(p) << shift;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief decode a BRUN chunk.
+ *
+ * @param p the player.
+ * @param s the surface.
+ *
+ * @return true if the chunk was valid.
+ */
+static bool flc_play_brun(flc_player_t *p, surface_t *s) {
+    uint8_t *row = s->data;
+    int16_t x, n;
+    uint16_t y;
+
+    for (y = 0; y < p->height; y++, row += s->stride) {
+        if (!flc_need(p, 1)) {
+            return false;
+        }
+        flc_get8(p);  // obsolete packet count
+        for (x = 0; x < p->width; x += n) {
+            if (!flc_need(p, 2)) {
+                return false;
+            }
+            n = (int8_t)flc_get8(p);
+            if (n > 0) {
+                if (x + n > p->width) {
+                    return false;
+                }
+                memset(&row[x], flc_get8(p), n);
+            } else {
+                n = -n;
+                if (!n || (x + n > p->width) || !flc_need(p, n)) {
+                    return false;
+                }
+                flc_get(p, &row[x], n);
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief decode a DELTA_FLC chunk.
+ *
+ * @param p the player.
+ * @param s the surface.
+ * @param top receives the first changed scanline.
+ * @param bottom receives the last changed scanline.
+ *
+ * @return true if the chunk was valid.
+ */
+static bool flc_play_delta(flc_player_t *p, surface_t *s, int16_t *top, int16_t *bottom) {
+    uint16_t lines, packets, y;
+    int16_t x, n;
+    uint8_t *row, a, b;
+
+    if (!flc_need(p, 2)) {
+        return false;
+    }
+    y = 0;
+    for (lines = flc_get16(p); lines; lines--, y++) {
+        // optional skip and last byte words before the packet count
+        for (;;) {
+            if (!flc_need(p, 2)) {
+                return false;
+            }
+            packets = flc_get16(p);
+            if (!(packets & 0x8000)) {
+                break;
+            }
+            if (packets & 0x4000) {
+                y -= (int16_t)packets;
+            } else if (y < p->height) {
+                s->data[y * s->stride + p->width - 1] = packets & 0xFF;
+            }
+        }
+        if (y >= p->height) {
+            return false;
+        }
+        if (y < *top) {
+            *top = y;
+        }
+        *bottom = y;
+
+        row = &s->data[y * s->stride];
+        for (x = 0; packets; packets--) {
+            if (!flc_need(p, 2)) {
+                return false;
+            }
+            x += flc_get8(p);
+            n = (int8_t)flc_get8(p);
+            if (n > 0) {
+                n *= 2;
+                if ((x + n > p->width) || !flc_need(p, n)) {
+                    return false;
+                }
+                flc_get(p, &row[x], n);
+                x += n;
+            } else if (n < 0) {
+                n *= -2;
+                if ((x + n > p->width) || !flc_need(p, 2)) {
+                    return false;
+                }
+                a = flc_get8(p);
+                b = flc_get8(p);
+                for (n += x; x < n; x += 2) {
+                    row[x] = a;
+                    row[x + 1] = b;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief decode an LC chunk (FLI byte oriented delta).
+ *
+ * @param p the player.
+ * @param s the surface.
+ * @param top receives the first changed scanline.
+ * @param bottom receives the last changed scanline.
+ *
+ * @return true if the chunk was valid.
+ */
+static bool flc_play_lc(flc_player_t *p, surface_t *s, int16_t *top, int16_t *bottom) {
+    uint16_t y, lines;
+    uint8_t packets, *row;
+    int16_t x, n;
+
+    if (!flc_need(p, 4)) {
+        return false;
+    }
+    y = flc_get16(p);
+    lines = flc_get16(p);
+    if (y + lines > p->height) {
+        return false;
+    }
+    if (lines && (y < *top)) {
+        *top = y;
+    }
+    if (lines && (y + lines - 1 > *bottom)) {
+        *bottom = y + lines - 1;
+    }
+
+    for (row = &s->data[y * s->stride]; lines; lines--, row += s->stride) {
+        if (!flc_need(p, 1)) {
+            return false;
+        }
+        for (x = 0, packets = flc_get8(p); packets; packets--) {
+            if (!flc_need(p, 2)) {
+                return false;
+            }
+            x += flc_get8(p);
+            n = (int8_t)flc_get8(p);
+            if (n > 0) {
+                if ((x + n > p->width) || !flc_need(p, n)) {
+                    return false;
+                }
+                flc_get(p, &row[x], n);
+                x += n;
+            } else if (n < 0) {
+                n = -n;
+                if ((x + n > p->width) || !flc_need(p, 1)) {
+                    return false;
+                }
+                memset(&row[x], flc_get8(p), n);
+                x += n;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief decode the next frame chunk into a surface.
+ *
+ * @param p the player.
+ * @param s the surface.
+ * @param palette set to true if the palette changed.
+ * @param top receives the first changed scanline.
+ * @param bottom receives the last changed scanline.
+ *
+ * @return true if the frame was valid.
+ */
+static bool flc_play_decode(flc_player_t *p, surface_t *s, bool *palette, int16_t *top, int16_t *bottom) {
+    uint32_t start, size, cstart, csize;
+    uint16_t type, chunks, y;
+    bool ok;
+
+    // skip prefix chunks
+    for (;;) {
+        start = p->pos;
+        if (!flc_need(p, FLC_CHUNK_SIZE)) {
+            return false;
+        }
+        size = flc_get32(p);
+        type = flc_get16(p);
+        if ((size < FLC_CHUNK_SIZE) || (start + size > p->size)) {
+            return false;
+        }
+        if (type == FLC_FRAME_TYPE) {
+            break;
+        }
+        if (!flc_skip(p, size - FLC_CHUNK_SIZE)) {
+            return false;
+        }
+    }
+    if ((size < FLC_FRAME_SIZE) || !flc_need(p, FLC_FRAME_SIZE - FLC_CHUNK_SIZE)) {
+        return false;
+    }
+    chunks = flc_get16(p);
+    flc_skip(p, FLC_FRAME_SIZE - FLC_CHUNK_SIZE - 2);  // delay, reserved, width and height
+
+    for (; chunks; chunks--) {
+        cstart = p->pos;
+        if (!flc_need(p, FLC_CHUNK_SIZE)) {
+            return false;
+        }
+        csize = flc_get32(p);
+        type = flc_get16(p);
+        if ((csize < FLC_CHUNK_SIZE) || (cstart + csize > start + size)) {
+            return false;
+        }
+
+        switch (type) {
+            case FLC_COLOR_256:
+            case FLC_COLOR_64:
+                ok = flc_play_color(p, type == FLC_COLOR_64 ? 2 : 0);
+                *palette = true;
+                break;
+            case FLC_DELTA_FLC:
+                ok = flc_play_delta(p, s, top, bottom);
+                break;
+            case FLC_LC:
+                ok = flc_play_lc(p, s, top, bottom);
+                break;
+            case FLC_BRUN:
+                ok = flc_play_brun(p, s);
+                *top = 0;
+                *bottom = p->height - 1;
+                break;
+            case FLC_COPY:
+                ok = true;
+                for (y = 0; ok && (y < p->height); y++) {
+                    ok = flc_read(p, &s->data[y * s->stride], p->width);
+                }
+                *top = 0;
+                *bottom = p->height - 1;
+                break;
+            case FLC_BLACK:
+                for (y = 0; y < p->height; y++) {
+                    memset(&s->data[y * s->stride], 0, p->width);
+                }
+                ok = true;
+                *top = 0;
+                *bottom = p->height - 1;
+                break;
+            default:
+                ok = true;  // e.g. postage stamps
+                break;
+        }
+        if (!ok || (p->pos > cstart + csize) || !flc_skip(p, cstart + csize - p->pos)) {
+            return false;
+        }
+    }
+    return flc_skip(p, start + size - p->pos);
+}
+
+/* ======================================================================
+** public functions
+** ====================================================================== */
+/**
+ * @brief create a new FLC file and start recording. The file does not contain a ring frame, players that loop
+ * the animation start over with the first frame.
+ *
+ * @param fname file name.
+ * @param speed milliseconds per frame.
+ *
+ * @return the recording or NULL if the file could not be created.
+ */
+flc_t *flc_open(const char *fname, uint16_t speed) {
+    flc_t *flc;
+    uint8_t h[FLC_HEADER_SIZE];
+
+    if (!fname) {
+        ERR_PARAM();
+        return NULL;
+    }
+
+    flc = calloc(1, sizeof(flc_t));
+    if (!flc) {
+        ERR_NOMEM();
+        return NULL;
+    }
+    flc->prev = malloc(VGA_SCREEN_SIZE);
+    if (!flc->prev) {
+        free(flc);
+        ERR_NOMEM();
+        return NULL;
+    }
+
+    flc->f = fopen(fname, "wb");
+    if (!flc->f) {
+        free(flc->prev);
+        free(flc);
+        ERR_CREAT();
+        return NULL;
+    }
+    flc->speed = speed;
+
+    // the header is rewritten by flc_close()
+    flc_header(flc, h, false);
+    flc_put(flc, h, FLC_HEADER_SIZE);
+
+    ERR_OK();
+    return flc;
+}
+
+/**
+ * @brief append the current screen content (the back buffer if vga_begin_frame() was used) and palette to the recording.
+ * When drawing into a back buffer this must be called before vga_present(), only the dirty rectangles are compared
+ * to the last frame. Mode X is not supported.
+ *
+ * @param flc the recording.
+ *
+ * @return true if the frame was written, else false.
+ */
+bool flc_frame(flc_t *flc) {
+    surface_t *s = vga_screen();
+    const rect_t *rects;
+    rect_t r;
+    uint32_t start;
+    uint16_t chunks;
+    uint8_t i, num;
+    int16_t y;
+
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        ERR_AVAIL();
+        return false;
+    }
+
+    start = flc_tell(flc);
+    if (flc->frames == 1) {
+        flc->frame2 = start;
+    }
+    flc_put32(flc, 0);
+    flc_put16(flc, FLC_FRAME_TYPE);
+    flc_put16(flc, 0);  // number of chunks
+    flc_put16(flc, 0);  // delay, use header speed
+    flc_put16(flc, 0);  // reserved
+    flc_put16(flc, 0);  // width, use header
+    flc_put16(flc, 0);  // height, use header
+
+    chunks = 0;
+    if (flc_color(flc, !flc->frames)) {
+        chunks++;
+    }
+    if (!flc->frames) {
+        flc_brun(flc, s->data);
+        memcpy(flc->prev, s->data, VGA_SCREEN_SIZE);
+        chunks++;
+    } else {
+        for (y = 0; y < VGA_SCREEN_HEIGHT; y++) {
+            flc->first[y] = VGA_SCREEN_WIDTH;
+            flc->last[y] = -1;
+        }
+
+        if (vga_back_buffer) {
+            num = vga_get_dirty(&rects);
+            for (i = 0; i < num; i++) {
+                r = rects[i];
+                if (r.left < 0) {
+                    r.left = 0;
+                }
+                if (r.top < 0) {
+                    r.top = 0;
+                }
+                if (r.right >= VGA_SCREEN_WIDTH) {
+                    r.right = VGA_SCREEN_WIDTH - 1;
+                }
+                if (r.bottom >= VGA_SCREEN_HEIGHT) {
+                    r.bottom = VGA_SCREEN_HEIGHT - 1;
+                }
+                if ((r.left <= r.right) && (r.top <= r.bottom)) {
+                    flc_diff(flc, s->data, &r);
+                }
+            }
+        } else {
+            r.left = 0;
+            r.top = 0;
+            r.right = VGA_SCREEN_WIDTH - 1;
+            r.bottom = VGA_SCREEN_HEIGHT - 1;
+            flc_diff(flc, s->data, &r);
+        }
+
+        if (flc_delta(flc, s->data)) {
+            chunks++;
+        }
+    }
+
+    flc_patch(flc, start, flc_tell(flc) - start, 4);
+    flc_patch(flc, start + 6, chunks, 2);  // after size and type
+    flc->frames++;
+    flc_last_size = flc_tell(flc) - start;
+
+    if (flc->failed) {
+        ERR_IOERR();
+        return false;
+    }
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief finish the recording: write the header and close the file.
+ *
+ * @param flc the recording.
+ *
+ * @return true if the whole file was written, else false.
+ */
+bool flc_close(flc_t *flc) {
+    uint8_t h[FLC_HEADER_SIZE];
+    bool ok;
+
+    flc_flush(flc);
+    flc_header(flc, h, true);
+    if (!flc->failed) {
+        if (fseek(flc->f, 0, SEEK_SET) || (fwrite(h, FLC_HEADER_SIZE, 1, flc->f) != 1)) {
+            flc->failed = true;
+        }
+    }
+    if (fclose(flc->f)) {
+        flc->failed = true;
+    }
+    ok = !flc->failed;
+
+    free(flc->prev);
+    free(flc);
+
+    if (!ok) {
+        ERR_IOERR();
+        return false;
+    }
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief open an FLI or FLC animation for playing. The file is read in blocks while playing, memory use does not
+ * depend on the length of the animation.
+ *
+ * @param fname file name.
+ *
+ * @return the player or NULL if the file could not be opened or is no 8bit FLI/FLC.
+ */
+flc_player_t *flc_play_open(const char *fname) {
+    flc_player_t *p;
+    uint8_t h[FLC_HEADER_SIZE];
+    uint16_t type;
+    uint32_t speed;
+
+    if (!fname) {
+        ERR_PARAM();
+        return NULL;
+    }
+
+    p = calloc(1, sizeof(flc_player_t));
+    if (!p) {
+        ERR_NOMEM();
+        return NULL;
+    }
+    p->f = fopen(fname, "rb");
+    if (!p->f) {
+        free(p);
+        ERR_NOENT();
+        return NULL;
+    }
+    if (fread(h, FLC_HEADER_SIZE, 1, p->f) != 1) {
+        fclose(p->f);
+        free(p);
+        ERR_IOERR();
+        return NULL;
+    }
+
+    p->size = util_filesize(p->f);
+    type = *(uint16_t *)&h[4];
+    p->frames = *(uint16_t *)&h[6];
+    p->width = *(uint16_t *)&h[8];
+    p->height = *(uint16_t *)&h[10];
+    speed = *(uint32_t *)&h[16];
+    p->frame1 = FLC_HEADER_SIZE;
+    if (type == FLC_TYPE) {
+        if (*(uint32_t *)&h[80]) {
+            p->frame1 = *(uint32_t *)&h[80];
+        }
+    } else {
+        speed = *(uint16_t *)&h[16] * 1000L / FLC_FLI_JIFFIES;
+    }
+    if (((type != FLC_TYPE) && (type != FLC_FLI_TYPE)) || ((*(uint16_t *)&h[12] != 8) && (*(uint16_t *)&h[12] != 0)) || !p->frames ||
+        !p->width || !p->height) {
+        fclose(p->f);
+        free(p);
+        ERR_PARAM();
+        return NULL;
+    }
+    p->delay = speed * CLOCKS_PER_SEC / 1000;
+    flc_play_seek(p, p->frame1);
+
+    ERR_OK();
+    return p;
+}
+
+/**
+ * @brief decode the next frame into the top left corner of a surface. Only the surface returned by vga_screen()
+ * changes the VGA palette, decoding into other surfaces (e.g. of a bitmap) does not touch the hardware.
+ * After the last frame the animation starts over, using the ring frame if the file has one.
+ * The surface must keep the content of the last frame as only the changes are drawn. Mode X is not supported.
+ *
+ * @param p the player.
+ * @param s the surface, it must be at least as large as the animation.
+ *
+ * @return true if the frame was drawn, false if the file is corrupt.
+ */
+bool flc_play_frame(flc_player_t *p, surface_t *s) {
+    bool palette = false;
+    int16_t top, bottom;
+
+    if ((s->flags & VGA_SURFACE_PLANAR) || (s->width < p->width) || (s->height < p->height)) {
+        ERR_PARAM();
+        return false;
+    }
+
+    if (p->frame >= p->frames) {
+        if (p->pos >= p->size) {
+            // no ring frame, start over with the full first frame
+            flc_play_seek(p, p->frame1);
+            p->frame = 0;
+        }
+    }
+
+    top = p->height;
+    bottom = -1;
+    if (p->failed || !flc_play_decode(p, s, &palette, &top, &bottom)) {
+        p->failed = true;
+        ERR_IOERR();
+        return false;
+    }
+
+    if (!p->frame) {
+        p->frame2 = p->pos;
+    }
+    p->frame++;
+    if (p->frame > p->frames) {
+        // the ring frame turned the last frame into the first one
+        flc_play_seek(p, p->frame2);
+        p->frame = 1;
+    }
+
+    if (s == vga_screen()) {
+        if (palette) {
+            vga_set_palette(p->palette, VGA_MAX_COLORS);
+        }
+        if (top <= bottom) {
+            vga_surface_dirty(s, 0, top, p->width - 1, bottom);
+        }
+    }
+
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief wait until the next frame is due according to the speed of the animation. The time is measured with clock()
+ * from the last call, so decoding and drawing do not slow the animation down. If playing falls behind by more than a frame
+ * the schedule is reset instead of catching up.
+ *
+ * @param p the player.
+ */
+void flc_play_wait(flc_player_t *p) {
+    clock_t now;
+
+    do {
+        now = clock();
+    } while (now < p->next);
+
+    p->next += p->delay;
+    if (p->next < now) {
+        p->next = now + p->delay;
+    }
+}
+
+/**
+ * @brief close the animation and free the player.
+ *
+ * @param p the player.
+ */
+void flc_play_close(flc_player_t *p) {
+    fclose(p->f);
+    free(p);
+}
@@ -0,0 +1,81 @@
+/**
+ * @file flc.h
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief record the screen into delta compressed FLC animations and play FLI/FLC animations.
+ *
+ * @copyright SuperIlu
+ */
+#ifndef __FLC_H_
+#define __FLC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "vga.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define FLC_BUFFER_SIZE 4096  //!< files are written and read in blocks of this size, must be a power of two
+
+/* ======================================================================
+** typedefs
+** ====================================================================== */
+//! an FLC recording
+typedef struct __flc {
+    FILE *f;                                   //!< the file
+    uint32_t frame2;                           //!< file offset of the second frame
+    uint16_t frames;                           //!< number of recorded frames
+    uint16_t speed;                            //!< milliseconds per frame
+    bool failed;                               //!< a write failed, the file is incomplete
+    uint8_t *prev;                             //!< the last recorded frame
+    uint16_t pal_changes;                      //!< vga_palette_changes when the palette was last read
+    palette_color_t palette[VGA_MAX_COLORS];   //!< the last recorded palette
+    int16_t first[VGA_SCREEN_HEIGHT];          //!< first changed pixel of every scanline in the current frame
+    int16_t last[VGA_SCREEN_HEIGHT];           //!< last changed pixel of every scanline in the current frame, < first if unchanged
+    uint8_t line[VGA_SCREEN_WIDTH * 2];        //!< packets of the scanline that is encoded
+    uint32_t buf_pos;                          //!< file offset of the first byte in buf
+    uint16_t buf_len;                          //!< number of bytes in buf
+    uint8_t buf[FLC_BUFFER_SIZE];              //!< write buffer
+} flc_t;
+
+//! an FLI/FLC animation that is played from disk
+typedef struct __flc_player {
+    FILE *f;                                  //!< the file
+    uint32_t size;                            //!< file size
+    uint32_t frame1;                          //!< file offset of the first frame
+    uint32_t frame2;                          //!< file offset of the second frame, known after the first frame was played
+    uint16_t frames;                          //!< number of frames, excluding the ring frame
+    uint16_t frame;                           //!< number of the next frame
+    uint16_t width;                           //!< width in pixels
+    uint16_t height;                          //!< height in pixels
+    clock_t delay;                            //!< clock() ticks per frame
+    clock_t next;                             //!< clock() when the next frame is due
+    bool failed;                              //!< the file is truncated or corrupt
+    palette_color_t palette[VGA_MAX_COLORS];  //!< the current palette of the animation
+    uint32_t pos;                             //!< file offset of the next byte in buf
+    uint16_t rd;                              //!< index of the next byte in buf
+    uint16_t avail;                           //!< number of bytes in buf starting at rd
+    bool eof;                                 //!< the end of the file was read into buf
+    uint8_t buf[FLC_BUFFER_SIZE * 2];         //!< read buffer of two halves, a half is refilled when all its bytes were used
+} flc_player_t;
+
+/* ======================================================================
+** global variables
+** ====================================================================== */
+extern uint32_t flc_last_size;
+
+/* ======================================================================
+** prototypes
+** ====================================================================== */
+extern flc_t *flc_open(const char *fname, uint16_t speed);
+extern bool flc_frame(flc_t *flc);
+extern bool flc_close(flc_t *flc);
+extern flc_player_t *flc_play_open(const char *fname);
+extern bool flc_play_frame(flc_player_t *p, surface_t *s);
+extern void flc_play_wait(flc_player_t *p);
+extern void flc_play_close(flc_player_t *p);
+
+#endif  // __FLC_H_
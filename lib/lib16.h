@@ -9,12 +9,23 @@
 #define __DOS16BIT_H_
 
 #include "bitmap.h"
+#include "blend.h"
+#include "csprite.h"
+#include "dlist.h"
 #include "error.h"
+#include "flc.h"
 #include "ipx.h"
+#include "modex.h"
 #include "mouse.h"
 #include "vga.h"
 #include "rawdisk.h"
+#include "scroll.h"
+#include "span.h"
+#include "sprite.h"
+#include "texture.h"
+#include "tilemap.h"
 #include "opl2.h"
+#include "palfx.h"
 #include "util.h"
 
 //! supress unused warning
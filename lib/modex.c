@@ -0,0 +1,526 @@
+/**
+ * @file modex.c
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief unchained VGA 256 color modes (Mode X) with multiple pages.
+ *
+ * @copyright SuperIlu
+ *
+ * Register values are taken from Michael Abrash's Graphics Programming Black Book, chapter 47.
+ *
+ * In the unchained modes pixel (x, y) is stored in plane (x & 3) at offset (y * 80 + x / 4). The drawing functions in vga.c
+ * use the modex_*_pixel() and modex_*_span() functions below for surfaces with VGA_SURFACE_PLANAR set.
+ *
+ * modex_emulate() replaces the VGA hardware by plain RAM pointed to by VGA_MEMORY. The four planes are interleaved, byte n
+ * of plane p is stored at (n * 4 + p). A page in emulated memory therefore looks exactly like a linear 320 pixel wide image.
+ * The emulation needs MODEX_MEMORY_SIZE bytes and is meant for hosts with flat memory.
+ *
+ * Plane offsets wrap at 64KB like the CRTC address counter. In the large memory model the far pointer arithmetic does this
+ * for free, the emulation splits the few accesses that can run over the end of a plane.
+ */
+#include <stddef.h>
+#include <conio.h>
+#include <mem.h>
+
+#include "vga.h"
+#include "modex.h"
+#include "span.h"
+#include "error.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define MODEX_SC_INDEX 0x03C4     //!< sequence controller index register
+#define MODEX_SC_MAP_MASK 0x02    //!< sequence controller: map mask (planes to write)
+#define MODEX_SC_MEM_MODE 0x04    //!< sequence controller: memory mode
+#define MODEX_GC_INDEX 0x03CE     //!< graphics controller index register
+#define MODEX_GC_READ_MAP 0x04    //!< graphics controller: read map select (plane to read)
+#define MODEX_GC_BIT_MASK 0x08    //!< graphics controller: bit mask (bits written from CPU data)
+#define MODEX_CRTC_INDEX 0x03D4   //!< CRT controller index register
+#define MODEX_CRTC_START_HI 0x0C  //!< CRT controller: start address high
+#define MODEX_CRTC_START_LO 0x0D  //!< CRT controller: start address low
+#define MODEX_CRTC_RETRACE 0x11   //!< CRT controller: vertical retrace end (bit 7 write protects CR0-CR7)
+#define MODEX_CRTC_OFFSET 0x13    //!< CRT controller: offset (words from one scanline to the next)
+#define MODEX_AC_INDEX 0x03C0     //!< attribute controller index/data register
+#define MODEX_AC_PEL_PANNING 0x33  //!< attribute controller: horizontal pel panning, with the bit that keeps the display enabled
+#define MODEX_MISC_OUTPUT 0x03C2  //!< miscellaneous output register
+#define MODEX_INPUT_STATUS 0x03DA  //!< input status register
+#define MODEX_DISPLAY_ENABLE 0x01  //!< input status: display disabled (horizontal or vertical blank)
+#define MODEX_VRETRACE 0x08        //!< input status: vertical retrace
+
+#define MODEX_ALL_PLANES 0x0F  //!< map mask for all four planes
+#define MODEX_PLANE_SIZE 0x10000L  //!< bytes of VGA memory in each plane
+
+//! write a register of an indexed VGA controller
+#define MODEX_OUT(port, index, value) outpw(port, (((uint16_t)(value)) << 8) | (index))
+
+/* ======================================================================
+** global variables
+** ====================================================================== */
+uint16_t modex_height = 0;       //!< height of the active unchained mode or 0 if no unchained mode is active
+uint8_t modex_num_pages = 0;     //!< number of pages that fit into VGA memory
+uint8_t modex_draw_page = 0;     //!< page the screen surface draws to
+uint8_t modex_visible_page = 0;  //!< page currently displayed
+bool modex_emulated = false;     //!< true if the planes are emulated in RAM, see modex_emulate()
+
+/* ======================================================================
+** local variables
+** ====================================================================== */
+//! CRTC settings for 320x240 (from Abrash), the 320x200 mode only needs the last and the first entry
+static const uint16_t MODEX_CRTC_240[] = {
+    0x0D06,  // vertical total
+    0x3E07,  // overflow (bit 8 of vertical counts)
+    0x4109,  // cell height (2 to double-scan)
+    0xEA10,  // v sync start
+    0xAC11,  // v sync end and protect cr0-cr7
+    0xDF12,  // vertical displayed
+    0xE715,  // v blank start
+    0x0616,  // v blank end
+    0x0014,  // turn off dword mode
+    0xE317,  // turn on byte mode
+};
+
+//! CRTC settings for 320x200
+static const uint16_t MODEX_CRTC_200[] = {
+    0x0014,  // turn off dword mode
+    0xE317,  // turn on byte mode
+};
+
+//! number of bytes in each plane used by one page
+static uint16_t modex_page_size = 0;
+
+//! currently selected planes, only used in emulation
+static uint8_t modex_mask = MODEX_ALL_PLANES;
+
+/* ======================================================================
+** private functions
+** ====================================================================== */
+/**
+ * @brief set the module state and the screen surface for an unchained mode.
+ *
+ * @param height 200 or 240 lines.
+ */
+static void modex_setup(uint16_t height) {
+    surface_t *s;
+
+    vga_release_back_buffer();
+    modex_height = height;
+    modex_page_size = MODEX_STRIDE * height;
+    modex_num_pages = (uint8_t)(MODEX_PLANE_SIZE / modex_page_size);
+    modex_draw_page = 1;
+    modex_visible_page = 0;
+    modex_mask = MODEX_ALL_PLANES;
+
+    s = vga_screen();
+    vga_surface_init(s, modex_page(modex_draw_page), MODEX_STRIDE, VGA_SCREEN_WIDTH, height);
+    s->flags = VGA_SURFACE_PLANAR;
+}
+
+/**
+ * @brief select the planes the following writes go to.
+ *
+ * @param mask bit n set to write to plane n.
+ */
+static void modex_map_mask(uint8_t mask) {
+    modex_mask = mask;
+    if (!modex_emulated) {
+        MODEX_OUT(MODEX_SC_INDEX, MODEX_SC_MAP_MASK, mask);
+    }
+}
+
+/**
+ * @brief write a byte to all planes selected with modex_map_mask().
+ *
+ * @param base pointer to the page.
+ * @param offset offset in each plane.
+ * @param value the value to write.
+ */
+static void modex_store(uint8_t *base, uint16_t offset, uint8_t value) {
+    uint8_t p;
+
+    if (modex_emulated) {
+        for (p = 0; p < MODEX_PLANES; p++) {
+            if (modex_mask & (1 << p)) {
+                base[(uint32_t)offset * MODEX_PLANES + p] = value;
+            }
+        }
+    } else {
+        base[offset] = value;
+    }
+}
+
+/**
+ * @brief fill whole bytes in all planes of the emulated memory. The fill wraps at the end of the planes.
+ *
+ * @param base pointer to the page.
+ * @param offset offset of the first byte in each plane.
+ * @param value the value to write.
+ * @param len number of bytes in each plane.
+ */
+static void modex_emu_fill(uint8_t *base, uint16_t offset, uint8_t value, uint16_t len) {
+    uint16_t start = (uint16_t)((base - VGA_MEMORY) / MODEX_PLANES + offset);
+    uint32_t head = MODEX_PLANE_SIZE - start;
+
+    if (head >= len) {
+        span_fill(&VGA_MEMORY[(uint32_t)start * MODEX_PLANES], value, len * MODEX_PLANES);
+    } else {
+        span_fill(&VGA_MEMORY[(uint32_t)start * MODEX_PLANES], value, (uint16_t)head * MODEX_PLANES);
+        span_fill(VGA_MEMORY, value, (len - (uint16_t)head) * MODEX_PLANES);
+    }
+}
+
+/* ======================================================================
+** public functions
+** ====================================================================== */
+/**
+ * @brief switch to an unchained 256 color mode with multiple pages. Page 0 is displayed, the screen surface draws to page 1.
+ * Use vga_exit() to switch back to text mode.
+ *
+ * @param height MODEX_HEIGHT_200 (four pages) or MODEX_HEIGHT_240 (three pages).
+ *
+ * @return true if the mode was activated, else false.
+ */
+bool modex_init(uint16_t height) {
+    const uint16_t *crtc;
+    uint8_t i, num;
+
+    if ((height != MODEX_HEIGHT_200) && (height != MODEX_HEIGHT_240)) {
+        ERR_PARAM();
+        return false;
+    }
+
+    // start with BIOS mode 0x13
+    if (!vga_init()) {
+        return false;
+    }
+    modex_emulated = false;
+
+    // turn off chain 4
+    MODEX_OUT(MODEX_SC_INDEX, MODEX_SC_MEM_MODE, 0x06);
+
+    if (height == MODEX_HEIGHT_240) {
+        // 25MHz dot clock and 60Hz scan rate
+        MODEX_OUT(MODEX_SC_INDEX, 0x00, 0x01);  // synchronous reset
+        outp(MODEX_MISC_OUTPUT, 0xE3);
+        MODEX_OUT(MODEX_SC_INDEX, 0x00, 0x03);  // restart sequencer
+        crtc = MODEX_CRTC_240;
+        num = sizeof(MODEX_CRTC_240) / sizeof(MODEX_CRTC_240[0]);
+    } else {
+        crtc = MODEX_CRTC_200;
+        num = sizeof(MODEX_CRTC_200) / sizeof(MODEX_CRTC_200[0]);
+    }
+
+    // remove write protection of CR0-CR7 and program the CRT controller
+    outp(MODEX_CRTC_INDEX, MODEX_CRTC_RETRACE);
+    outp(MODEX_CRTC_INDEX + 1, inp(MODEX_CRTC_INDEX + 1) & 0x7F);
+    for (i = 0; i < num; i++) {
+        outpw(MODEX_CRTC_INDEX, crtc[i]);
+    }
+
+    // clear all pages
+    MODEX_OUT(MODEX_SC_INDEX, MODEX_SC_MAP_MASK, MODEX_ALL_PLANES);
+    memset(VGA_MEMORY, 0, 0x8000);
+    memset(VGA_MEMORY + 0x8000, 0, 0x8000);
+
+    modex_setup(height);
+    modex_show_page(0);
+
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief emulate an unchained mode in RAM. VGA_MEMORY must point to at least MODEX_MEMORY_SIZE bytes.
+ * No hardware is touched, all drawing functions, page flips and latch copies work on the RAM.
+ *
+ * @param height MODEX_HEIGHT_200 or MODEX_HEIGHT_240.
+ *
+ * @return true if the emulation was activated, false if the height is not supported.
+ */
+bool modex_emulate(uint16_t height) {
+    if ((height != MODEX_HEIGHT_200) && (height != MODEX_HEIGHT_240)) {
+        ERR_PARAM();
+        return false;
+    }
+    modex_emulated = true;
+    modex_setup(height);
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief reset the unchained mode state. This is called by vga_exit().
+ */
+void modex_exit(void) {
+    modex_height = 0;
+    modex_num_pages = 0;
+    modex_emulated = false;
+}
+
+/**
+ * @brief get the address of a page.
+ *
+ * @param page the page number.
+ *
+ * @return pointer to the first byte of the page.
+ */
+uint8_t *modex_page(uint8_t page) {
+    if (modex_emulated) {
+        return VGA_MEMORY + (uint32_t)page * modex_page_size * MODEX_PLANES;
+    } else {
+        return VGA_MEMORY + page * modex_page_size;
+    }
+}
+
+/**
+ * @brief get a surface for a page, e.g. to draw a static background into a page that is never displayed.
+ *
+ * @param page the page number.
+ * @param s the surface to initialize.
+ */
+void modex_get_surface(uint8_t page, surface_t *s) {
+    vga_surface_init(s, modex_page(page), MODEX_STRIDE, VGA_SCREEN_WIDTH, modex_height);
+    s->flags = VGA_SURFACE_PLANAR;
+}
+
+/**
+ * @brief select the page the screen surface draws to.
+ *
+ * @param page the page number.
+ */
+void modex_set_draw_page(uint8_t page) {
+    if (page < modex_num_pages) {
+        modex_draw_page = page;
+    }
+}
+
+/**
+ * @brief display a page by changing the CRTC start address. The function returns after the new start address was latched
+ * by the CRTC at the beginning of the vertical retrace, so the previously visible page can be drawn on right away.
+ *
+ * @param page the page number.
+ */
+void modex_show_page(uint8_t page) {
+    if (page >= modex_num_pages) {
+        return;
+    }
+    modex_set_start(page * modex_page_size, 0);
+    modex_visible_page = page;
+}
+
+/**
+ * @brief set the CRTC start address and the horizontal pel panning. The start address is written during display so both bytes
+ * are latched at the same retrace, the pel panning is written during the retrace so it changes together with the start address.
+ * The function returns in the vertical retrace. Nothing is done in emulation.
+ *
+ * @param start offset of the top left pixel in each plane.
+ * @param pan number of pixels (0..3) the display is shifted to the left.
+ */
+void modex_set_start(uint16_t start, uint8_t pan) {
+    if (modex_emulated) {
+        return;
+    }
+
+    while (inp(MODEX_INPUT_STATUS) & MODEX_DISPLAY_ENABLE) {
+        ;
+    }
+    MODEX_OUT(MODEX_CRTC_INDEX, MODEX_CRTC_START_HI, start >> 8);
+    MODEX_OUT(MODEX_CRTC_INDEX, MODEX_CRTC_START_LO, start & 0xFF);
+    while (!(inp(MODEX_INPUT_STATUS) & MODEX_VRETRACE)) {
+        ;
+    }
+
+    // reading the input status resets the attribute controller to the index state, 256 color modes pan in steps of two
+    inp(MODEX_INPUT_STATUS);
+    outp(MODEX_AC_INDEX, MODEX_AC_PEL_PANNING);
+    outp(MODEX_AC_INDEX, (pan & 3) << 1);
+}
+
+/**
+ * @brief change the number of bytes from one scanline to the next in each plane. Values above MODEX_STRIDE give a virtual screen
+ * that is wider than the display, e.g. for scrolling. The pages are only valid with MODEX_STRIDE.
+ *
+ * @param stride bytes per scanline, must be even.
+ */
+void modex_set_stride(uint16_t stride) {
+    if (!modex_emulated) {
+        MODEX_OUT(MODEX_CRTC_INDEX, MODEX_CRTC_OFFSET, stride >> 1);
+    }
+}
+
+/**
+ * @brief display the draw page and continue drawing on the other one of pages 0 and 1. Pages 2 and up are never touched
+ * and can hold static backgrounds for modex_copy_page().
+ */
+void modex_flip(void) {
+    modex_show_page(modex_draw_page);
+    modex_draw_page = modex_visible_page ? 0 : 1;
+}
+
+/**
+ * @brief copy an area from one page to another using the VGA latches, four pixels are copied with each byte.
+ * The area is extended to multiples of four pixels horizontally.
+ *
+ * @param src_page the page to copy from.
+ * @param dst_page the page to copy to.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ */
+void modex_copy_rect(uint8_t src_page, uint8_t dst_page, int16_t left, int16_t top, int16_t right, int16_t bottom) {
+    volatile uint8_t *src, *dst;
+    uint16_t offset, width, x;
+
+    if ((src_page >= modex_num_pages) || (dst_page >= modex_num_pages)) {
+        return;
+    }
+    if (left < 0) {
+        left = 0;
+    }
+    if (top < 0) {
+        top = 0;
+    }
+    if (right >= VGA_SCREEN_WIDTH) {
+        right = VGA_SCREEN_WIDTH - 1;
+    }
+    if (bottom >= (int16_t)modex_height) {
+        bottom = modex_height - 1;
+    }
+    if ((left > right) || (top > bottom)) {
+        return;
+    }
+
+    src = modex_page(src_page);
+    dst = modex_page(dst_page);
+    offset = (uint16_t)top * MODEX_STRIDE + (left >> 2);
+    width = (right >> 2) - (left >> 2) + 1;
+
+    if (modex_emulated) {
+        for (; top <= bottom; top++, offset += MODEX_STRIDE) {
+            memcpy((uint8_t *)&dst[(uint32_t)offset * MODEX_PLANES], (uint8_t *)&src[(uint32_t)offset * MODEX_PLANES], width * MODEX_PLANES);
+        }
+    } else {
+        // write all planes with data from the latches only. the copy must be done byte by byte, each read loads the latches
+        MODEX_OUT(MODEX_SC_INDEX, MODEX_SC_MAP_MASK, MODEX_ALL_PLANES);
+        MODEX_OUT(MODEX_GC_INDEX, MODEX_GC_BIT_MASK, 0x00);
+        for (; top <= bottom; top++, offset += MODEX_STRIDE) {
+            for (x = 0; x < width; x++) {
+                dst[offset + x] = src[offset + x];
+            }
+        }
+        MODEX_OUT(MODEX_GC_INDEX, MODEX_GC_BIT_MASK, 0xFF);
+    }
+}
+
+/**
+ * @brief copy a whole page to another page using the VGA latches.
+ *
+ * @param src_page the page to copy from.
+ * @param dst_page the page to copy to.
+ */
+void modex_copy_page(uint8_t src_page, uint8_t dst_page) { modex_copy_rect(src_page, dst_page, 0, 0, VGA_SCREEN_WIDTH - 1, modex_height - 1); }
+
+/**
+ * @brief draw a pixel on a planar surface. No clipping is done.
+ *
+ * @param s the surface.
+ * @param x x position.
+ * @param y y position.
+ * @param c color index.
+ */
+void modex_put_pixel(surface_t *s, int16_t x, int16_t y, color_t c) {
+    modex_map_mask(1 << (x & 3));
+    modex_store(s->data, (uint16_t)y * s->stride + (x >> 2), c);
+}
+
+/**
+ * @brief read a pixel from a planar surface. No bounds checking is done.
+ *
+ * @param s the surface.
+ * @param x x position.
+ * @param y y position.
+ *
+ * @return color index.
+ */
+color_t modex_get_pixel(surface_t *s, int16_t x, int16_t y) {
+    uint16_t offset = (uint16_t)y * s->stride + (x >> 2);
+
+    if (modex_emulated) {
+        return s->data[(uint32_t)offset * MODEX_PLANES + (x & 3)];
+    } else {
+        MODEX_OUT(MODEX_GC_INDEX, MODEX_GC_READ_MAP, x & 3);
+        return s->data[offset];
+    }
+}
+
+/**
+ * @brief fill a horizontal span on a planar surface. Four pixels are written with every byte between the partial first and last byte.
+ * No clipping is done.
+ *
+ * @param s the surface.
+ * @param y y position.
+ * @param x1 x start, must be <= x2.
+ * @param x2 x end.
+ * @param c color index.
+ */
+void modex_fill_span(surface_t *s, int16_t y, int16_t x1, int16_t x2, color_t c) {
+    uint16_t row = (uint16_t)y * s->stride;
+    uint16_t first = row + (x1 >> 2);
+    uint16_t last = row + (x2 >> 2);
+    uint8_t left_mask = (MODEX_ALL_PLANES << (x1 & 3)) & MODEX_ALL_PLANES;
+    uint8_t right_mask = MODEX_ALL_PLANES >> (3 - (x2 & 3));
+    uint16_t middle;
+
+    if (first == last) {
+        modex_map_mask(left_mask & right_mask);
+        modex_store(s->data, first, c);
+        return;
+    }
+
+    modex_map_mask(left_mask);
+    modex_store(s->data, first, c);
+
+    middle = last - first - 1;
+    if (middle) {
+        modex_map_mask(MODEX_ALL_PLANES);
+        if (modex_emulated) {
+            modex_emu_fill(s->data, first + 1, c, middle);
+        } else {
+            span_fill(&s->data[first + 1], c, middle);
+        }
+    }
+
+    modex_map_mask(right_mask);
+    modex_store(s->data, last, c);
+}
+
+/**
+ * @brief copy a horizontal span of linear pixels to a planar surface. The map mask is changed only four times, each plane gets every
+ * fourth source pixel. No clipping is done.
+ *
+ * @param s the surface.
+ * @param x x start
+ * @param y y position.
+ * @param src the pixels to copy.
+ * @param len number of pixels.
+ */
+void modex_copy_span(surface_t *s, int16_t x, int16_t y, const uint8_t *src, uint16_t len) {
+    uint16_t row = (uint16_t)y * s->stride;
+    uint16_t i, n, offset;
+    uint8_t plane;
+
+    for (i = 0; (i < MODEX_PLANES) && (i < len); i++) {
+        plane = (x + i) & 3;
+        offset = row + ((x + i) >> 2);
+        modex_map_mask(1 << plane);
+        if (modex_emulated) {
+            for (n = i; n < len; n += MODEX_PLANES, offset++) {
+                s->data[(uint32_t)offset * MODEX_PLANES + plane] = src[n];
+            }
+        } else {
+            for (n = i; n < len; n += MODEX_PLANES, offset++) {
+                s->data[offset] = src[n];
+            }
+        }
+    }
+}
@@ -0,0 +1,56 @@
+/**
+ * @file modex.c
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief unchained VGA 256 color modes (Mode X) with multiple pages.
+ *
+ * @copyright SuperIlu
+ *
+ * Register values are taken from Michael Abrash's Graphics Programming Black Book, chapter 47.
+ */
+#ifndef __MODEX_H_
+#define __MODEX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vga.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define MODEX_PLANES 4            //!< number of bit planes
+#define MODEX_STRIDE 80           //!< bytes per scanline in each plane
+#define MODEX_HEIGHT_200 200      //!< 320x200 unchained
+#define MODEX_HEIGHT_240 240      //!< 320x240 unchained (square pixels)
+#define MODEX_MEMORY_SIZE 0x40000L  //!< size of the RAM needed for modex_emulate(), 4 planes * 64KB
+
+/* ======================================================================
+** global variables
+** ====================================================================== */
+extern uint16_t modex_height;
+extern uint8_t modex_num_pages;
+extern uint8_t modex_draw_page;
+extern uint8_t modex_visible_page;
+extern bool modex_emulated;
+
+/* ======================================================================
+** prototypes
+** ====================================================================== */
+extern bool modex_init(uint16_t height);
+extern bool modex_emulate(uint16_t height);
+extern void modex_exit(void);
+extern uint8_t *modex_page(uint8_t page);
+extern void modex_get_surface(uint8_t page, surface_t *s);
+extern void modex_set_draw_page(uint8_t page);
+extern void modex_show_page(uint8_t page);
+extern void modex_set_start(uint16_t start, uint8_t pan);
+extern void modex_set_stride(uint16_t stride);
+extern void modex_flip(void);
+extern void modex_copy_rect(uint8_t src_page, uint8_t dst_page, int16_t left, int16_t top, int16_t right, int16_t bottom);
+extern void modex_copy_page(uint8_t src_page, uint8_t dst_page);
+extern void modex_put_pixel(surface_t *s, int16_t x, int16_t y, color_t c);
+extern color_t modex_get_pixel(surface_t *s, int16_t x, int16_t y);
+extern void modex_fill_span(surface_t *s, int16_t y, int16_t x1, int16_t x2, color_t c);
+extern void modex_copy_span(surface_t *s, int16_t x, int16_t y, const uint8_t *src, uint16_t len);
+
+#endif  // __MODEX_H_
@@ -11,6 +11,7 @@
 
 #include "vga.h"
 #include "mouse.h"
+#include "csprite.h"
 #include "error.h"
 
 /* ======================================================================
@@ -67,6 +68,42 @@ const mouse_pointer_t MOUSE_POINTER = {
 //! static buffer for mouse data updates
 static mouse_t mouse_data;
 
+/* ======================================================================
+** private functions
+** ====================================================================== */
+/**
+ * @brief run length encode a cursor. Every scanline is stored as a list of runs (number of transparent pixels to skip,
+ * number of opaque pixels, the opaque pixels) followed by MOUSE_RLE_END.
+ *
+ * @param image the cursor.
+ * @param rle receives up to MOUSE_RLE_SIZE bytes.
+ */
+static void mouse_encode(const mouse_pointer_t *image, uint8_t *rle) {
+    const uint8_t *row = image->img;
+    uint8_t x, start, y, *len;
+
+    for (y = 0; y < MOUSE_CURSOR_HEIGHT; y++, row += MOUSE_CURSOR_WIDTH) {
+        x = 0;
+        while (x < MOUSE_CURSOR_WIDTH) {
+            start = x;
+            while ((x < MOUSE_CURSOR_WIDTH) && !row[x]) {
+                x++;
+            }
+            if (x >= MOUSE_CURSOR_WIDTH) {
+                break;
+            }
+            *rle++ = x - start;
+            len = rle++;
+            *len = 0;
+            while ((x < MOUSE_CURSOR_WIDTH) && row[x]) {
+                *rle++ = row[x++];
+                (*len)++;
+            }
+        }
+        *rle++ = MOUSE_RLE_END;
+    }
+}
+
 /* ======================================================================
 ** public functions
 ** ====================================================================== */
@@ -88,8 +125,14 @@ mouse_t* mouse_init(const mouse_pointer_t* image) {
         return NULL;
     }
 
+    vga_hide_mouse(&mouse_data);
     mouse_update(false);
     memcpy(&mouse_data.cursor, image, sizeof(mouse_pointer_t));
+    mouse_encode(image, mouse_data.rle);
+
+    // compile the cursor for the screen, vga_show_mouse() uses the runs if this fails or the cursor is partly off screen
+    csprite_free(mouse_data.compiled);
+    mouse_data.compiled = csprite_create_raw(image->img, MOUSE_CURSOR_WIDTH, MOUSE_CURSOR_HEIGHT, 0, VGA_SCREEN_WIDTH);
     ERR_OK();
     return &mouse_data;
 }
@@ -97,15 +140,12 @@ mouse_t* mouse_init(const mouse_pointer_t* image) {
 /**
  * @brief update the data in mouse_t
  *
- * @param show true to show the cursor, false to hide it
+ * @param show true to show the cursor at the new position. It is only redrawn if it has moved, so this can be called as
+ * often as needed. Call vga_wait_for_retrace() before if the cursor must not flicker.
  */
 void mouse_update(bool show) {
     union REGS regs;
 
-    if (show) {
-        vga_hide_mouse(&mouse_data);
-    }
-
     regs.x.ax = INT_MOUSE_UPDATE;
     int86(INT_MOUSE, &regs, &regs);
 
@@ -24,6 +24,9 @@
 #define MOUSE_CURSOR_WIDTH 12   //!< width of a mouse pointer
 #define MOUSE_CURSOR_HEIGHT 12  //!< height of a mouse pointer
 
+#define MOUSE_RLE_END 0xFF                                                 //!< end of a scanline in mouse_t.rle
+#define MOUSE_RLE_SIZE (MOUSE_CURSOR_HEIGHT * (MOUSE_CURSOR_WIDTH * 2 + 2))  //!< max size of the run length encoded cursor
+
 /* ======================================================================
 ** typedefs
 ** ====================================================================== */
@@ -43,8 +46,17 @@ typedef struct __mouse {
     bool right;        //!< right button is pressed right now true/false
     bool middle;       //!< middle button is pressed right now true/false
 
-    mouse_pointer_t cursor[MOUSE_CURSOR_WIDTH * MOUSE_CURSOR_HEIGHT];  //!< cursor image
-    mouse_pointer_t under[MOUSE_CURSOR_WIDTH * MOUSE_CURSOR_HEIGHT];   //!< original image under cursor
+    mouse_pointer_t cursor;                                   //!< cursor image
+    uint8_t rle[MOUSE_RLE_SIZE];                              //!< cursor image as runs of opaque pixels, see mouse_init()
+    struct __csprite *compiled;                               //!< cursor image compiled by mouse_init() or NULL
+    bool visible;                                             //!< the cursor is drawn on screen
+    int16_t shown_x;                                          //!< x position of the top left corner of the drawn cursor
+    int16_t shown_y;                                          //!< y position of the top left corner of the drawn cursor
+    int16_t under_x;                                          //!< x start of the saved area
+    int16_t under_y;                                          //!< y start of the saved area
+    uint8_t under_width;                                      //!< width of the saved area, the cursor clipped to the screen
+    uint8_t under_height;                                     //!< height of the saved area
+    uint8_t under[MOUSE_CURSOR_WIDTH * MOUSE_CURSOR_HEIGHT];  //!< original image under cursor, under_width bytes per row
 } mouse_t;
 
 /* ======================================================================
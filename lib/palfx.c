@@ -0,0 +1,461 @@
+/**
+ * @file palfx.c
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief palette effects: fades, color cycling and flashes uploaded to the DAC during the vertical retrace.
+ *
+ * @copyright SuperIlu
+ *
+ * All effects work on a shadow copy of the palette. Changed entries are marked dirty and pal_vsync() uploads them
+ * at the start of the next vertical retrace, at most pal_entries_per_retrace entries per retrace so the DAC is never
+ * written while the beam is visible (which causes "snow" on some cards). Entries that do not fit into one retrace
+ * stay queued for the next one.
+ *
+ * Fades precompute a fixed point increment for every channel when they are started, each frame then only needs
+ * one addition per channel. The last step always sets the exact target colors.
+ *
+ * pal_fake_dac() redirects all uploads into a RAM array and skips the retrace polling, so the effects can be run
+ * without VGA hardware.
+ */
+#include <stddef.h>
+#include <conio.h>
+#include <mem.h>
+
+#include "palfx.h"
+#include "fixed.h"
+#include "error.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define PAL_WRITE_INDEX 0x03C8   //!< DAC write index register
+#define PAL_DATA 0x03C9          //!< DAC data register
+#define PAL_INPUT_STATUS 0x03DA  //!< input status register
+#define PAL_VRETRACE 0x08        //!< input status: vertical retrace
+#define PAL_COLOR_SHIFT 2        //!< shift 8bit colors to 6bit DAC values
+#define PAL_CHANNELS 3           //!< red, green and blue
+
+//! true if a palette entry is waiting for upload
+#define PAL_IS_DIRTY(idx) (pal_dirty[(idx) >> 3] & (1 << ((idx)&7)))
+
+/* ======================================================================
+** global variables
+** ====================================================================== */
+uint16_t pal_entries_per_retrace = PAL_DEFAULT_CHUNK;  //!< max number of entries uploaded in one retrace, see pal_calibrate()
+uint16_t pal_last_uploaded = 0;                        //!< number of entries uploaded by the last call to pal_vsync()
+
+/* ======================================================================
+** local variables
+** ====================================================================== */
+static palette_color_t pal_current[VGA_MAX_COLORS];  //!< colors the DAC should show
+static palette_color_t pal_base[VGA_MAX_COLORS];     //!< the normal palette, used by pal_fade_in() and pal_flash()
+static palette_color_t pal_target[VGA_MAX_COLORS];   //!< final colors of the running fade
+static fixed16_16 pal_pos[PAL_DAC_SIZE];             //!< exact channel values of the running fade
+static fixed16_16 pal_delta[PAL_DAC_SIZE];           //!< per frame increment of the channel values
+static uint16_t pal_steps = 0;                       //!< frames left for the running fade
+
+static uint8_t pal_dirty[VGA_MAX_COLORS / 8];  //!< one bit for every entry waiting for upload
+static uint16_t pal_num_dirty = 0;             //!< number of entries waiting for upload
+static uint8_t pal_next = 0;                   //!< first entry looked at by the next upload
+
+static pal_cycle_t pal_cycles[PAL_MAX_CYCLES];  //!< color cycling ranges
+static uint8_t pal_num_cycles = 0;              //!< number of used entries in pal_cycles
+
+static uint8_t *pal_fake = NULL;  //!< fake DAC or NULL for the VGA DAC
+static uint16_t pal_fake_pos = 0;  //!< write position in the fake DAC
+
+/* ======================================================================
+** private functions
+** ====================================================================== */
+/**
+ * @brief queue a range of entries for upload.
+ *
+ * @param first first entry.
+ * @param last last entry.
+ */
+static void pal_mark(uint8_t first, uint8_t last) {
+    uint16_t i;
+
+    for (i = first; i <= last; i++) {
+        if (!PAL_IS_DIRTY(i)) {
+            pal_dirty[i >> 3] |= 1 << (i & 7);
+            pal_num_dirty++;
+        }
+    }
+}
+
+/**
+ * @brief set the DAC write index.
+ *
+ * @param idx the first entry written by pal_dac_write().
+ */
+static void pal_dac_index(uint8_t idx) {
+    vga_palette_changes++;
+    if (pal_fake) {
+        pal_fake_pos = (uint16_t)idx * PAL_CHANNELS;
+    } else {
+        outp(PAL_WRITE_INDEX, idx);
+    }
+}
+
+/**
+ * @brief write one color to the DAC, the DAC index is incremented (and wraps from 255 to 0).
+ *
+ * @param c the color.
+ */
+static void pal_dac_write(palette_color_t *c) {
+    if (pal_fake) {
+        pal_fake[pal_fake_pos++] = c->red >> PAL_COLOR_SHIFT;
+        pal_fake[pal_fake_pos++] = c->green >> PAL_COLOR_SHIFT;
+        pal_fake[pal_fake_pos++] = c->blue >> PAL_COLOR_SHIFT;
+        if (pal_fake_pos >= PAL_DAC_SIZE) {
+            pal_fake_pos = 0;
+        }
+    } else {
+        outp(PAL_DATA, c->red >> PAL_COLOR_SHIFT);
+        outp(PAL_DATA, c->green >> PAL_COLOR_SHIFT);
+        outp(PAL_DATA, c->blue >> PAL_COLOR_SHIFT);
+    }
+}
+
+/**
+ * @brief wait for the start of the next vertical retrace. Returns immediately for a fake DAC.
+ */
+static void pal_wait_retrace(void) {
+    if (!pal_fake) {
+        while (inp(PAL_INPUT_STATUS) & PAL_VRETRACE) {
+        }
+        while (!(inp(PAL_INPUT_STATUS) & PAL_VRETRACE)) {
+        }
+    }
+}
+
+/**
+ * @brief rotate a range of palette entries by one.
+ *
+ * @param data array with one element per palette entry.
+ * @param size size of one element in bytes.
+ * @param first first entry.
+ * @param last last entry.
+ * @param reverse false to move every element to the next higher entry, true to move it to the next lower entry.
+ */
+static void pal_rotate(uint8_t *data, uint16_t size, uint8_t first, uint8_t last, bool reverse) {
+    uint8_t tmp[PAL_CHANNELS * sizeof(fixed16_16)];
+    uint8_t *p = &data[(uint16_t)first * size];
+    uint16_t len = (uint16_t)(last - first) * size;
+
+    if (reverse) {
+        memcpy(tmp, p, size);
+        memmove(p, p + size, len);
+        memcpy(p + len, tmp, size);
+    } else {
+        memcpy(tmp, p + len, size);
+        memmove(p + size, p, len);
+        memcpy(p, tmp, size);
+    }
+}
+
+/**
+ * @brief start fading from the current colors to pal_target.
+ *
+ * @param steps number of frames, 0 sets the target colors immediately.
+ */
+static void pal_start_fade(uint16_t steps) {
+    uint8_t *cur = (uint8_t *)pal_current, *dst = (uint8_t *)pal_target;
+    uint16_t i;
+
+    if (!steps) {
+        memcpy(pal_current, pal_target, sizeof(pal_current));
+        pal_mark(0, VGA_MAX_COLORS - 1);
+        pal_steps = 0;
+        return;
+    }
+
+    for (i = 0; i < PAL_DAC_SIZE; i++) {
+        pal_pos[i] = TO_FIXED((fixed16_16)cur[i]);
+        pal_delta[i] = TO_FIXED((fixed16_16)dst[i] - cur[i]) / steps;
+    }
+    pal_steps = steps;
+}
+
+/**
+ * @brief advance the running fade by one frame and queue all entries that changed.
+ */
+static void pal_fade_step(void) {
+    uint8_t *cur = (uint8_t *)pal_current, *dst = (uint8_t *)pal_target;
+    uint16_t i, e;
+    uint8_t v;
+    bool changed;
+
+    pal_steps--;
+    for (e = 0, i = 0; e < VGA_MAX_COLORS; e++) {
+        changed = false;
+        for (; i < (e + 1) * PAL_CHANNELS; i++) {
+            if (pal_steps) {
+                pal_pos[i] += pal_delta[i];
+                v = (uint8_t)FROM_FIXED_I(pal_pos[i] + FIXED_POINT_FACTOR / 2);
+            } else {
+                v = dst[i];
+            }
+            if (cur[i] != v) {
+                cur[i] = v;
+                changed = true;
+            }
+        }
+        if (changed) {
+            pal_mark(e, e);
+        }
+    }
+}
+
+/* ======================================================================
+** public functions
+** ====================================================================== */
+/**
+ * @brief set the palette used by the effects, stop all effects and queue the whole palette for upload.
+ *
+ * @param palette pointer to an array of colors.
+ * @param size number of colors in the palette, missing colors are set to black.
+ */
+void pal_init(palette_color_t *palette, uint16_t size) {
+    if (size > VGA_MAX_COLORS) {
+        size = VGA_MAX_COLORS;
+    }
+    memset(pal_current, 0, sizeof(pal_current));
+    memcpy(pal_current, palette, size * sizeof(palette_color_t));
+    memcpy(pal_base, pal_current, sizeof(pal_base));
+    memcpy(pal_target, pal_current, sizeof(pal_target));
+    pal_steps = 0;
+    pal_num_cycles = 0;
+    pal_mark(0, VGA_MAX_COLORS - 1);
+}
+
+/**
+ * @brief redirect all uploads into RAM instead of the VGA DAC. The retrace is not waited for in this mode.
+ *
+ * @param dac PAL_DAC_SIZE bytes receiving the 6bit DAC values or NULL to use the VGA DAC again.
+ */
+void pal_fake_dac(uint8_t *dac) {
+    pal_fake = dac;
+    pal_fake_pos = 0;
+}
+
+/**
+ * @brief measure how many palette entries can be written during one vertical retrace and use this as the
+ * upload limit of pal_vsync(). The DAC is rewritten with the colors it should already show, call pal_init() first.
+ *
+ * @return the number of entries per retrace.
+ */
+uint16_t pal_calibrate(void) {
+    uint16_t n;
+
+    if (pal_fake) {
+        return pal_entries_per_retrace;
+    }
+
+    pal_wait_retrace();
+    pal_dac_index(0);
+    for (n = 0; inp(PAL_INPUT_STATUS) & PAL_VRETRACE; n++) {
+        pal_dac_write(&pal_current[n & (VGA_MAX_COLORS - 1)]);
+    }
+
+    pal_entries_per_retrace = n ? n : 1;
+    return pal_entries_per_retrace;
+}
+
+/**
+ * @brief change a single color of the palette. The change is permanent, fades end with the new color.
+ *
+ * @param idx color index.
+ * @param c the new color.
+ */
+void pal_set_color(uint8_t idx, palette_color_t *c) {
+    uint16_t i = (uint16_t)idx * PAL_CHANNELS;
+
+    pal_current[idx] = *c;
+    pal_base[idx] = *c;
+    pal_target[idx] = *c;
+    pal_pos[i] = TO_FIXED((fixed16_16)c->red);
+    pal_pos[i + 1] = TO_FIXED((fixed16_16)c->green);
+    pal_pos[i + 2] = TO_FIXED((fixed16_16)c->blue);
+    pal_delta[i] = pal_delta[i + 1] = pal_delta[i + 2] = 0;
+    pal_mark(idx, idx);
+}
+
+/**
+ * @brief get a color as it is (or will be after the next upload) shown by the DAC.
+ *
+ * @param idx color index.
+ * @param c receives the color.
+ */
+void pal_get_color(uint8_t idx, palette_color_t *c) { *c = pal_current[idx]; }
+
+/**
+ * @brief crossfade from the current colors to a new palette. The new palette becomes the normal palette.
+ *
+ * @param target VGA_MAX_COLORS colors.
+ * @param steps duration in frames (calls to pal_update()), 0 sets the colors immediately.
+ */
+void pal_fade_to(palette_color_t *target, uint16_t steps) {
+    memcpy(pal_base, target, sizeof(pal_base));
+    memcpy(pal_target, target, sizeof(pal_target));
+    pal_start_fade(steps);
+}
+
+/**
+ * @brief fade the current colors to black. The normal palette is kept for pal_fade_in().
+ *
+ * @param steps duration in frames (calls to pal_update()), 0 sets the colors immediately.
+ */
+void pal_fade_out(uint16_t steps) {
+    memset(pal_target, 0, sizeof(pal_target));
+    pal_start_fade(steps);
+}
+
+/**
+ * @brief fade the current colors to the normal palette.
+ *
+ * @param steps duration in frames (calls to pal_update()), 0 sets the colors immediately.
+ */
+void pal_fade_in(uint16_t steps) {
+    memcpy(pal_target, pal_base, sizeof(pal_target));
+    pal_start_fade(steps);
+}
+
+/**
+ * @brief set all entries to one color and fade back to the normal palette.
+ *
+ * @param c the flash color.
+ * @param steps duration of the fade back in frames (calls to pal_update()).
+ */
+void pal_flash(palette_color_t *c, uint16_t steps) {
+    uint16_t i;
+
+    for (i = 0; i < VGA_MAX_COLORS; i++) {
+        pal_current[i] = *c;
+    }
+    pal_mark(0, VGA_MAX_COLORS - 1);
+    pal_fade_in(steps);
+}
+
+/**
+ * @brief check if a fade is running.
+ *
+ * @return true if a fade is running.
+ */
+bool pal_fading(void) { return pal_steps != 0; }
+
+/**
+ * @brief add a color cycling range. The colors of the range are rotated by one entry every delay frames.
+ *
+ * @param first first palette entry.
+ * @param last last palette entry.
+ * @param delay number of frames (calls to pal_update()) between two steps.
+ * @param reverse false to move the colors towards higher indices, true to move them towards lower indices.
+ *
+ * @return true if the range was added, false if the parameters are invalid or PAL_MAX_CYCLES ranges are used.
+ */
+bool pal_add_cycle(uint8_t first, uint8_t last, uint8_t delay, bool reverse) {
+    pal_cycle_t *cy;
+
+    if ((first >= last) || !delay || (pal_num_cycles >= PAL_MAX_CYCLES)) {
+        ERR_PARAM();
+        return false;
+    }
+    cy = &pal_cycles[pal_num_cycles++];
+    cy->first = first;
+    cy->last = last;
+    cy->delay = delay;
+    cy->count = delay;
+    cy->reverse = reverse;
+
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief remove all color cycling ranges. The colors stay where they are.
+ */
+void pal_clear_cycles(void) { pal_num_cycles = 0; }
+
+/**
+ * @brief advance all effects by one frame and queue the changed entries. Call this once per frame before pal_vsync().
+ *
+ * @return true if a fade is still running.
+ */
+bool pal_update(void) {
+    pal_cycle_t *cy;
+    uint8_t i;
+
+    if (pal_steps) {
+        pal_fade_step();
+    }
+
+    for (i = 0; i < pal_num_cycles; i++) {
+        cy = &pal_cycles[i];
+        if (--cy->count) {
+            continue;
+        }
+        cy->count = cy->delay;
+
+        // everything belonging to an entry moves with it, so fades and cycling can run at the same time
+        pal_rotate((uint8_t *)pal_current, sizeof(palette_color_t), cy->first, cy->last, cy->reverse);
+        pal_rotate((uint8_t *)pal_base, sizeof(palette_color_t), cy->first, cy->last, cy->reverse);
+        pal_rotate((uint8_t *)pal_target, sizeof(palette_color_t), cy->first, cy->last, cy->reverse);
+        pal_rotate((uint8_t *)pal_pos, PAL_CHANNELS * sizeof(fixed16_16), cy->first, cy->last, cy->reverse);
+        pal_rotate((uint8_t *)pal_delta, PAL_CHANNELS * sizeof(fixed16_16), cy->first, cy->last, cy->reverse);
+        pal_mark(cy->first, cy->last);
+    }
+
+    return pal_steps != 0;
+}
+
+/**
+ * @brief get the number of entries waiting for upload.
+ *
+ * @return number of queued entries.
+ */
+uint16_t pal_pending(void) { return pal_num_dirty; }
+
+/**
+ * @brief wait for the start of the vertical retrace and upload up to pal_entries_per_retrace queued entries.
+ * Consecutive entries are written with a single index write. The next call continues where this one stopped,
+ * so no entry is starved when more entries change every frame than fit into a retrace.
+ * Can be used instead of vga_wait_for_retrace().
+ *
+ * @return the number of entries still queued.
+ */
+uint16_t pal_vsync(void) {
+    uint16_t i, n = 0;
+    uint8_t idx = pal_next;
+    bool open = false;
+
+    pal_wait_retrace();
+
+    for (i = 0; (i < VGA_MAX_COLORS) && pal_num_dirty && (n < pal_entries_per_retrace); i++, idx++) {
+        if (!PAL_IS_DIRTY(idx)) {
+            open = false;
+            continue;
+        }
+        if (!open) {
+            pal_dac_index(idx);
+            open = true;
+        }
+        pal_dac_write(&pal_current[idx]);
+        pal_dirty[idx >> 3] &= ~(1 << (idx & 7));
+        pal_num_dirty--;
+        n++;
+    }
+    pal_next = idx;
+    pal_last_uploaded = n;
+
+    return pal_num_dirty;
+}
+
+/**
+ * @brief upload all queued entries, using as many retraces as needed.
+ */
+void pal_flush(void) {
+    while (pal_num_dirty) {
+        pal_vsync();
+    }
+}
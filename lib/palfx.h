@@ -0,0 +1,61 @@
+/**
+ * @file palfx.h
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief palette effects: fades, color cycling and flashes uploaded to the DAC during the vertical retrace.
+ *
+ * @copyright SuperIlu
+ */
+#ifndef __PALFX_H_
+#define __PALFX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vga.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define PAL_MAX_CYCLES 8          //!< max number of color cycling ranges
+#define PAL_DEFAULT_CHUNK 128     //!< entries uploaded per retrace until pal_calibrate() was called
+#define PAL_DAC_SIZE (VGA_MAX_COLORS * 3)  //!< size of a fake DAC in bytes, see pal_fake_dac()
+
+/* ======================================================================
+** typedefs
+** ====================================================================== */
+//! a color cycling range
+typedef struct __pal_cycle {
+    uint8_t first;  //!< first palette entry
+    uint8_t last;   //!< last palette entry
+    uint8_t delay;  //!< number of frames between two steps
+    uint8_t count;  //!< frames left until the next step
+    bool reverse;   //!< true to rotate the colors towards lower indices
+} pal_cycle_t;
+
+/* ======================================================================
+** global variables
+** ====================================================================== */
+extern uint16_t pal_entries_per_retrace;
+extern uint16_t pal_last_uploaded;
+
+/* ======================================================================
+** prototypes
+** ====================================================================== */
+extern void pal_init(palette_color_t *palette, uint16_t size);
+extern void pal_fake_dac(uint8_t *dac);
+extern uint16_t pal_calibrate(void);
+extern void pal_set_color(uint8_t idx, palette_color_t *c);
+extern void pal_get_color(uint8_t idx, palette_color_t *c);
+extern void pal_fade_to(palette_color_t *target, uint16_t steps);
+extern void pal_fade_out(uint16_t steps);
+extern void pal_fade_in(uint16_t steps);
+extern void pal_flash(palette_color_t *c, uint16_t steps);
+extern bool pal_fading(void);
+extern bool pal_add_cycle(uint8_t first, uint8_t last, uint8_t delay, bool reverse);
+extern void pal_clear_cycles(void);
+extern bool pal_update(void);
+extern uint16_t pal_pending(void);
+extern uint16_t pal_vsync(void);
+extern void pal_flush(void);
+
+#endif  // __PALFX_H_
@@ -0,0 +1,208 @@
+/**
+ * @file scroll.c
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief hardware smooth scrolling in the unchained modes with the CRTC start address and pel panning.
+ *
+ * @copyright SuperIlu
+ *
+ * While scrolling the whole VGA memory is used as one buffer that is SCROLL_STRIDE bytes wide and wraps at 64KB.
+ * World pixel (x, y) is always stored in plane (x & 3) at offset (y * SCROLL_STRIDE + x / 4) modulo 64KB, so moving the
+ * view only changes the CRTC start address (in steps of four pixels) and the pel panning (the remaining 0..3 pixels).
+ * The view plus the column pel panning shifts in never overlaps itself in this buffer, pixels that stay visible are never
+ * touched. Only the strips that become visible are drawn by the scroll_draw_t callback, before the view is moved.
+ * Strips of up to SCROLL_MAX_STEP_X columns and a few hundred rows are drawn into memory that is not displayed.
+ *
+ * The pages, modex_flip() and the screen surface must not be used between scroll_init() and scroll_exit(),
+ * use scroll_surface() to draw in world coordinates instead.
+ */
+#include <stddef.h>
+
+#include "scroll.h"
+#include "error.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define SCROLL_VIEW_WIDTH (SCROLL_VIEW_BYTES * MODEX_PLANES)  //!< width of the area kept up to date in pixels
+
+//! CRTC start address for a view position
+#define SCROLL_START(x, y) ((uint16_t)((uint16_t)(y)*SCROLL_STRIDE + ((x) >> 2)))
+
+/* ======================================================================
+** global variables
+** ====================================================================== */
+int16_t scroll_x = 0;            //!< world x position of the top left pixel of the display
+int16_t scroll_y = 0;            //!< world y position of the top left pixel of the display
+uint32_t scroll_last_drawn = 0;  //!< number of pixels the callback had to draw for the last view change
+
+/* ======================================================================
+** local variables
+** ====================================================================== */
+static scroll_draw_t scroll_draw = NULL;  //!< callback for newly exposed areas or NULL if scrolling is not active
+static surface_t scroll_world;            //!< surface in world coordinates
+
+/* ======================================================================
+** private functions
+** ====================================================================== */
+/**
+ * @brief let the callback draw an area of the world.
+ *
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ */
+static void scroll_strip(int16_t left, int16_t top, int16_t right, int16_t bottom) {
+    scroll_world.clip.left = left;
+    scroll_world.clip.top = top;
+    scroll_world.clip.right = right;
+    scroll_world.clip.bottom = bottom;
+    scroll_draw(&scroll_world, left, top, right, bottom);
+    scroll_last_drawn += (uint32_t)(right - left + 1) * (bottom - top + 1);
+}
+
+/**
+ * @brief draw everything that is visible at a view position, including the column for pel panning.
+ *
+ * @param x world x position of the view.
+ * @param y world y position of the view.
+ */
+static void scroll_fill_view(int16_t x, int16_t y) {
+    x &= ~3;
+    scroll_strip(x, y, x + SCROLL_VIEW_WIDTH - 1, y + modex_height - 1);
+}
+
+/* ======================================================================
+** public functions
+** ====================================================================== */
+/**
+ * @brief start scrolling in the active unchained mode. The CRTC is switched to SCROLL_STRIDE bytes per scanline
+ * and the whole view is drawn by the callback.
+ *
+ * @param draw callback that draws newly exposed areas of the world.
+ * @param x world x position of the top left pixel of the display.
+ * @param y world y position of the top left pixel of the display.
+ *
+ * @return true if scrolling was started, false if no unchained mode is active.
+ */
+bool scroll_init(scroll_draw_t draw, int16_t x, int16_t y) {
+    if (!draw) {
+        ERR_PARAM();
+        return false;
+    }
+    if (!modex_height) {
+        ERR_AVAIL();
+        return false;
+    }
+
+    scroll_draw = draw;
+    vga_surface_init(&scroll_world, VGA_MEMORY, SCROLL_STRIDE, INT16_MAX, INT16_MAX);
+    scroll_world.flags = VGA_SURFACE_PLANAR;
+    modex_set_stride(SCROLL_STRIDE);
+    scroll_x = x;
+    scroll_y = y;
+    scroll_redraw();
+    modex_set_start(SCROLL_START(x, y), x & 3);
+
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief stop scrolling. The CRTC is switched back to MODEX_STRIDE and the visible page is displayed again,
+ * the contents of all pages are undefined afterwards.
+ */
+void scroll_exit(void) {
+    if (!scroll_draw) {
+        return;
+    }
+    scroll_draw = NULL;
+    modex_set_stride(MODEX_STRIDE);
+    modex_show_page(modex_visible_page);
+}
+
+/**
+ * @brief move the view to a new world position. The callback draws the strips that become visible, then the
+ * new start address and pel panning are set. Returns in the vertical retrace after the new position was latched.
+ * Views that do not overlap the current one are drawn completely.
+ *
+ * @param x world x position of the top left pixel of the display.
+ * @param y world y position of the top left pixel of the display.
+ */
+void scroll_to(int16_t x, int16_t y) {
+    int16_t ox1, ox2, oy1, oy2, nx1, nx2, ny1, ny2, top, bottom;
+
+    if (!scroll_draw) {
+        return;
+    }
+    scroll_last_drawn = 0;
+
+    // areas kept up to date for the old and the new view
+    ox1 = scroll_x & ~3;
+    ox2 = ox1 + SCROLL_VIEW_WIDTH - 1;
+    oy1 = scroll_y;
+    oy2 = oy1 + modex_height - 1;
+    nx1 = x & ~3;
+    nx2 = nx1 + SCROLL_VIEW_WIDTH - 1;
+    ny1 = y;
+    ny2 = ny1 + modex_height - 1;
+
+    if ((nx1 > ox2) || (nx2 < ox1) || (ny1 > oy2) || (ny2 < oy1)) {
+        scroll_fill_view(x, y);
+    } else {
+        // full width strips above/below the old view
+        if (ny1 < oy1) {
+            scroll_strip(nx1, ny1, nx2, oy1 - 1);
+        }
+        if (ny2 > oy2) {
+            scroll_strip(nx1, oy2 + 1, nx2, ny2);
+        }
+
+        // columns left/right of the old view for the remaining rows
+        top = ny1 > oy1 ? ny1 : oy1;
+        bottom = ny2 < oy2 ? ny2 : oy2;
+        if (nx1 < ox1) {
+            scroll_strip(nx1, top, ox1 - 1, bottom);
+        }
+        if (nx2 > ox2) {
+            scroll_strip(ox2 + 1, top, nx2, bottom);
+        }
+    }
+
+    scroll_x = x;
+    scroll_y = y;
+    modex_set_start(SCROLL_START(x, y), x & 3);
+}
+
+/**
+ * @brief move the view relative to its current position, see scroll_to().
+ *
+ * @param dx pixels to move right (or left if negative).
+ * @param dy pixels to move down (or up if negative).
+ */
+void scroll_by(int16_t dx, int16_t dy) { scroll_to(scroll_x + dx, scroll_y + dy); }
+
+/**
+ * @brief let the callback draw the whole view again, e.g. after the world has changed.
+ */
+void scroll_redraw(void) {
+    if (!scroll_draw) {
+        return;
+    }
+    scroll_last_drawn = 0;
+    scroll_fill_view(scroll_x, scroll_y);
+}
+
+/**
+ * @brief get a surface in world coordinates that is clipped to the visible area, e.g. to draw sprites on top of the world.
+ * Everything drawn stays until the callback draws over it.
+ *
+ * @return the surface.
+ */
+surface_t *scroll_surface(void) {
+    scroll_world.clip.left = scroll_x;
+    scroll_world.clip.top = scroll_y;
+    scroll_world.clip.right = scroll_x + VGA_SCREEN_WIDTH - 1;
+    scroll_world.clip.bottom = scroll_y + modex_height - 1;
+    return &scroll_world;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file scroll.h
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief hardware smooth scrolling in the unchained modes with the CRTC start address and pel panning.
+ *
+ * @copyright SuperIlu
+ */
+#ifndef __SCROLL_H_
+#define __SCROLL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vga.h"
+#include "modex.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define SCROLL_STRIDE 88                      //!< bytes per scanline in each plane while scrolling (352 pixels)
+#define SCROLL_VIEW_BYTES (MODEX_STRIDE + 1)  //!< bytes of a scanline that can be visible, one more than MODEX_STRIDE for pel panning
+#define SCROLL_MAX_STEP_X ((SCROLL_STRIDE - SCROLL_VIEW_BYTES) * MODEX_PLANES)  //!< larger horizontal steps may show the new strip before it is finished
+
+/* ======================================================================
+** typedefs
+** ====================================================================== */
+/**
+ * @brief callback that draws a newly exposed part of the world.
+ *
+ * @param s surface in world coordinates, clipped to the area.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ */
+typedef void (*scroll_draw_t)(surface_t *s, int16_t left, int16_t top, int16_t right, int16_t bottom);
+
+/* ======================================================================
+** global variables
+** ====================================================================== */
+extern int16_t scroll_x;
+extern int16_t scroll_y;
+extern uint32_t scroll_last_drawn;
+
+/* ======================================================================
+** prototypes
+** ====================================================================== */
+extern bool scroll_init(scroll_draw_t draw, int16_t x, int16_t y);
+extern void scroll_exit(void);
+extern void scroll_to(int16_t x, int16_t y);
+extern void scroll_by(int16_t dx, int16_t dy);
+extern void scroll_redraw(void);
+extern surface_t *scroll_surface(void);
+
+#endif  // __SCROLL_H_
@@ -0,0 +1,122 @@
+/**
+ * @file span.c
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief horizontal span fill/copy kernels used by the drawing functions.
+ *
+ * @copyright SuperIlu
+ *
+ * The kernels write single bytes until the destination is 32bit aligned, then whole 32bit words and finally the remaining bytes.
+ * Aligned 32bit stores are the fastest way to fill VGA memory on 386+ machines and avoid split accesses on the bus.
+ * 16bit OpenWatcom code uses "rep stosd"/"rep movsd" (operand size prefix) for the words, other compilers use memset()/memcpy().
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <mem.h>
+
+#include "span.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+//! offset of a pointer from the previous 32bit boundary
+#define SPAN_MISALIGN(p) (((uint16_t)(uintptr_t)(p)) & 3)
+
+#if defined(__WATCOMC__) && defined(__I86__)
+/**
+ * @brief store n 32bit words, the pattern is passed twice as the low and high word.
+ */
+extern void span_stosd(uint8_t *dst, uint16_t lo, uint16_t hi, uint16_t n);
+#pragma aux span_stosd =                         \
+    "db 0x66, 0xC1, 0xE0, 0x10" /* shl eax, 16 */ \
+    "mov ax, dx"                                  \
+    "db 0x66, 0xF3, 0xAB" /* rep stosd */         \
+    parm[es di][dx][ax][cx] modify[di cx ax];
+
+/**
+ * @brief copy n 32bit words.
+ */
+extern void span_movsd(uint8_t *dst, const uint8_t *src, uint16_t n);
+#pragma aux span_movsd =                 \
+    "push ds"                            \
+    "mov ds, dx"                         \
+    "db 0x66, 0xF3, 0xA5" /* rep movsd */ \
+    "pop ds"                             \
+    parm[es di][dx si][cx] modify[di si cx];
+
+#define SPAN_FILL32(dst, pattern, n) span_stosd(dst, pattern, pattern, n)  //!< fill n 32bit words, pattern is c * 0x0101
+#define SPAN_COPY32(dst, src, n) span_movsd(dst, src, n)                   //!< copy n 32bit words
+#else
+#define SPAN_FILL32(dst, pattern, n) memset(dst, (uint8_t)(pattern), (n) << 2)  //!< fill n 32bit words, pattern is c * 0x0101
+#define SPAN_COPY32(dst, src, n) memcpy(dst, src, (n) << 2)                     //!< copy n 32bit words
+#endif
+
+/* ======================================================================
+** public functions
+** ====================================================================== */
+/**
+ * @brief fill a span of memory with a color.
+ *
+ * @param dst first byte of the span.
+ * @param c color index.
+ * @param len number of pixels.
+ */
+void span_fill(uint8_t *dst, uint8_t c, uint16_t len) {
+    uint16_t n;
+
+    if (len < SPAN_MIN_WIDE) {
+        while (len--) {
+            *dst++ = c;
+        }
+        return;
+    }
+
+    // head: bytes up to the next 32bit boundary
+    for (n = (4 - SPAN_MISALIGN(dst)) & 3; n; n--, len--) {
+        *dst++ = c;
+    }
+
+    // body: four pixels per store
+    n = len >> 2;
+    SPAN_FILL32(dst, c * 0x0101U, n);
+    dst += n << 2;
+
+    // tail: remaining bytes
+    for (n = len & 3; n; n--) {
+        *dst++ = c;
+    }
+}
+
+/**
+ * @brief copy a span of pixels. Source and destination must not overlap.
+ * The destination is aligned, the source may be misaligned.
+ *
+ * @param dst destination.
+ * @param src source.
+ * @param len number of pixels.
+ */
+void span_copy(uint8_t *dst, const uint8_t *src, uint16_t len) {
+    uint16_t n;
+
+    if (len < SPAN_MIN_WIDE) {
+        while (len--) {
+            *dst++ = *src++;
+        }
+        return;
+    }
+
+    // head: bytes up to the next 32bit boundary
+    for (n = (4 - SPAN_MISALIGN(dst)) & 3; n; n--, len--) {
+        *dst++ = *src++;
+    }
+
+    // body: four pixels per load/store
+    n = len >> 2;
+    SPAN_COPY32(dst, src, n);
+    dst += n << 2;
+    src += n << 2;
+
+    // tail: remaining bytes
+    for (n = len & 3; n; n--) {
+        *dst++ = *src++;
+    }
+}
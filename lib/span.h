@@ -0,0 +1,24 @@
+/**
+ * @file span.h
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief horizontal span fill/copy kernels used by the drawing functions.
+ *
+ * @copyright SuperIlu
+ */
+#ifndef __SPAN_H_
+#define __SPAN_H_
+
+#include <stdint.h>
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define SPAN_MIN_WIDE 8  //!< spans shorter than this are written byte by byte
+
+/* ======================================================================
+** prototypes
+** ====================================================================== */
+extern void span_fill(uint8_t *dst, uint8_t c, uint16_t len);
+extern void span_copy(uint8_t *dst, const uint8_t *src, uint16_t len);
+
+#endif  // __SPAN_H_
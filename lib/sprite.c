@@ -0,0 +1,283 @@
+/**
+ * @file sprite.c
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief run length encoded transparent sprites.
+ *
+ * @copyright SuperIlu
+ *
+ * A sprite is created from a bitmap_t and a color key. Each row is encoded as a list of entries, each entry consists of
+ * the number of transparent pixels to skip, the number of opaque pixels that follow and the opaque pixels themselves.
+ * Drawing copies the opaque runs with block moves and never looks at transparent pixels.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "sprite.h"
+#include "modex.h"
+#include "span.h"
+#include "error.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define SPRITE_MAX_RUN 255        //!< max skip/run length of a single entry
+#define SPRITE_MAX_SIZE 0xFFF0UL  //!< max size of the encoded data
+
+/* ======================================================================
+** private functions
+** ====================================================================== */
+/**
+ * @brief encode a row of a bitmap.
+ *
+ * @param src first pixel of the row.
+ * @param width number of pixels.
+ * @param key transparent color.
+ * @param out buffer for the encoded row or NULL to only calculate the size.
+ *
+ * @return number of bytes of the encoded row.
+ */
+static uint16_t sprite_encode_row(uint8_t *src, uint16_t width, color_t key, uint8_t *out) {
+    uint16_t x = 0, size = 0, skip, run, i;
+
+    while (x < width) {
+        for (skip = 0; (x < width) && (src[x] == key); x++) {
+            skip++;
+        }
+        if (x >= width) {
+            break;  // trailing transparent pixels are not stored
+        }
+        for (run = 0; (x + run < width) && (src[x + run] != key) && (run < SPRITE_MAX_RUN); run++) {
+            ;
+        }
+
+        // long gaps are split into entries without pixels
+        for (; skip > SPRITE_MAX_RUN; skip -= SPRITE_MAX_RUN) {
+            if (out) {
+                out[size] = SPRITE_MAX_RUN;
+                out[size + 1] = 0;
+            }
+            size += 2;
+        }
+        if (out) {
+            out[size] = (uint8_t)skip;
+            out[size + 1] = (uint8_t)run;
+            for (i = 0; i < run; i++) {
+                out[size + 2 + i] = src[x + i];
+            }
+        }
+        size += 2 + run;
+        x += run;
+    }
+
+    // end of row
+    if (out) {
+        out[size] = 0;
+        out[size + 1] = 0;
+    }
+    return size + 2;
+}
+
+/**
+ * @brief draw a sprite onto a surface. The sprite is clipped to the clipping rectangle of the surface.
+ *
+ * @param s the surface to draw on.
+ * @param sp the sprite.
+ * @param x x pos
+ * @param y y pos
+ * @param flip true to mirror the sprite horizontally.
+ * @param bt blend table for translucent sprites or NULL to copy the pixels.
+ */
+static void sprite_render(surface_t *s, sprite_t *sp, int16_t x, int16_t y, bool flip, blend_t *bt) {
+    int16_t left = x, top = y, right = x + sp->width - 1, bottom = y + sp->height - 1;
+    int16_t row, sx, c0, c1, c;
+    uint16_t px;
+    uint8_t skip, run, pixel, *p, *line;
+    bool planar = s->flags & VGA_SURFACE_PLANAR;
+
+    if (left < s->clip.left) {
+        left = s->clip.left;
+    }
+    if (top < s->clip.top) {
+        top = s->clip.top;
+    }
+    if (right > s->clip.right) {
+        right = s->clip.right;
+    }
+    if (bottom > s->clip.bottom) {
+        bottom = s->clip.bottom;
+    }
+    if ((left > right) || (top > bottom)) {
+        return;
+    }
+
+    for (row = top; row <= bottom; row++) {
+        p = &sp->data[sp->rows[row - y]];
+        line = &s->data[(uint16_t)row * s->stride];
+        px = 0;
+
+        while (true) {
+            skip = *p++;
+            run = *p++;
+            if (!skip && !run) {
+                break;
+            }
+            px += skip;
+            if (!run) {
+                continue;
+            }
+
+            // screen position of the run and the visible part of it
+            sx = flip ? x + sp->width - px - run : x + px;
+            c0 = sx < left ? left : sx;
+            c1 = sx + run - 1 > right ? right : sx + run - 1;
+
+            if (c0 <= c1) {
+                if (bt) {
+                    for (c = c0; c <= c1; c++) {
+                        pixel = p[flip ? sx + run - 1 - c : c - sx];
+                        if (planar) {
+                            modex_put_pixel(s, c, row, bt->rows[pixel][modex_get_pixel(s, c, row)]);
+                        } else {
+                            line[c] = bt->rows[pixel][line[c]];
+                        }
+                    }
+                } else if (!flip) {
+                    if (planar) {
+                        vga_surface_put_span(s, c0, row, p + (c0 - sx), c1 - c0 + 1);
+                    } else {
+                        span_copy(&line[c0], p + (c0 - sx), c1 - c0 + 1);
+                    }
+                } else if (planar) {
+                    for (c = c0; c <= c1; c++) {
+                        modex_put_pixel(s, c, row, p[sx + run - 1 - c]);
+                    }
+                } else {
+                    for (c = c0; c <= c1; c++) {
+                        line[c] = p[sx + run - 1 - c];
+                    }
+                }
+            } else if (!flip && (sx > right)) {
+                break;  // the rest of the row is right of the clipping rectangle
+            }
+            p += run;
+            px += run;
+        }
+    }
+    vga_surface_dirty(s, left, top, right, bottom);
+}
+
+/* ======================================================================
+** public functions
+** ====================================================================== */
+/**
+ * @brief create a sprite from a bitmap.
+ *
+ * @param bm the bitmap.
+ * @param key the transparent color.
+ *
+ * @return a new sprite or NULL if out of memory or the encoded sprite would be larger than 64KB.
+ */
+sprite_t *sprite_create(bitmap_t *bm, color_t key) {
+    sprite_t *sp;
+    uint32_t size = 0;
+    uint16_t y, offset;
+
+    // calculate size of the encoded data
+    for (y = 0; y < bm->height; y++) {
+        size += sprite_encode_row(&bm->data[(uint16_t)y * bm->width], bm->width, key, NULL);
+    }
+    if (size > SPRITE_MAX_SIZE) {
+        ERR_PARAM();
+        return NULL;
+    }
+
+    sp = calloc(sizeof(sprite_t), 1);
+    if (!sp) {
+        ERR_NOMEM();
+        return NULL;
+    }
+    sp->width = bm->width;
+    sp->height = bm->height;
+    sp->size = (uint16_t)size;
+
+    sp->rows = calloc(sizeof(uint16_t), bm->height);
+    sp->data = malloc(sp->size);
+    if (!sp->rows || !sp->data) {
+        sprite_free(sp);
+        ERR_NOMEM();
+        return NULL;
+    }
+
+    // encode
+    for (y = 0, offset = 0; y < bm->height; y++) {
+        sp->rows[y] = offset;
+        offset += sprite_encode_row(&bm->data[(uint16_t)y * bm->width], bm->width, key, &sp->data[offset]);
+    }
+
+    ERR_OK();
+    return sp;
+}
+
+/**
+ * @brief free a sprite.
+ *
+ * @param sp the sprite.
+ */
+void sprite_free(sprite_t *sp) {
+    if (sp) {
+        if (sp->rows) {
+            free(sp->rows);
+            sp->rows = NULL;
+        }
+        if (sp->data) {
+            free(sp->data);
+            sp->data = NULL;
+        }
+        free(sp);
+    }
+}
+
+/**
+ * @brief draw a sprite to the screen.
+ *
+ * @param sp the sprite.
+ * @param x x pos
+ * @param y y pos
+ * @param flip true to mirror the sprite horizontally.
+ */
+void sprite_draw(sprite_t *sp, int16_t x, int16_t y, bool flip) { sprite_surface_draw(vga_screen(), sp, x, y, flip); }
+
+/**
+ * @brief draw a sprite onto a surface. The sprite is clipped to the clipping rectangle of the surface.
+ *
+ * @param s the surface to draw on.
+ * @param sp the sprite.
+ * @param x x pos
+ * @param y y pos
+ * @param flip true to mirror the sprite horizontally.
+ */
+void sprite_surface_draw(surface_t *s, sprite_t *sp, int16_t x, int16_t y, bool flip) { sprite_render(s, sp, x, y, flip, NULL); }
+
+/**
+ * @brief draw a translucent sprite to the screen, every opaque pixel is mixed with the screen using a blend table.
+ *
+ * @param sp the sprite.
+ * @param x x pos
+ * @param y y pos
+ * @param flip true to mirror the sprite horizontally.
+ * @param bt the blend table.
+ */
+void sprite_blend_draw(sprite_t *sp, int16_t x, int16_t y, bool flip, blend_t *bt) { sprite_surface_blend_draw(vga_screen(), sp, x, y, flip, bt); }
+
+/**
+ * @brief draw a translucent sprite onto a surface, every opaque pixel is mixed with the surface using a blend table.
+ * The sprite is clipped to the clipping rectangle of the surface.
+ *
+ * @param s the surface to draw on.
+ * @param sp the sprite.
+ * @param x x pos
+ * @param y y pos
+ * @param flip true to mirror the sprite horizontally.
+ * @param bt the blend table.
+ */
+void sprite_surface_blend_draw(surface_t *s, sprite_t *sp, int16_t x, int16_t y, bool flip, blend_t *bt) { sprite_render(s, sp, x, y, flip, bt); }
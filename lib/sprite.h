@@ -0,0 +1,40 @@
+/**
+ * @file sprite.h
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief run length encoded transparent sprites.
+ *
+ * @copyright SuperIlu
+ */
+#ifndef __SPRITE_H_
+#define __SPRITE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vga.h"
+#include "bitmap.h"
+#include "blend.h"
+
+/* ======================================================================
+** typedefs
+** ====================================================================== */
+//! a transparent sprite, each row is stored as (skip, run, run * pixel) entries terminated by (0, 0)
+typedef struct __sprite {
+    uint16_t width;   //!< width in pixels
+    uint16_t height;  //!< height in pixels
+    uint16_t size;    //!< number of bytes in data
+    uint16_t *rows;   //!< offset of each row in data
+    uint8_t *data;    //!< encoded rows
+} sprite_t;
+
+/* ======================================================================
+** prototypes
+** ====================================================================== */
+extern sprite_t *sprite_create(bitmap_t *bm, color_t key);
+extern void sprite_free(sprite_t *sp);
+extern void sprite_draw(sprite_t *sp, int16_t x, int16_t y, bool flip);
+extern void sprite_surface_draw(surface_t *s, sprite_t *sp, int16_t x, int16_t y, bool flip);
+extern void sprite_blend_draw(sprite_t *sp, int16_t x, int16_t y, bool flip, blend_t *bt);
+extern void sprite_surface_blend_draw(surface_t *s, sprite_t *sp, int16_t x, int16_t y, bool flip, blend_t *bt);
+
+#endif  // __SPRITE_H_
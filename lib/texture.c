@@ -0,0 +1,604 @@
+/**
+ * @file texture.c
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief fixed point texture mapped triangles and quads.
+ *
+ * @copyright SuperIlu
+ *
+ * Triangles are drawn scanline by scanline like vga_surface_filled_polygon(). The texture coordinates are stepped along
+ * the left edges, their change per pixel is the same for the whole triangle and calculated once from the widest scanline.
+ * Each span is sampled into a line buffer and written with vga_surface_put_span(), so the span kernels and the Mode X
+ * plane handling are shared with the other drawing functions. Textures wrap because the texel address is masked.
+ *
+ * With TEX_PERSPECTIVE u/z, v/z and 1/z are stepped instead. They are divided every TEX_SUBDIV pixels and the texture
+ * coordinates are stepped linearly in between, which costs two divisions per TEX_SUBDIV pixels. 1/z is scaled to at most 2048 for the nearest vertex,
+ * so everything fits into 32 bits as long as the texture coordinates stay within +-1024 texels.
+ * All maths is done with integers, no FPU is needed.
+ */
+#include <stddef.h>
+
+#include "texture.h"
+#include "blend.h"
+#include "error.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define TEX_Q_SHIFT 8          //!< 1/z is stepped with this many extra fraction bits
+#define TEX_Z_LIMIT 0x400000L  //!< depths are scaled below this value before 1/z is calculated
+#define TEX_SUBDIV 16          //!< with TEX_PERSPECTIVE the texture coordinates are exact every TEX_SUBDIV pixels
+#define TEX_MAX_SLOPE 0x7FFFL  //!< max x step per scanline of an edge in pixels
+
+//! multiply a fraction of a pixel (0..0xFFFF) by a per pixel step
+#define TEX_FRAC(p, d) (((p) >> 8) * ((d) >> 8))
+
+/* ======================================================================
+** typedefs
+** ====================================================================== */
+//! the values that are interpolated over a triangle
+typedef struct __tex_attr {
+    fixed16_16 u;  //!< texture x
+    fixed16_16 v;  //!< texture y
+    int32_t uq;    //!< u/z scaled, only with TEX_PERSPECTIVE
+    int32_t vq;    //!< v/z scaled, only with TEX_PERSPECTIVE
+    int32_t q;     //!< 1/z scaled, only with TEX_PERSPECTIVE
+} tex_attr_t;
+
+//! an edge of a triangle
+typedef struct __tex_edge {
+    fixed16_16 x;   //!< x on the current scanline
+    fixed16_16 dx;  //!< x step per scanline
+    tex_attr_t a;   //!< values on the current scanline
+    tex_attr_t da;  //!< value steps per scanline
+} tex_edge_t;
+
+/* ======================================================================
+** global variables
+** ====================================================================== */
+uint32_t tex_pixels = 0;  //!< number of pixels covered by all textured triangles, can be reset for benchmarks
+
+/* ======================================================================
+** local variables
+** ====================================================================== */
+static uint8_t tex_line[TEX_MAX_SPAN];  //!< texels of the current span
+
+/* ======================================================================
+** private functions
+** ====================================================================== */
+/**
+ * @brief calculate a * 256^steps / b without 64bit maths. The result must fit into 32 bits.
+ *
+ * @param a the dividend.
+ * @param b the divisor, must be > 0 and < 2^24.
+ * @param steps number of 8bit steps the dividend is scaled up.
+ *
+ * @return the quotient.
+ */
+static int32_t tex_div(int32_t a, int32_t b, uint8_t steps) {
+    uint32_t ua = a < 0 ? -a : a, q, r;
+
+    q = ua / b;
+    r = ua % b;
+    while (steps--) {
+        r <<= 8;
+        q = (q << 8) + r / b;
+        r %= b;
+    }
+    return a < 0 ? -(int32_t)q : (int32_t)q;
+}
+
+/**
+ * @brief change per pixel for a difference across a scanline.
+ *
+ * @param d the difference.
+ * @param width the width of the scanline in 1/256 pixels, not 0.
+ *
+ * @return the change per pixel.
+ */
+static int32_t tex_gradient(int32_t d, int32_t width) {
+    if (width < 0) {
+        width = -width;
+        d = -d;
+    }
+    return tex_div(d, width, 1);
+}
+
+/**
+ * @brief add a multiple of steps to interpolated values.
+ *
+ * @param a the values.
+ * @param d the steps.
+ * @param n number of steps.
+ */
+static void tex_attr_add(tex_attr_t *a, tex_attr_t *d, int16_t n) {
+    a->u += d->u * n;
+    a->v += d->v * n;
+    a->uq += d->uq * n;
+    a->vq += d->vq * n;
+    a->q += d->q * n;
+}
+
+/**
+ * @brief get the interpolated values at the corners of a triangle.
+ *
+ * @param tex the texture.
+ * @param v the corners.
+ * @param a receives the values for the corners.
+ */
+static void tex_attr_init(texture_t *tex, tex_vertex_t **v, tex_attr_t *a) {
+    fixed16_16 zmin = 0x7FFFFFFFL, zmax = 1, z;
+    uint8_t i, shift = 0;
+    int32_t q;
+
+    for (i = 0; i < 3; i++) {
+        a[i].u = v[i]->u;
+        a[i].v = v[i]->v;
+        a[i].uq = a[i].vq = a[i].q = 0;
+        z = v[i]->z > 0 ? v[i]->z : 1;
+        if (z < zmin) {
+            zmin = z;
+        }
+        if (z > zmax) {
+            zmax = z;
+        }
+    }
+    if (!(tex->flags & TEX_PERSPECTIVE)) {
+        return;
+    }
+
+    // 1/z relative to the nearest corner, 2048 for the nearest corner
+    while ((zmax >> shift) >= TEX_Z_LIMIT) {
+        shift++;
+    }
+    for (i = 0; i < 3; i++) {
+        z = v[i]->z > 0 ? v[i]->z : 1;
+        q = tex_div(zmin >> shift, (z >> shift) ? (z >> shift) : 1, 2) >> 5;
+        if (!q) {
+            q = 1;
+        }
+        a[i].uq = (a[i].u >> 8) * q;
+        a[i].vq = (a[i].v >> 8) * q;
+        a[i].q = q << TEX_Q_SHIFT;
+    }
+}
+
+/**
+ * @brief start an edge at its upper corner.
+ *
+ * @param e the edge.
+ * @param va upper corner.
+ * @param aa values at the upper corner.
+ * @param vb lower corner, must be below va.
+ * @param ab values at the lower corner.
+ */
+static void tex_edge_init(tex_edge_t *e, tex_vertex_t *va, tex_attr_t *aa, tex_vertex_t *vb, tex_attr_t *ab) {
+    int32_t dy = (int32_t)vb->y - va->y;
+    int32_t dx = (int32_t)vb->x - va->x;
+
+    // the step is divided before it is scaled, so edges wider than 32767 pixels do not overflow
+    if ((dx < 0 ? -dx : dx) / dy > TEX_MAX_SLOPE) {
+        dx = dx < 0 ? -TEX_MAX_SLOPE * dy : TEX_MAX_SLOPE * dy;
+    }
+    e->x = TO_FIXED((fixed16_16)va->x);
+    e->dx = tex_div(dx, dy, 2);
+    e->a = *aa;
+    e->da.u = (ab->u - aa->u) / dy;
+    e->da.v = (ab->v - aa->v) / dy;
+    e->da.uq = (ab->uq - aa->uq) / dy;
+    e->da.vq = (ab->vq - aa->vq) / dy;
+    e->da.q = (ab->q - aa->q) / dy;
+}
+
+/**
+ * @brief get x of an edge several scanlines further down. The product of step and scanlines can exceed 32 bits for
+ * wide edges, so it is added in two halves. The result lies on the edge and always fits.
+ *
+ * @param e the edge.
+ * @param n number of scanlines.
+ *
+ * @return x n scanlines further down.
+ */
+static fixed16_16 tex_edge_x(tex_edge_t *e, int16_t n) {
+    fixed16_16 x = e->x + e->dx * (n >> 1);
+
+    return x + e->dx * (n - (n >> 1));
+}
+
+/**
+ * @brief move an edge down.
+ *
+ * @param e the edge.
+ * @param n number of scanlines.
+ */
+static void tex_edge_step(tex_edge_t *e, int16_t n) {
+    e->x = tex_edge_x(e, n);
+    tex_attr_add(&e->a, &e->da, n);
+}
+
+/**
+ * @brief write the texels in the line buffer to a surface, skipping the color key and applying the light table if enabled.
+ *
+ * @param s the surface.
+ * @param tex the texture.
+ * @param x x start
+ * @param y y position.
+ * @param len number of texels in the line buffer.
+ */
+static void tex_put(surface_t *s, texture_t *tex, int16_t x, int16_t y, uint16_t len) {
+    const uint8_t *light = (tex->flags & TEX_LIGHT) ? tex->light : NULL;
+    uint16_t i, start;
+
+    if (!(tex->flags & TEX_TRANSPARENT)) {
+        if (light) {
+            for (i = 0; i < len; i++) {
+                tex_line[i] = light[tex_line[i]];
+            }
+        }
+        vga_surface_put_span(s, x, y, tex_line, len);
+        return;
+    }
+
+    // only the runs between transparent texels are written
+    i = 0;
+    while (i < len) {
+        while ((i < len) && (tex_line[i] == tex->key)) {
+            i++;
+        }
+        start = i;
+        while ((i < len) && (tex_line[i] != tex->key)) {
+            if (light) {
+                tex_line[i] = light[tex_line[i]];
+            }
+            i++;
+        }
+        if (i > start) {
+            vga_surface_put_span(s, x + start, y, &tex_line[start], i - start);
+        }
+    }
+}
+
+/**
+ * @brief sample texels into the line buffer with a constant step.
+ *
+ * @param tex the texture.
+ * @param dst where the texels go.
+ * @param n number of texels.
+ * @param u texture x of the first texel.
+ * @param v texture y of the first texel.
+ * @param du texture x step.
+ * @param dv texture y step.
+ */
+static void tex_texels(texture_t *tex, uint8_t *dst, uint16_t n, fixed16_16 u, fixed16_16 v, fixed16_16 du, fixed16_16 dv) {
+    uint16_t u_mask = tex->u_mask, v_mask = tex->v_mask;
+    uint8_t u_shift = tex->u_shift;
+    uint8_t *data = tex->bm->data;
+
+    while (n--) {
+        *dst++ = data[((((uint16_t)(v >> 16)) & v_mask) << u_shift) | (((uint16_t)(u >> 16)) & u_mask)];
+        u += du;
+        v += dv;
+    }
+}
+
+/**
+ * @brief divide u/z and v/z by 1/z.
+ *
+ * @param a the values.
+ * @param u receives texture x.
+ * @param v receives texture y.
+ */
+static void tex_project(tex_attr_t *a, fixed16_16 *u, fixed16_16 *v) {
+    int32_t q = a->q > 0 ? a->q : 1;
+
+    *u = tex_div(a->uq, q, 2);
+    *v = tex_div(a->vq, q, 2);
+}
+
+/**
+ * @brief draw a textured span. No clipping is done.
+ * With TEX_PERSPECTIVE the texture coordinates are divided every TEX_SUBDIV pixels and stepped linearly in between.
+ *
+ * @param s the surface.
+ * @param tex the texture.
+ * @param y y position.
+ * @param x1 x start
+ * @param x2 x end, must be >= x1.
+ * @param a values at x1.
+ * @param grad value changes per pixel.
+ */
+static void tex_span(surface_t *s, texture_t *tex, int16_t y, int16_t x1, int16_t x2, tex_attr_t *a, tex_attr_t *grad) {
+    uint16_t len = x2 - x1 + 1, n, i, m;
+    fixed16_16 u, v, u2, v2;
+
+    tex_pixels += len;
+    if (tex->flags & TEX_PERSPECTIVE) {
+        tex_project(a, &u, &v);
+    } else {
+        u = a->u;
+        v = a->v;
+    }
+
+    while (len) {
+        n = len > TEX_MAX_SPAN ? TEX_MAX_SPAN : len;
+        if (tex->flags & TEX_PERSPECTIVE) {
+            for (i = 0; i < n; i += m) {
+                m = n - i > TEX_SUBDIV ? TEX_SUBDIV : n - i;
+                a->uq += grad->uq * m;
+                a->vq += grad->vq * m;
+                a->q += grad->q * m;
+                tex_project(a, &u2, &v2);
+                tex_texels(tex, &tex_line[i], m, u, v, (u2 - u) / m, (v2 - v) / m);
+                u = u2;
+                v = v2;
+            }
+        } else {
+            tex_texels(tex, tex_line, n, u, v, grad->u, grad->v);
+            u += grad->u * n;
+            v += grad->v * n;
+        }
+        tex_put(s, tex, x1, y, n);
+        x1 += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief draw the scanlines y1 <= y < y2 between two edges, clipped to the clipping rectangle.
+ * Pixels are drawn if left <= x < right, so triangles sharing an edge do not overlap. Both edges are moved to y2.
+ *
+ * @param s the surface.
+ * @param tex the texture.
+ * @param y1 first scanline.
+ * @param y2 first scanline after the area.
+ * @param left the left edge, the texture coordinates are taken from this edge.
+ * @param right the right edge.
+ * @param grad value changes per pixel.
+ */
+static void tex_scan(surface_t *s, texture_t *tex, int16_t y1, int16_t y2, tex_edge_t *left, tex_edge_t *right, tex_attr_t *grad) {
+    int16_t y = y1, end = y2, x1, x2;
+    fixed16_16 p;
+    tex_attr_t a;
+
+    if (y < s->clip.top) {
+        y = end < s->clip.top ? end : s->clip.top;
+        tex_edge_step(left, y - y1);
+        tex_edge_step(right, y - y1);
+    }
+    if (end > s->clip.bottom + 1) {
+        end = s->clip.bottom + 1;
+    }
+
+    for (; y < end; y++) {
+        x1 = (int16_t)FROM_FIXED_CEIL(left->x);
+        x2 = (int16_t)FROM_FIXED_CEIL(right->x) - 1;
+        if (x1 <= x2) {
+            // values at the center of the first pixel
+            a = left->a;
+            p = TO_FIXED((fixed16_16)x1) - left->x;
+            a.u += TEX_FRAC(p, grad->u);
+            a.v += TEX_FRAC(p, grad->v);
+            a.uq += TEX_FRAC(p, grad->uq);
+            a.vq += TEX_FRAC(p, grad->vq);
+            a.q += TEX_FRAC(p, grad->q);
+
+            if (x1 < s->clip.left) {
+                tex_attr_add(&a, grad, s->clip.left - x1);
+                x1 = s->clip.left;
+            }
+            if (x2 > s->clip.right) {
+                x2 = s->clip.right;
+            }
+            if (x1 <= x2) {
+                tex_span(s, tex, y, x1, x2, &a, grad);
+            }
+        }
+        tex_edge_step(left, 1);
+        tex_edge_step(right, 1);
+    }
+
+    if (y < y2) {
+        tex_edge_step(left, y2 - y);
+        tex_edge_step(right, y2 - y);
+    }
+}
+
+/* ======================================================================
+** public functions
+** ====================================================================== */
+/**
+ * @brief initialize a texture. Transparency, lighting and perspective correction are disabled.
+ *
+ * @param tex the texture to initialize.
+ * @param bm the texels, width and height must be powers of two.
+ *
+ * @return true if the bitmap can be used as a texture, else false.
+ */
+bool tex_init(texture_t *tex, bitmap_t *bm) {
+    if (!bm || !bm->width || !bm->height || (bm->width & (bm->width - 1)) || (bm->height & (bm->height - 1))) {
+        ERR_PARAM();
+        return false;
+    }
+    tex->bm = bm;
+    tex->u_mask = bm->width - 1;
+    tex->v_mask = bm->height - 1;
+    for (tex->u_shift = 0; (1U << tex->u_shift) < bm->width; tex->u_shift++) {
+    }
+    tex->flags = 0;
+    tex->key = 0;
+    tex->light = NULL;
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief enable or disable the color key.
+ *
+ * @param tex the texture.
+ * @param enable true to skip texels with the key color.
+ * @param key the transparent color.
+ */
+void tex_set_key(texture_t *tex, bool enable, color_t key) {
+    tex->key = key;
+    if (enable) {
+        tex->flags |= TEX_TRANSPARENT;
+    } else {
+        tex->flags &= ~TEX_TRANSPARENT;
+    }
+}
+
+/**
+ * @brief set the light table, e.g. one of several tables created with tex_light_table() for different distances.
+ *
+ * @param tex the texture.
+ * @param light VGA_MAX_COLORS entries or NULL to disable lighting.
+ */
+void tex_set_light(texture_t *tex, const uint8_t *light) {
+    tex->light = light;
+    if (light) {
+        tex->flags |= TEX_LIGHT;
+    } else {
+        tex->flags &= ~TEX_LIGHT;
+    }
+}
+
+/**
+ * @brief enable or disable perspective correction. The z coordinates of the vertices are only used if enabled.
+ *
+ * @param tex the texture.
+ * @param enable true for perspective correct texture coordinates at both ends of every span.
+ */
+void tex_set_perspective(texture_t *tex, bool enable) {
+    if (enable) {
+        tex->flags |= TEX_PERSPECTIVE;
+    } else {
+        tex->flags &= ~TEX_PERSPECTIVE;
+    }
+}
+
+/**
+ * @brief create a light table that maps every color to the palette entry closest to its darkened (or brightened) version.
+ * Creating a table searches the palette 256 times, tables should be created once.
+ *
+ * @param light receives VGA_MAX_COLORS entries.
+ * @param palette VGA_MAX_COLORS colors.
+ * @param level brightness in 1/256, 256 keeps the colors, 128 is half as bright.
+ */
+void tex_light_table(uint8_t *light, palette_color_t *palette, uint16_t level) {
+    uint16_t i;
+    int16_t r, g, b;
+
+    for (i = 0; i < VGA_MAX_COLORS; i++) {
+        r = ((uint32_t)palette[i].red * level) >> 8;
+        g = ((uint32_t)palette[i].green * level) >> 8;
+        b = ((uint32_t)palette[i].blue * level) >> 8;
+        light[i] = blend_nearest(palette, r > 255 ? 255 : r, g > 255 ? 255 : g, b > 255 ? 255 : b);
+    }
+}
+
+/**
+ * @brief draw a textured triangle on a surface. The triangle is clipped to the clipping rectangle.
+ *
+ * @param s the surface.
+ * @param tex the texture.
+ * @param v0 first corner.
+ * @param v1 second corner.
+ * @param v2 third corner.
+ */
+void tex_surface_triangle(surface_t *s, texture_t *tex, tex_vertex_t *v0, tex_vertex_t *v1, tex_vertex_t *v2) {
+    tex_vertex_t *v[3], *temp;
+    tex_attr_t a[3], at, grad;
+    tex_edge_t e_long, e_short;
+    int32_t width;
+    int16_t n;
+
+    // sort by y
+    v[0] = v0;
+    v[1] = v1;
+    v[2] = v2;
+    if (v[0]->y > v[1]->y) {
+        temp = v[0];
+        v[0] = v[1];
+        v[1] = temp;
+    }
+    if (v[1]->y > v[2]->y) {
+        temp = v[1];
+        v[1] = v[2];
+        v[2] = temp;
+    }
+    if (v[0]->y > v[1]->y) {
+        temp = v[0];
+        v[0] = v[1];
+        v[1] = temp;
+    }
+    if (v[0]->y == v[2]->y) {
+        return;  // no scanlines
+    }
+    tex_attr_init(tex, v, a);
+
+    // the edge v0->v2 spans all scanlines, the widest scanline is the one through v1
+    tex_edge_init(&e_long, v[0], &a[0], v[2], &a[2]);
+    n = v[1]->y - v[0]->y;
+    // in 1/256 pixels, as fixed point the width of a triangle wider than 32767 pixels would overflow
+    width = (TO_FIXED((fixed16_16)v[1]->x) >> 8) - (tex_edge_x(&e_long, n) >> 8);
+    if (!width) {
+        return;  // less than 1/256 pixel wide
+    }
+    at = a[0];
+    tex_attr_add(&at, &e_long.da, n);
+    grad.u = tex_gradient(a[1].u - at.u, width);
+    grad.v = tex_gradient(a[1].v - at.v, width);
+    grad.uq = tex_gradient(a[1].uq - at.uq, width);
+    grad.vq = tex_gradient(a[1].vq - at.vq, width);
+    grad.q = tex_gradient(a[1].q - at.q, width);
+
+    if (v[0]->y != v[1]->y) {
+        tex_edge_init(&e_short, v[0], &a[0], v[1], &a[1]);
+        if (width > 0) {
+            tex_scan(s, tex, v[0]->y, v[1]->y, &e_long, &e_short, &grad);
+        } else {
+            tex_scan(s, tex, v[0]->y, v[1]->y, &e_short, &e_long, &grad);
+        }
+    }
+    if (v[1]->y != v[2]->y) {
+        tex_edge_init(&e_short, v[1], &a[1], v[2], &a[2]);
+        if (width > 0) {
+            tex_scan(s, tex, v[1]->y, v[2]->y, &e_long, &e_short, &grad);
+        } else {
+            tex_scan(s, tex, v[1]->y, v[2]->y, &e_short, &e_long, &grad);
+        }
+    }
+
+    // bounding box
+    n = v0->x < v1->x ? v0->x : v1->x;
+    vga_surface_dirty(s, n < v2->x ? n : v2->x, v[0]->y, v0->x > v1->x ? (v0->x > v2->x ? v0->x : v2->x) : (v1->x > v2->x ? v1->x : v2->x), v[2]->y);
+}
+
+/**
+ * @brief draw a textured quad on a surface as the triangles v[0], v[1], v[2] and v[0], v[2], v[3].
+ *
+ * @param s the surface.
+ * @param tex the texture.
+ * @param v four corners in drawing order.
+ */
+void tex_surface_quad(surface_t *s, texture_t *tex, tex_vertex_t *v) {
+    tex_surface_triangle(s, tex, &v[0], &v[1], &v[2]);
+    tex_surface_triangle(s, tex, &v[0], &v[2], &v[3]);
+}
+
+/**
+ * @brief draw a textured triangle on screen.
+ *
+ * @param tex the texture.
+ * @param v0 first corner.
+ * @param v1 second corner.
+ * @param v2 third corner.
+ */
+void tex_triangle(texture_t *tex, tex_vertex_t *v0, tex_vertex_t *v1, tex_vertex_t *v2) { tex_surface_triangle(vga_screen(), tex, v0, v1, v2); }
+
+/**
+ * @brief draw a textured quad on screen.
+ *
+ * @param tex the texture.
+ * @param v four corners in drawing order.
+ */
+void tex_quad(texture_t *tex, tex_vertex_t *v) { tex_surface_quad(vga_screen(), tex, v); }
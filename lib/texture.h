@@ -0,0 +1,68 @@
+/**
+ * @file texture.h
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief fixed point texture mapped triangles and quads.
+ *
+ * @copyright SuperIlu
+ */
+#ifndef __TEXTURE_H_
+#define __TEXTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vga.h"
+#include "bitmap.h"
+#include "fixed.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define TEX_TRANSPARENT 0x01  //!< texels with the color key are not drawn
+#define TEX_LIGHT 0x02        //!< texels are mapped through the light table
+#define TEX_PERSPECTIVE 0x04  //!< texture coordinates are perspective correct every few pixels
+
+#define TEX_MAX_SPAN 320  //!< longer spans are drawn in several parts
+
+/* ======================================================================
+** typedefs
+** ====================================================================== */
+//! a corner of a textured triangle
+typedef struct __tex_vertex {
+    int16_t x;     //!< x position
+    int16_t y;     //!< y position
+    fixed16_16 u;  //!< texture x in texels, wraps at the texture width. Keep within +-1024 for TEX_PERSPECTIVE
+    fixed16_16 v;  //!< texture y in texels, wraps at the texture height. Keep within +-1024 for TEX_PERSPECTIVE
+    fixed16_16 z;  //!< depth (> 0) for TEX_PERSPECTIVE
+} tex_vertex_t;
+
+//! a texture, the bitmap must stay valid while the texture is used
+typedef struct __texture {
+    bitmap_t *bm;          //!< the texels, width and height must be powers of two
+    uint16_t u_mask;       //!< width - 1
+    uint16_t v_mask;       //!< height - 1
+    uint8_t u_shift;       //!< log2(width)
+    uint8_t flags;         //!< TEX_* flags
+    color_t key;           //!< transparent color for TEX_TRANSPARENT
+    const uint8_t *light;  //!< VGA_MAX_COLORS entries for TEX_LIGHT, see tex_light_table()
+} texture_t;
+
+/* ======================================================================
+** global variables
+** ====================================================================== */
+extern uint32_t tex_pixels;
+
+/* ======================================================================
+** prototypes
+** ====================================================================== */
+extern bool tex_init(texture_t *tex, bitmap_t *bm);
+extern void tex_set_key(texture_t *tex, bool enable, color_t key);
+extern void tex_set_light(texture_t *tex, const uint8_t *light);
+extern void tex_set_perspective(texture_t *tex, bool enable);
+extern void tex_light_table(uint8_t *light, palette_color_t *palette, uint16_t level);
+extern void tex_surface_triangle(surface_t *s, texture_t *tex, tex_vertex_t *v0, tex_vertex_t *v1, tex_vertex_t *v2);
+extern void tex_surface_quad(surface_t *s, texture_t *tex, tex_vertex_t *v);
+extern void tex_triangle(texture_t *tex, tex_vertex_t *v0, tex_vertex_t *v1, tex_vertex_t *v2);
+extern void tex_quad(texture_t *tex, tex_vertex_t *v);
+
+#endif  // __TEXTURE_H_
@@ -0,0 +1,481 @@
+/**
+ * @file tilemap.c
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief tile maps that only redraw changed or animated cells.
+ *
+ * @copyright SuperIlu
+ *
+ * Every cell of a map has a dirty bit. Changing a cell, stepping an animation or tilemap_mark_dirty() (e.g. for the area
+ * below a sprite) sets the bits, tilemap_draw() only draws the dirty cells that are visible and clears their bits.
+ * Moving the view marks all cells dirty, for hardware scrolling use tilemap_draw_rect() from the scroll_draw_t callback.
+ *
+ * The tile cache holds a pointer to the top left pixel of every tile, so drawing a tile never divides by the tileset width.
+ * Tiles at the edges of the view and the clipping rectangle are drawn partially.
+ * The map, the tile cache and the dirty bits live in one allocation which must not exceed 64KB.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <mem.h>
+
+#include "tilemap.h"
+#include "error.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+//! true if a cell must be redrawn
+#define TILEMAP_IS_DIRTY(tm, idx) ((tm)->dirty[(idx) >> 3] & (1 << ((idx)&7)))
+
+//! mark a cell for redraw
+#define TILEMAP_SET_DIRTY(tm, idx) ((tm)->dirty[(idx) >> 3] |= (1 << ((idx)&7)))
+
+//! a cell was redrawn
+#define TILEMAP_CLEAR_DIRTY(tm, idx) ((tm)->dirty[(idx) >> 3] &= ~(1 << ((idx)&7)))
+
+/* ======================================================================
+** global variables
+** ====================================================================== */
+uint16_t tilemap_last_drawn = 0;  //!< number of tiles drawn by the last call to tilemap_draw() or tilemap_draw_rect()
+
+/* ======================================================================
+** private functions
+** ====================================================================== */
+/**
+ * @brief limit an area to the view of a map and the clipping rectangle of a surface.
+ *
+ * @param tm the map.
+ * @param s the surface.
+ * @param r the area, modified in place.
+ *
+ * @return false if nothing is left of the area.
+ */
+static bool tilemap_clip(tilemap_t *tm, surface_t *s, rect_t *r) {
+    if (r->left < tm->view.left) {
+        r->left = tm->view.left;
+    }
+    if (r->left < s->clip.left) {
+        r->left = s->clip.left;
+    }
+    if (r->top < tm->view.top) {
+        r->top = tm->view.top;
+    }
+    if (r->top < s->clip.top) {
+        r->top = s->clip.top;
+    }
+    if (r->right > tm->view.right) {
+        r->right = tm->view.right;
+    }
+    if (r->right > s->clip.right) {
+        r->right = s->clip.right;
+    }
+    if (r->bottom > tm->view.bottom) {
+        r->bottom = tm->view.bottom;
+    }
+    if (r->bottom > s->clip.bottom) {
+        r->bottom = s->clip.bottom;
+    }
+    return (r->left <= r->right) && (r->top <= r->bottom);
+}
+
+/**
+ * @brief get the cells that cover an area of the view. Cells outside the map are excluded.
+ *
+ * @param tm the map.
+ * @param r the area in surface coordinates, must be inside the view.
+ * @param cells receives the first and last column/row.
+ *
+ * @return false if no cell of the map is in the area.
+ */
+static bool tilemap_cells(tilemap_t *tm, rect_t *r, rect_t *cells) {
+    int16_t left = r->left - tm->view.left + tm->x;
+    int16_t top = r->top - tm->view.top + tm->y;
+    int16_t right = r->right - tm->view.left + tm->x;
+    int16_t bottom = r->bottom - tm->view.top + tm->y;
+
+    if ((right < 0) || (bottom < 0)) {
+        return false;
+    }
+    cells->left = left < 0 ? 0 : left / tm->tile_width;
+    cells->top = top < 0 ? 0 : top / tm->tile_height;
+    cells->right = right / tm->tile_width;
+    cells->bottom = bottom / tm->tile_height;
+    if (cells->right >= (int16_t)tm->width) {
+        cells->right = tm->width - 1;
+    }
+    if (cells->bottom >= (int16_t)tm->height) {
+        cells->bottom = tm->height - 1;
+    }
+    return (cells->left <= cells->right) && (cells->top <= cells->bottom);
+}
+
+/**
+ * @brief draw the part of a cell that is inside an area.
+ *
+ * @param tm the map.
+ * @param s the surface.
+ * @param r the area.
+ * @param col cell column.
+ * @param row cell row.
+ */
+static void tilemap_put_cell(tilemap_t *tm, surface_t *s, rect_t *r, int16_t col, int16_t row) {
+    int16_t x = tm->view.left + col * tm->tile_width - tm->x;
+    int16_t y = tm->view.top + row * tm->tile_height - tm->y;
+    int16_t left = x, top = y, right = x + tm->tile_width - 1, bottom = y + tm->tile_height - 1;
+    uint16_t width, stride = tm->tileset->width;
+    uint8_t *src;
+
+    if (left < r->left) {
+        left = r->left;
+    }
+    if (top < r->top) {
+        top = r->top;
+    }
+    if (right > r->right) {
+        right = r->right;
+    }
+    if (bottom > r->bottom) {
+        bottom = r->bottom;
+    }
+
+    src = tm->tiles[tm->shown[tm->cells[(uint16_t)row * tm->width + col]]] + (uint16_t)(top - y) * stride + (left - x);
+    width = right - left + 1;
+    for (; top <= bottom; top++) {
+        vga_surface_put_span(s, left, top, src, width);
+        src += stride;
+    }
+}
+
+/**
+ * @brief mark the surface area covered by a run of cells in one row as modified.
+ *
+ * @param tm the map.
+ * @param s the surface.
+ * @param r the area the cells were clipped to.
+ * @param first first column of the run.
+ * @param last last column of the run.
+ * @param row the row.
+ */
+static void tilemap_dirty_run(tilemap_t *tm, surface_t *s, rect_t *r, int16_t first, int16_t last, int16_t row) {
+    int16_t left = tm->view.left + first * tm->tile_width - tm->x;
+    int16_t top = tm->view.top + row * tm->tile_height - tm->y;
+    int16_t right = tm->view.left + (last + 1) * tm->tile_width - tm->x - 1;
+    int16_t bottom = top + tm->tile_height - 1;
+
+    vga_surface_dirty(s, left < r->left ? r->left : left, top < r->top ? r->top : top, right > r->right ? r->right : right,
+                      bottom > r->bottom ? r->bottom : bottom);
+}
+
+/* ======================================================================
+** public functions
+** ====================================================================== */
+/**
+ * @brief create a tile map. All cells use tile 0 and are dirty, the view covers the whole screen.
+ *
+ * @param tileset bitmap with the tiles, stored left to right and top to bottom. The bitmap must stay valid while the map is used.
+ * @param tile_width width of a tile in pixels.
+ * @param tile_height height of a tile in pixels.
+ * @param width map width in cells.
+ * @param height map height in cells.
+ *
+ * @return a new map or NULL if the parameters are invalid or out of memory.
+ */
+tilemap_t *tilemap_create(bitmap_t *tileset, uint16_t tile_width, uint16_t tile_height, uint16_t width, uint16_t height) {
+    uint16_t num_tiles, per_row, i;
+    uint32_t cells, size;
+    tilemap_t *tm;
+
+    if (!tileset || !tile_width || !tile_height || (tile_width > tileset->width) || (tile_height > tileset->height)) {
+        ERR_PARAM();
+        return NULL;
+    }
+    per_row = tileset->width / tile_width;
+    num_tiles = per_row * (tileset->height / tile_height);
+    if (num_tiles > TILEMAP_MAX_TILES) {
+        num_tiles = TILEMAP_MAX_TILES;
+    }
+    cells = (uint32_t)width * height;
+    size = sizeof(tilemap_t) + num_tiles * sizeof(uint8_t *) + TILEMAP_MAX_TILES + cells + (cells + 7) / 8;
+    if (!cells || (size > 0xFFF0UL)) {
+        ERR_PARAM();
+        return NULL;
+    }
+    tm = calloc((size_t)size, 1);
+    if (!tm) {
+        ERR_NOMEM();
+        return NULL;
+    }
+    tm->tiles = (uint8_t **)(tm + 1);
+    tm->shown = (uint8_t *)&tm->tiles[num_tiles];
+    tm->cells = &tm->shown[TILEMAP_MAX_TILES];
+    tm->dirty = &tm->cells[(uint16_t)cells];
+
+    tm->tileset = tileset;
+    tm->num_tiles = num_tiles;
+    tm->tile_width = tile_width;
+    tm->tile_height = tile_height;
+    tm->width = width;
+    tm->height = height;
+    for (i = 0; i < num_tiles; i++) {
+        tm->tiles[i] = &tileset->data[(uint16_t)(i / per_row) * tile_height * tileset->width + (i % per_row) * tile_width];
+    }
+    for (i = 0; i < TILEMAP_MAX_TILES; i++) {
+        tm->shown[i] = (uint8_t)i;
+    }
+    tilemap_set_view(tm, 0, 0, VGA_SCREEN_WIDTH - 1, VGA_SCREEN_HEIGHT - 1);
+
+    ERR_OK();
+    return tm;
+}
+
+/**
+ * @brief free a tile map. The tileset is not freed.
+ *
+ * @param tm the map or NULL.
+ */
+void tilemap_free(tilemap_t *tm) {
+    if (tm) {
+        free(tm);
+    }
+}
+
+/**
+ * @brief change the tile of a cell. The cell is only marked dirty if the tile changes.
+ *
+ * @param tm the map.
+ * @param col cell column.
+ * @param row cell row.
+ * @param tile the tile number.
+ */
+void tilemap_set(tilemap_t *tm, uint16_t col, uint16_t row, uint8_t tile) {
+    uint16_t idx;
+
+    if ((col >= tm->width) || (row >= tm->height) || (tile >= tm->num_tiles)) {
+        ERR_PARAM();
+        return;
+    }
+    idx = row * tm->width + col;
+    if (tm->cells[idx] != tile) {
+        tm->cells[idx] = tile;
+        TILEMAP_SET_DIRTY(tm, idx);
+    }
+    ERR_OK();
+}
+
+/**
+ * @brief get the tile of a cell.
+ *
+ * @param tm the map.
+ * @param col cell column.
+ * @param row cell row.
+ *
+ * @return the tile number or 0 for cells outside the map.
+ */
+uint8_t tilemap_get(tilemap_t *tm, uint16_t col, uint16_t row) {
+    if ((col >= tm->width) || (row >= tm->height)) {
+        return 0;
+    }
+    return tm->cells[row * tm->width + col];
+}
+
+/**
+ * @brief set the area of the surface the map is drawn into. All cells are marked dirty.
+ *
+ * @param tm the map.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ */
+void tilemap_set_view(tilemap_t *tm, int16_t left, int16_t top, int16_t right, int16_t bottom) {
+    tm->view.left = left;
+    tm->view.top = top;
+    tm->view.right = right;
+    tm->view.bottom = bottom;
+    tilemap_invalidate(tm);
+}
+
+/**
+ * @brief change the map position shown in the top left pixel of the view. All cells are marked dirty if the position changes.
+ *
+ * @param tm the map.
+ * @param x map x position in pixels.
+ * @param y map y position in pixels.
+ */
+void tilemap_scroll_to(tilemap_t *tm, int16_t x, int16_t y) {
+    if ((x != tm->x) || (y != tm->y)) {
+        tm->x = x;
+        tm->y = y;
+        tilemap_invalidate(tm);
+    }
+}
+
+/**
+ * @brief animate a tile. Cells using the tile show the tiles tile..tile+frames-1 in turn.
+ *
+ * @param tm the map.
+ * @param tile first frame and the tile number used in the cells.
+ * @param frames number of frames.
+ * @param delay number of tilemap_animate() calls between two frames.
+ *
+ * @return true if the animation was added, false if the frames are not in the tileset or all animations are used.
+ */
+bool tilemap_add_anim(tilemap_t *tm, uint8_t tile, uint8_t frames, uint8_t delay) {
+    tile_anim_t *a;
+
+    if (!frames || ((uint16_t)tile + frames > tm->num_tiles)) {
+        ERR_PARAM();
+        return false;
+    }
+    if (tm->num_anims >= TILEMAP_MAX_ANIMS) {
+        ERR_NOMEM();
+        return false;
+    }
+    a = &tm->anims[tm->num_anims++];
+    a->tile = tile;
+    a->frames = frames;
+    a->delay = delay ? delay : 1;
+    a->count = a->delay;
+    a->frame = 0;
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief advance all animated tiles by one step, usually once per frame. Cells showing a new frame are marked dirty.
+ *
+ * @param tm the map.
+ */
+void tilemap_animate(tilemap_t *tm) {
+    uint16_t i, num_cells = tm->width * tm->height;
+    tile_anim_t *a;
+    uint8_t n;
+
+    for (n = 0; n < tm->num_anims; n++) {
+        a = &tm->anims[n];
+        if (--a->count) {
+            continue;
+        }
+        a->count = a->delay;
+        if (++a->frame >= a->frames) {
+            a->frame = 0;
+        }
+        tm->shown[a->tile] = a->tile + a->frame;
+        for (i = 0; i < num_cells; i++) {
+            if (tm->cells[i] == a->tile) {
+                TILEMAP_SET_DIRTY(tm, i);
+            }
+        }
+    }
+}
+
+/**
+ * @brief mark all cells dirty.
+ *
+ * @param tm the map.
+ */
+void tilemap_invalidate(tilemap_t *tm) { memset(tm->dirty, 0xFF, ((uint16_t)tm->width * tm->height + 7) / 8); }
+
+/**
+ * @brief mark the cells below an area of the view dirty, e.g. where a sprite was drawn over the map.
+ *
+ * @param tm the map.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ */
+void tilemap_mark_dirty(tilemap_t *tm, int16_t left, int16_t top, int16_t right, int16_t bottom) {
+    rect_t r, cells;
+    int16_t col, row;
+
+    r.left = left < tm->view.left ? tm->view.left : left;
+    r.top = top < tm->view.top ? tm->view.top : top;
+    r.right = right > tm->view.right ? tm->view.right : right;
+    r.bottom = bottom > tm->view.bottom ? tm->view.bottom : bottom;
+    if ((r.left > r.right) || (r.top > r.bottom) || !tilemap_cells(tm, &r, &cells)) {
+        return;
+    }
+    for (row = cells.top; row <= cells.bottom; row++) {
+        for (col = cells.left; col <= cells.right; col++) {
+            TILEMAP_SET_DIRTY(tm, (uint16_t)row * tm->width + col);
+        }
+    }
+}
+
+/**
+ * @brief draw all dirty cells in the view and clear their dirty bits. Cells at the edges of the view and the
+ * clipping rectangle are drawn partially, cells outside stay dirty.
+ *
+ * @param tm the map.
+ * @param s the surface to draw on.
+ *
+ * @return the number of cells drawn, also stored in tilemap_last_drawn.
+ */
+uint16_t tilemap_draw(tilemap_t *tm, surface_t *s) {
+    rect_t r = tm->view, cells;
+    int16_t col, row, run;
+    uint16_t idx;
+
+    tilemap_last_drawn = 0;
+    if (!tilemap_clip(tm, s, &r) || !tilemap_cells(tm, &r, &cells)) {
+        return 0;
+    }
+
+    for (row = cells.top; row <= cells.bottom; row++) {
+        idx = (uint16_t)row * tm->width + cells.left;
+        run = -1;
+        for (col = cells.left; col <= cells.right; col++, idx++) {
+            if (TILEMAP_IS_DIRTY(tm, idx)) {
+                tilemap_put_cell(tm, s, &r, col, row);
+                TILEMAP_CLEAR_DIRTY(tm, idx);
+                tilemap_last_drawn++;
+                if (run < 0) {
+                    run = col;
+                }
+            } else if (run >= 0) {
+                tilemap_dirty_run(tm, s, &r, run, col - 1, row);
+                run = -1;
+            }
+        }
+        if (run >= 0) {
+            tilemap_dirty_run(tm, s, &r, run, cells.right, row);
+        }
+    }
+    return tilemap_last_drawn;
+}
+
+/**
+ * @brief draw all cells that touch an area of the view, dirty or not. The dirty bits are not changed.
+ * This is meant for the scroll_draw_t callback of the scroll module with a view covering the whole world.
+ *
+ * @param tm the map.
+ * @param s the surface to draw on.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ *
+ * @return the number of cells drawn, also stored in tilemap_last_drawn.
+ */
+uint16_t tilemap_draw_rect(tilemap_t *tm, surface_t *s, int16_t left, int16_t top, int16_t right, int16_t bottom) {
+    rect_t r, cells;
+    int16_t col, row;
+
+    tilemap_last_drawn = 0;
+    r.left = left;
+    r.top = top;
+    r.right = right;
+    r.bottom = bottom;
+    if (!tilemap_clip(tm, s, &r) || !tilemap_cells(tm, &r, &cells)) {
+        return 0;
+    }
+
+    for (row = cells.top; row <= cells.bottom; row++) {
+        for (col = cells.left; col <= cells.right; col++) {
+            tilemap_put_cell(tm, s, &r, col, row);
+            tilemap_last_drawn++;
+        }
+    }
+    vga_surface_dirty(s, r.left, r.top, r.right, r.bottom);
+    return tilemap_last_drawn;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file tilemap.h
+ * @author SuperIlu (superilu@yahoo.com)
+ * @brief tile maps that only redraw changed or animated cells.
+ *
+ * @copyright SuperIlu
+ */
+#ifndef __TILEMAP_H_
+#define __TILEMAP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vga.h"
+#include "bitmap.h"
+
+/* ======================================================================
+** defines
+** ====================================================================== */
+#define TILEMAP_MAX_TILES 256  //!< max number of tiles in a tileset
+#define TILEMAP_MAX_ANIMS 8    //!< max number of animated tiles per map
+
+/* ======================================================================
+** typedefs
+** ====================================================================== */
+//! an animated tile, cells using tile show the frames tile..tile+frames-1 in turn
+typedef struct __tile_anim {
+    uint8_t tile;    //!< tile number used in the cells
+    uint8_t frames;  //!< number of frames
+    uint8_t delay;   //!< number of tilemap_animate() calls between two frames
+    uint8_t count;   //!< calls left until the next frame
+    uint8_t frame;   //!< current frame
+} tile_anim_t;
+
+//! a map of tiles
+typedef struct __tilemap {
+    bitmap_t *tileset;        //!< the tiles, stored left to right and top to bottom
+    uint8_t **tiles;          //!< tile cache: pointer to the top left pixel of every tile in the tileset
+    uint8_t *shown;           //!< tile drawn for each tile number, differs for animated tiles
+    uint16_t num_tiles;       //!< number of tiles in the tileset
+    uint16_t tile_width;      //!< width of a tile in pixels
+    uint16_t tile_height;     //!< height of a tile in pixels
+    uint16_t width;           //!< map width in cells
+    uint16_t height;          //!< map height in cells
+    uint8_t *cells;           //!< tile number of every cell, row by row
+    uint8_t *dirty;           //!< one bit for every cell that must be redrawn
+    rect_t view;              //!< area of the surface the map is drawn into
+    int16_t x;                //!< map x position shown in the top left pixel of the view
+    int16_t y;                //!< map y position shown in the top left pixel of the view
+    tile_anim_t anims[TILEMAP_MAX_ANIMS];  //!< animated tiles
+    uint8_t num_anims;        //!< number of used entries in anims
+} tilemap_t;
+
+/* ======================================================================
+** global variables
+** ====================================================================== */
+extern uint16_t tilemap_last_drawn;
+
+/* ======================================================================
+** prototypes
+** ====================================================================== */
+extern tilemap_t *tilemap_create(bitmap_t *tileset, uint16_t tile_width, uint16_t tile_height, uint16_t width, uint16_t height);
+extern void tilemap_free(tilemap_t *tm);
+extern void tilemap_set(tilemap_t *tm, uint16_t col, uint16_t row, uint8_t tile);
+extern uint8_t tilemap_get(tilemap_t *tm, uint16_t col, uint16_t row);
+extern void tilemap_set_view(tilemap_t *tm, int16_t left, int16_t top, int16_t right, int16_t bottom);
+extern void tilemap_scroll_to(tilemap_t *tm, int16_t x, int16_t y);
+extern bool tilemap_add_anim(tilemap_t *tm, uint8_t tile, uint8_t frames, uint8_t delay);
+extern void tilemap_animate(tilemap_t *tm);
+extern void tilemap_invalidate(tilemap_t *tm);
+extern void tilemap_mark_dirty(tilemap_t *tm, int16_t left, int16_t top, int16_t right, int16_t bottom);
+extern uint16_t tilemap_draw(tilemap_t *tm, surface_t *s);
+extern uint16_t tilemap_draw_rect(tilemap_t *tm, surface_t *s, int16_t left, int16_t top, int16_t right, int16_t bottom);
+
+#endif  // __TILEMAP_H_
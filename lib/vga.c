@@ -14,9 +14,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <mem.h>
-#include <math.h>
 
 #include "vga.h"
+#include "modex.h"
+#include "span.h"
+#include "csprite.h"
 #include "mouse.h"
 #include "error.h"
 #include "fixed.h"
@@ -43,70 +45,109 @@
 
 #define VGA_COLOR_SHIFT 2  //!< shift 'normal' 8bit colors to VGA 6bit colors
 
-#define VGA_SINACOS_TABLE_SIZE 1024  //!< size of the sin/acos lookup table
+#define VGA_MAX_POLY_EDGES 64  //!< max number of edges (vertices) for vga_surface_filled_polygon()
+#define VGA_MAX_SLOPE 0x7FFF   //!< max x step per scanline of a polygon edge in pixels
+
+#define VGA_FILL_STACK 256  //!< max number of spans waiting on the flood fill stack, more are remembered in a bitmap
+
+#define VGA_CLIP_LEFT 0x01    //!< outcode: point is left of the clipping rectangle
+#define VGA_CLIP_RIGHT 0x02   //!< outcode: point is right of the clipping rectangle
+#define VGA_CLIP_TOP 0x04     //!< outcode: point is above the clipping rectangle
+#define VGA_CLIP_BOTTOM 0x08  //!< outcode: point is below the clipping rectangle
+
+//! z component of the cross product of two offsets with the y axis pointing up, >= 0 if b is counterclockwise from a
+#define VGA_CROSS(ax, ay, bx, by) ((int32_t)(ay) * (bx) - (int32_t)(ax) * (by))
 
 //! extract sign of a number
 #define VGA_SIGN(x) ((x < 0) ? -1 : ((x > 0) ? 1 : 0))
 
+//! true if a pixel may be changed by a flood fill
+#define VGA_FILLABLE(f, p) (((f)->flags & VGA_FILL_BORDER) ? (((p) != (f)->border) && ((p) != (f)->c)) : ((p) == (f)->old))
+
+#define VGA_AA_SHIFT 10  //!< error accumulator bits below the intensity of an anti-aliased pixel (16 - log2(VGA_AA_LEVELS))
+
 /* ======================================================================
 ** global variables
 ** ====================================================================== */
 //! pointer to VGA memory
 uint8_t *VGA_MEMORY = (uint8_t *)0xA0000000L;
 
+//! off-screen back buffer or NULL if drawing goes directly to VGA_MEMORY
+uint8_t *vga_back_buffer = NULL;
+
+//! incremented whenever the DAC is written, e.g. to find out if the palette must be read again
+uint16_t vga_palette_changes = 0;
+
+/* ======================================================================
+** typedefs
+** ====================================================================== */
+//! polygon edge for the scanline rasterizer, covers the scanlines y_top <= y < y_bottom
+typedef struct __poly_edge {
+    int16_t y_top;     //!< first scanline
+    int16_t y_bottom;  //!< first scanline after the edge
+    fixed16_16 x;      //!< x position on the current scanline
+    fixed16_16 dxdy;   //!< x step per scanline
+} poly_edge_t;
+
+//! sector of an arc, drawn counterclockwise (as seen on screen) from the start ray to the end ray
+typedef struct __arc {
+    int16_t sx;  //!< x offset of a point on the start ray
+    int16_t sy;  //!< y offset of a point on the start ray
+    int16_t ex;  //!< x offset of a point on the end ray
+    int16_t ey;  //!< y offset of a point on the end ray
+    bool full;   //!< start and end ray are the same, the whole ellipse is drawn
+    bool wide;   //!< the sector is larger than 180 degrees
+} vga_arc_t;
+
+//! a scanline part on the flood fill stack
+typedef struct __fill_span {
+    int16_t y;   //!< scanline to search
+    int16_t x1;  //!< x start
+    int16_t x2;  //!< x end
+    int16_t dy;  //!< direction from the filled parent scanline (+1/-1) or 0 if both neighbors must be searched
+} fill_span_t;
+
+//! state of a flood fill
+typedef struct __fill {
+    surface_t *s;             //!< the surface
+    uint8_t flags;            //!< VGA_FILL_* flags
+    color_t c;                //!< fill color
+    color_t old;              //!< color of the area, without VGA_FILL_BORDER
+    color_t border;           //!< border color, with VGA_FILL_BORDER
+    uint8_t *pending;         //!< one bit per pixel of the clipping rectangle for spans that did not fit onto the stack or NULL
+    uint16_t pending_stride;  //!< number of bytes per scanline in pending
+    int16_t pending_top;      //!< first scanline with pending spans
+    int16_t pending_bottom;   //!< last scanline with pending spans, < pending_top if there are none
+    rect_t area;              //!< filled area, right < left if nothing was filled
+    bool failed;              //!< the pending bitmap could not be allocated
+} vga_fill_t;
+
 /* ======================================================================
 ** local variables
 ** ====================================================================== */
 //! indicates of VGA mode is active
 bool vga_active = false;
 
-//! pre calculated sin(acos()) table
-#ifdef VGA_DYNAMIC_TABLE
-static const fixed16_16 SIN_ACOS[VGA_SINACOS_TABLE_SIZE];
-#else
-static const fixed16_16 SIN_ACOS[VGA_SINACOS_TABLE_SIZE] = {
-    65536, 65535, 65535, 65535, 65535, 65535, 65534, 65534, 65533, 65533, 65532, 65532, 65531, 65530, 65529, 65528, 65527, 65526, 65525, 65524, 65523, 65522, 65520, 65519, 65517,
-    65516, 65514, 65513, 65511, 65509, 65507, 65505, 65503, 65501, 65499, 65497, 65495, 65493, 65490, 65488, 65485, 65483, 65480, 65478, 65475, 65472, 65469, 65466, 65463, 65460,
-    65457, 65454, 65451, 65448, 65444, 65441, 65437, 65434, 65430, 65427, 65423, 65419, 65415, 65411, 65407, 65403, 65399, 65395, 65391, 65387, 65382, 65378, 65373, 65369, 65364,
-    65359, 65355, 65350, 65345, 65340, 65335, 65330, 65325, 65320, 65315, 65309, 65304, 65299, 65293, 65287, 65282, 65276, 65270, 65265, 65259, 65253, 65247, 65241, 65235, 65228,
-    65222, 65216, 65210, 65203, 65197, 65190, 65183, 65177, 65170, 65163, 65156, 65149, 65142, 65135, 65128, 65121, 65114, 65106, 65099, 65091, 65084, 65076, 65069, 65061, 65053,
-    65045, 65037, 65030, 65021, 65013, 65005, 64997, 64989, 64980, 64972, 64963, 64955, 64946, 64938, 64929, 64920, 64911, 64902, 64893, 64884, 64875, 64866, 64857, 64847, 64838,
-    64829, 64819, 64809, 64800, 64790, 64780, 64771, 64761, 64751, 64741, 64731, 64720, 64710, 64700, 64690, 64679, 64669, 64658, 64647, 64637, 64626, 64615, 64604, 64593, 64582,
-    64571, 64560, 64549, 64538, 64526, 64515, 64504, 64492, 64480, 64469, 64457, 64445, 64433, 64422, 64410, 64397, 64385, 64373, 64361, 64349, 64336, 64324, 64311, 64299, 64286,
-    64273, 64261, 64248, 64235, 64222, 64209, 64196, 64183, 64169, 64156, 64143, 64129, 64116, 64102, 64088, 64075, 64061, 64047, 64033, 64019, 64005, 63991, 63977, 63963, 63948,
-    63934, 63919, 63905, 63890, 63876, 63861, 63846, 63831, 63816, 63801, 63786, 63771, 63756, 63741, 63725, 63710, 63695, 63679, 63663, 63648, 63632, 63616, 63600, 63584, 63568,
-    63552, 63536, 63520, 63504, 63487, 63471, 63454, 63438, 63421, 63405, 63388, 63371, 63354, 63337, 63320, 63303, 63286, 63269, 63251, 63234, 63216, 63199, 63181, 63164, 63146,
-    63128, 63110, 63092, 63074, 63056, 63038, 63020, 63001, 62983, 62965, 62946, 62927, 62909, 62890, 62871, 62852, 62834, 62815, 62795, 62776, 62757, 62738, 62718, 62699, 62679,
-    62660, 62640, 62621, 62601, 62581, 62561, 62541, 62521, 62501, 62481, 62460, 62440, 62419, 62399, 62378, 62358, 62337, 62316, 62295, 62274, 62253, 62232, 62211, 62190, 62169,
-    62147, 62126, 62104, 62083, 62061, 62039, 62017, 61995, 61973, 61951, 61929, 61907, 61885, 61862, 61840, 61818, 61795, 61772, 61750, 61727, 61704, 61681, 61658, 61635, 61612,
-    61589, 61565, 61542, 61518, 61495, 61471, 61447, 61424, 61400, 61376, 61352, 61328, 61304, 61280, 61255, 61231, 61206, 61182, 61157, 61133, 61108, 61083, 61058, 61033, 61008,
-    60983, 60958, 60932, 60907, 60881, 60856, 60830, 60805, 60779, 60753, 60727, 60701, 60675, 60649, 60623, 60596, 60570, 60543, 60517, 60490, 60463, 60437, 60410, 60383, 60356,
-    60329, 60301, 60274, 60247, 60219, 60192, 60164, 60137, 60109, 60081, 60053, 60025, 59997, 59969, 59941, 59912, 59884, 59855, 59827, 59798, 59769, 59741, 59712, 59683, 59654,
-    59624, 59595, 59566, 59536, 59507, 59477, 59448, 59418, 59388, 59358, 59328, 59298, 59268, 59238, 59207, 59177, 59147, 59116, 59085, 59055, 59024, 58993, 58962, 58931, 58899,
-    58868, 58837, 58805, 58774, 58742, 58711, 58679, 58647, 58615, 58583, 58551, 58519, 58486, 58454, 58421, 58389, 58356, 58323, 58291, 58258, 58225, 58191, 58158, 58125, 58092,
-    58058, 58025, 57991, 57957, 57923, 57889, 57855, 57821, 57787, 57753, 57719, 57684, 57650, 57615, 57580, 57545, 57510, 57475, 57440, 57405, 57370, 57334, 57299, 57263, 57228,
-    57192, 57156, 57120, 57084, 57048, 57012, 56975, 56939, 56902, 56866, 56829, 56792, 56755, 56718, 56681, 56644, 56607, 56569, 56532, 56494, 56457, 56419, 56381, 56343, 56305,
-    56267, 56229, 56190, 56152, 56113, 56074, 56036, 55997, 55958, 55919, 55880, 55840, 55801, 55762, 55722, 55682, 55643, 55603, 55563, 55523, 55482, 55442, 55402, 55361, 55321,
-    55280, 55239, 55198, 55157, 55116, 55075, 55034, 54992, 54951, 54909, 54867, 54825, 54783, 54741, 54699, 54657, 54614, 54572, 54529, 54487, 54444, 54401, 54358, 54315, 54271,
-    54228, 54184, 54141, 54097, 54053, 54009, 53965, 53921, 53877, 53833, 53788, 53743, 53699, 53654, 53609, 53564, 53519, 53473, 53428, 53383, 53337, 53291, 53245, 53199, 53153,
-    53107, 53061, 53014, 52968, 52921, 52874, 52827, 52780, 52733, 52686, 52638, 52591, 52543, 52495, 52447, 52399, 52351, 52303, 52255, 52206, 52158, 52109, 52060, 52011, 51962,
-    51913, 51863, 51814, 51764, 51714, 51664, 51614, 51564, 51514, 51464, 51413, 51362, 51312, 51261, 51210, 51159, 51107, 51056, 51004, 50953, 50901, 50849, 50797, 50744, 50692,
-    50639, 50587, 50534, 50481, 50428, 50375, 50322, 50268, 50215, 50161, 50107, 50053, 49999, 49944, 49890, 49835, 49781, 49726, 49671, 49616, 49560, 49505, 49449, 49394, 49338,
-    49282, 49225, 49169, 49113, 49056, 48999, 48942, 48885, 48828, 48771, 48713, 48655, 48598, 48540, 48482, 48423, 48365, 48306, 48247, 48189, 48129, 48070, 48011, 47951, 47892,
-    47832, 47772, 47712, 47651, 47591, 47530, 47469, 47408, 47347, 47286, 47224, 47163, 47101, 47039, 46977, 46914, 46852, 46789, 46726, 46663, 46600, 46537, 46473, 46409, 46345,
-    46281, 46217, 46153, 46088, 46023, 45958, 45893, 45828, 45762, 45697, 45631, 45565, 45498, 45432, 45365, 45298, 45231, 45164, 45097, 45029, 44962, 44894, 44825, 44757, 44689,
-    44620, 44551, 44482, 44412, 44343, 44273, 44203, 44133, 44063, 43992, 43921, 43850, 43779, 43708, 43636, 43564, 43492, 43420, 43347, 43275, 43202, 43129, 43055, 42982, 42908,
-    42834, 42760, 42685, 42611, 42536, 42461, 42385, 42310, 42234, 42158, 42082, 42005, 41928, 41851, 41774, 41697, 41619, 41541, 41463, 41384, 41306, 41227, 41147, 41068, 40988,
-    40908, 40828, 40748, 40667, 40586, 40505, 40423, 40341, 40259, 40177, 40094, 40011, 39928, 39845, 39761, 39677, 39593, 39508, 39423, 39338, 39253, 39167, 39081, 38995, 38908,
-    38821, 38734, 38647, 38559, 38471, 38382, 38293, 38204, 38115, 38025, 37935, 37845, 37754, 37663, 37572, 37481, 37389, 37296, 37204, 37111, 37017, 36924, 36830, 36735, 36641,
-    36545, 36450, 36354, 36258, 36161, 36065, 35967, 35870, 35772, 35673, 35574, 35475, 35375, 35275, 35175, 35074, 34973, 34871, 34769, 34667, 34564, 34461, 34357, 34253, 34148,
-    34043, 33938, 33832, 33725, 33618, 33511, 33403, 33295, 33186, 33077, 32967, 32857, 32746, 32635, 32524, 32411, 32299, 32185, 32072, 31957, 31842, 31727, 31611, 31495, 31377,
-    31260, 31142, 31023, 30903, 30783, 30663, 30542, 30420, 30297, 30174, 30051, 29926, 29801, 29676, 29549, 29422, 29294, 29166, 29037, 28907, 28776, 28645, 28513, 28380, 28247,
-    28112, 27977, 27841, 27704, 27567, 27428, 27289, 27149, 27008, 26866, 26723, 26579, 26434, 26289, 26142, 25995, 25846, 25696, 25546, 25394, 25241, 25087, 24932, 24776, 24619,
-    24460, 24301, 24140, 23977, 23814, 23649, 23483, 23316, 23147, 22977, 22805, 22632, 22457, 22281, 22103, 21924, 21743, 21560, 21375, 21189, 21000, 20810, 20618, 20424, 20228,
-    20030, 19829, 19626, 19421, 19214, 19004, 18791, 18576, 18358, 18138, 17914, 17687, 17457, 17224, 16987, 16747, 16503, 16255, 16003, 15747, 15486, 15220, 14950, 14674, 14392,
-    14105, 13811, 13511, 13204, 12889, 12566, 12233, 11892, 11539, 11176, 10799, 10409, 10003, 9580,  9136,  8669,  8175,  7649,  7084,  6468,  5786,  5012,  4093,  2895};
-#endif  // VGA_DYNAMIC_TABLE
+//! surface for the screen, see vga_screen()
+static surface_t vga_screen_surface = {NULL, VGA_SCREEN_WIDTH, VGA_SCREEN_WIDTH, VGA_SCREEN_HEIGHT, {0, 0, VGA_SCREEN_WIDTH - 1, VGA_SCREEN_HEIGHT - 1}, 0};
+
+//! areas of the back buffer modified since the last vga_present()
+static rect_t vga_dirty[VGA_MAX_DIRTY];
+
+//! number of entries in vga_dirty
+static uint8_t vga_num_dirty = 0;
+
+//! global edge table for vga_surface_filled_polygon(), sorted by y_top
+static poly_edge_t vga_edges[VGA_MAX_POLY_EDGES];
+
+//! active edge table for vga_surface_filled_polygon(), indices into vga_edges sorted by x
+static uint8_t vga_active_edges[VGA_MAX_POLY_EDGES];
+
+//! spans waiting to be searched by vga_surface_flood_fill()
+static fill_span_t vga_fill_stack[VGA_FILL_STACK];
+
+//! number of entries in vga_fill_stack
+static uint16_t vga_fill_sp = 0;
 
 /* ======================================================================
 ** private functions
@@ -124,406 +165,2154 @@ static void vga_set_mode(int mode) {
     int86(INT_VBIOS, &regs, &regs);
 }
 
-/* ======================================================================
-** public functions
-** ====================================================================== */
 /**
- * @brief switch to VGA 320x240 256 colors.
+ * @brief calculate the number of pixels in the union of two rectangles.
  *
- * @return true if VGA was available and activated, else false.
+ * @param a first rectangle.
+ * @param b second rectangle.
+ *
+ * @return the area of the bounding box of a and b.
  */
-bool vga_init(void) {
-    uint16_t i;
-    union REGS regs;
+static uint32_t vga_union_area(rect_t *a, rect_t *b) {
+    int16_t left = a->left < b->left ? a->left : b->left;
+    int16_t top = a->top < b->top ? a->top : b->top;
+    int16_t right = a->right > b->right ? a->right : b->right;
+    int16_t bottom = a->bottom > b->bottom ? a->bottom : b->bottom;
 
-    regs.x.ax = INT_VBIOS_GET_COMBINATION;
-    int86(INT_VBIOS, &regs, &regs);
+    return (uint32_t)(right - left + 1) * (bottom - top + 1);
+}
 
-    // check of VGA is available
-    if ((regs.h.bl != VGA_MONOCHROME) && (regs.h.bl != VGA_COLOR)) {
-        ERR_AVAIL();
-        return false;
+/**
+ * @brief grow a rectangle so it includes a second one.
+ *
+ * @param a the rectangle to grow.
+ * @param b the rectangle to include.
+ */
+static void vga_union(rect_t *a, rect_t *b) {
+    if (b->left < a->left) {
+        a->left = b->left;
     }
-
-    vga_set_mode(VGA_256);
-
-#ifdef VGA_DYNAMIC_TABLE
-    // create the sin(arccos(x)) table.
-    for (i = 0; i < VGA_SINACOS_TABLE_SIZE; i++) {
-        SIN_ACOS[i] = TO_FIXED(sin(acos((float)i / VGA_SINACOS_TABLE_SIZE)));
+    if (b->top < a->top) {
+        a->top = b->top;
+    }
+    if (b->right > a->right) {
+        a->right = b->right;
+    }
+    if (b->bottom > a->bottom) {
+        a->bottom = b->bottom;
     }
-#endif  // VGA_DYNAMIC_TABLE
-    vga_active = true;
-    ERR_OK();
-    return true;
 }
 
 /**
- * @brief switch back to 80 column text mode.
+ * @brief check if two rectangles overlap or touch each other.
+ *
+ * @param a first rectangle.
+ * @param b second rectangle.
+ *
+ * @return true if the rectangles can be merged without adding a gap, else false.
  */
-void vga_exit(void) {
-    if (vga_active) {
-        vga_set_mode(TEXT_80);
-        vga_active = false;
-    }
+static bool vga_touches(rect_t *a, rect_t *b) {
+    return (a->left <= b->right + 1) && (b->left <= a->right + 1) && (a->top <= b->bottom + 1) && (b->top <= a->bottom + 1);
 }
 
 /**
- * @brief set the whole VGA palette.
+ * @brief check if a pixel is inside the clipping rectangle of a surface.
  *
- * @param palette pointer to an array of colors.
- * @param size number of colors in the palette.
+ * @param s the surface.
+ * @param x x position.
+ * @param y y position.
+ *
+ * @return true if the pixel may be drawn, else false.
  */
-void vga_set_palette(palette_color_t *palette, uint16_t size) {
-    int i;
-    outp(VGA_WRITE_PALETTE_INDEX, 0);
-    for (i = 0; (i < VGA_MAX_COLORS) && (i < size); i++) {
-        outp(VGA_PALETTE_DATA, palette[i].red >> VGA_COLOR_SHIFT);
-        outp(VGA_PALETTE_DATA, palette[i].green >> VGA_COLOR_SHIFT);
-        outp(VGA_PALETTE_DATA, palette[i].blue >> VGA_COLOR_SHIFT);
-    }
-}
+static bool vga_inside(surface_t *s, int16_t x, int16_t y) { return (x >= s->clip.left) && (x <= s->clip.right) && (y >= s->clip.top) && (y <= s->clip.bottom); }
 
 /**
- * @brief set a single color in the VGA palette.
+ * @brief calculate the Cohen-Sutherland outcode of a point.
  *
- * @param idx color index.
- * @param c the new color.
+ * @param s the surface.
+ * @param x x position.
+ * @param y y position.
+ *
+ * @return a combination of VGA_CLIP_* flags or 0 if the point is inside the clipping rectangle.
  */
-void vga_set_color(uint16_t idx, palette_color_t *c) {
-    outp(VGA_WRITE_PALETTE_INDEX, idx);
+static uint8_t vga_outcode(surface_t *s, int16_t x, int16_t y) {
+    uint8_t code = 0;
 
-    outp(VGA_PALETTE_DATA, c->red >> VGA_COLOR_SHIFT);
-    outp(VGA_PALETTE_DATA, c->green >> VGA_COLOR_SHIFT);
-    outp(VGA_PALETTE_DATA, c->blue >> VGA_COLOR_SHIFT);
+    if (x < s->clip.left) {
+        code |= VGA_CLIP_LEFT;
+    } else if (x > s->clip.right) {
+        code |= VGA_CLIP_RIGHT;
+    }
+    if (y < s->clip.top) {
+        code |= VGA_CLIP_TOP;
+    } else if (y > s->clip.bottom) {
+        code |= VGA_CLIP_BOTTOM;
+    }
+    return code;
 }
 
 /**
- * @brief get the whole VGA palette.
+ * @brief calculate a * b / c, rounded towards zero, without overflowing 32 bits.
  *
- * @param palette pointer to memory to hold the colors.
- * @param size max number  of colors to copy.
+ * @param a first factor, |a| <= 65535.
+ * @param b second factor, |b| <= |c|.
+ * @param c divisor, 0 < |c| <= 65535.
+ *
+ * @return the quotient.
  */
-void vga_get_palette(palette_color_t *palette, uint16_t size) {
-    int i;
-    outp(VGA_READ_PALETTE_INDEX, 0);
-    for (i = 0; (i < VGA_MAX_COLORS) && (i < size); i++) {
-        palette[i].red = inp(VGA_PALETTE_DATA) << VGA_COLOR_SHIFT;
-        palette[i].green = inp(VGA_PALETTE_DATA) << VGA_COLOR_SHIFT;
-        palette[i].blue = inp(VGA_PALETTE_DATA) << VGA_COLOR_SHIFT;
-    }
+static int32_t vga_mul_div(int32_t a, int32_t b, int32_t c) {
+    bool neg = ((a < 0) != (b < 0)) != (c < 0);
+    uint32_t ua = a < 0 ? -a : a;
+    uint32_t ub = b < 0 ? -b : b;
+    uint32_t uc = c < 0 ? -c : c;
+    uint32_t q;
+
+    // split a into a multiple of c and a remainder, both products fit into 32 bits unsigned
+    q = (ua / uc) * ub + (ua % uc) * ub / uc;
+    return neg ? -(int32_t)q : (int32_t)q;
 }
 
 /**
- * @brief get a single color from the VGA palette.
+ * @brief clip a line to the clipping rectangle of a surface using the Cohen-Sutherland algorithm.
  *
- * @param idx color index.
- * @param c the memory to read to
+ * @param s the surface.
+ * @param x1 x start, modified if clipped.
+ * @param y1 y start, modified if clipped.
+ * @param x2 x end, modified if clipped.
+ * @param y2 y end, modified if clipped.
+ *
+ * @return true if a part of the line is visible, false if the line is completely outside.
  */
-void vga_get_color(uint16_t idx, palette_color_t *c) {
-    outp(VGA_READ_PALETTE_INDEX, idx);
+static bool vga_clip_line(surface_t *s, int16_t *x1, int16_t *y1, int16_t *x2, int16_t *y2) {
+    uint8_t code1 = vga_outcode(s, *x1, *y1);
+    uint8_t code2 = vga_outcode(s, *x2, *y2);
+    uint8_t code;
+    int32_t x, y;
 
-    c->red = inp(VGA_PALETTE_DATA) << VGA_COLOR_SHIFT;
-    c->green = inp(VGA_PALETTE_DATA) << VGA_COLOR_SHIFT;
-    c->blue = inp(VGA_PALETTE_DATA) << VGA_COLOR_SHIFT;
+    while (true) {
+        if (!(code1 | code2)) {
+            return true;  // both points inside
+        }
+        if (code1 & code2) {
+            return false;  // both points on the same outside
+        }
+
+        // move one outside point onto the edge it is outside of
+        code = code1 ? code1 : code2;
+        if (code & VGA_CLIP_TOP) {
+            x = *x1 + vga_mul_div((int32_t)*x2 - *x1, (int32_t)s->clip.top - *y1, (int32_t)*y2 - *y1);
+            y = s->clip.top;
+        } else if (code & VGA_CLIP_BOTTOM) {
+            x = *x1 + vga_mul_div((int32_t)*x2 - *x1, (int32_t)s->clip.bottom - *y1, (int32_t)*y2 - *y1);
+            y = s->clip.bottom;
+        } else if (code & VGA_CLIP_RIGHT) {
+            y = *y1 + vga_mul_div((int32_t)*y2 - *y1, (int32_t)s->clip.right - *x1, (int32_t)*x2 - *x1);
+            x = s->clip.right;
+        } else {
+            y = *y1 + vga_mul_div((int32_t)*y2 - *y1, (int32_t)s->clip.left - *x1, (int32_t)*x2 - *x1);
+            x = s->clip.left;
+        }
+
+        if (code == code1) {
+            *x1 = (int16_t)x;
+            *y1 = (int16_t)y;
+            code1 = vga_outcode(s, *x1, *y1);
+        } else {
+            *x2 = (int16_t)x;
+            *y2 = (int16_t)y;
+            code2 = vga_outcode(s, *x2, *y2);
+        }
+    }
 }
 
 /**
- * @brief set a grayscale palette.
- * 000..063 := black..gray..white
- * 064..127 := black..red
- * 128..191 := black..green
- * 192..255 := black..blue
+ * @brief fill a horizontal span on a surface. No clipping is done and the area is not marked as modified.
+ *
+ * @param s the surface.
+ * @param y y position.
+ * @param x1 x start, must be <= x2.
+ * @param x2 x end.
+ * @param c color index.
  */
-void vga_grayscale_palette() {
-    int i;
-    outp(VGA_WRITE_PALETTE_INDEX, 0);
-    for (i = 0; i < VGA_MAX_COLORS / 4; i++) {
-        outp(VGA_PALETTE_DATA, i);
-        outp(VGA_PALETTE_DATA, i);
-        outp(VGA_PALETTE_DATA, i);
-    }
-    for (i = 0; i < VGA_MAX_COLORS / 4; i++) {
-        outp(VGA_PALETTE_DATA, i);
-        outp(VGA_PALETTE_DATA, 0);
-        outp(VGA_PALETTE_DATA, 0);
-    }
-    for (i = 0; i < VGA_MAX_COLORS / 4; i++) {
-        outp(VGA_PALETTE_DATA, 0);
-        outp(VGA_PALETTE_DATA, i);
-        outp(VGA_PALETTE_DATA, 0);
-    }
-    for (i = 0; i < VGA_MAX_COLORS / 4; i++) {
-        outp(VGA_PALETTE_DATA, 0);
-        outp(VGA_PALETTE_DATA, 0);
-        outp(VGA_PALETTE_DATA, i);
+void vga_surface_fill_span(surface_t *s, int16_t y, int16_t x1, int16_t x2, color_t c) {
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        modex_fill_span(s, y, x1, x2, c);
+    } else {
+        span_fill(&s->data[(uint16_t)y * s->stride + x1], c, x2 - x1 + 1);
     }
 }
 
 /**
- * @brief draw a pixel on screen.
+ * @brief draw a horizontal span on a surface, clipped to the clipping rectangle.
  *
- * @param x x position.
+ * @param s the surface.
  * @param y y position.
+ * @param x1 x start, must be <= x2.
+ * @param x2 x end.
  * @param c color index.
  */
-void vga_set_pixel(uint16_t x, uint16_t y, color_t c) { VGA_MEMORY[(y << 8) + (y << 6) + x] = c; }
+static void vga_hspan(surface_t *s, int16_t y, int16_t x1, int16_t x2, color_t c) {
+    if ((y < s->clip.top) || (y > s->clip.bottom)) {
+        return;
+    }
+    if (x1 < s->clip.left) {
+        x1 = s->clip.left;
+    }
+    if (x2 > s->clip.right) {
+        x2 = s->clip.right;
+    }
+    if (x1 <= x2) {
+        vga_surface_fill_span(s, y, x1, x2, c);
+    }
+}
 
 /**
- * @brief get a pixel from screen.
+ * @brief draw two pixels on the same scanline of a surface, clipped to the clipping rectangle.
  *
- * @param x x position.
+ * @param s the surface.
  * @param y y position.
- *
- * @return color index.
+ * @param x1 first x position.
+ * @param x2 second x position.
+ * @param c color index.
  */
-color_t vga_get_pixel(uint16_t x, uint16_t y) { return VGA_MEMORY[(y << 8) + (y << 6) + x]; }
+static void vga_hpair(surface_t *s, int16_t y, int16_t x1, int16_t x2, color_t c) {
+    if ((y < s->clip.top) || (y > s->clip.bottom)) {
+        return;
+    }
+    if ((x1 >= s->clip.left) && (x1 <= s->clip.right)) {
+        vga_surface_put_pixel(s, x1, y, c);
+    }
+    if ((x2 >= s->clip.left) && (x2 <= s->clip.right)) {
+        vga_surface_put_pixel(s, x2, y, c);
+    }
+}
 
 /**
- * @brief draw a line on screen
+ * @brief draw a line on a planar surface. The line must be clipped already.
  *
+ * @param s the surface.
  * @param x1 x start
  * @param y1 y start
  * @param x2 x end
  * @param y2 y end
  * @param c color index.
  */
-void vga_line(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, color_t c) {
-    int i, dx, dy, sdx, sdy, dxabs, dyabs, x, y, px, py;
+static void vga_planar_line(surface_t *s, int16_t x1, int16_t y1, int16_t x2, int16_t y2, color_t c) {
+    int i, dx, dy, sdx, sdy, dxabs, dyabs, x, y;
 
-    dx = x2 - x1; /* the horizontal distance of the line */
-    dy = y2 - y1; /* the vertical distance of the line */
+    dx = x2 - x1;
+    dy = y2 - y1;
     dxabs = abs(dx);
     dyabs = abs(dy);
     sdx = VGA_SIGN(dx);
     sdy = VGA_SIGN(dy);
     x = dyabs >> 1;
     y = dxabs >> 1;
-    px = x1;
-    py = y1;
 
-    vga_set_pixel(px, py, c);
+    modex_put_pixel(s, x1, y1, c);
 
-    if (dxabs >= dyabs) { /* the line is more horizontal than vertical */
+    if (dxabs >= dyabs) {
         for (i = 0; i < dxabs; i++) {
             y += dyabs;
             if (y >= dxabs) {
                 y -= dxabs;
-                py += sdy;
+                y1 += sdy;
             }
-            px += sdx;
-            vga_set_pixel(px, py, c);
+            x1 += sdx;
+            modex_put_pixel(s, x1, y1, c);
         }
-    } else { /* the line is more vertical than horizontal */
+    } else {
         for (i = 0; i < dyabs; i++) {
             x += dxabs;
             if (x >= dyabs) {
                 x -= dyabs;
-                px += sdx;
+                x1 += sdx;
             }
-            py += sdy;
-            vga_set_pixel(px, py, c);
+            y1 += sdy;
+            modex_put_pixel(s, x1, y1, c);
         }
     }
 }
 
 /**
- * @brief draw a polygon onto the screen.
+ * @brief write a pixel of an intensity ramp. Pixels of the same ramp are only replaced by brighter ones,
+ * so crossing and joining anti-aliased lines do not get dark notches.
  *
- * @param vertices a array of vertices.
- * @param num_vertices number of vertices in the array.
- * @param c color index.
+ * @param s the surface.
+ * @param x x position.
+ * @param y y position.
+ * @param base first (darkest) color of the ramp.
+ * @param level intensity 0..VGA_AA_LEVELS-1.
  */
-extern void vga_polygon(vertex_t *vertices, uint16_t num_vertices, color_t c) {
-    int i;
+static void vga_aa_pixel(surface_t *s, int16_t x, int16_t y, color_t base, uint8_t level) {
+    uint8_t *p;
+    color_t old;
 
-    for (i = 0; i < num_vertices - 1; i++) {
-        vga_line(vertices[i].x, vertices[i].y, vertices[i + 1].x, vertices[i + 1].y, c);
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        old = modex_get_pixel(s, x, y);
+        if (((uint8_t)(old - base) >= VGA_AA_LEVELS) || ((uint8_t)(old - base) < level)) {
+            modex_put_pixel(s, x, y, base + level);
+        }
+    } else {
+        p = &s->data[(uint16_t)y * s->stride + x];
+        if (((uint8_t)(*p - base) >= VGA_AA_LEVELS) || ((uint8_t)(*p - base) < level)) {
+            *p = base + level;
+        }
     }
-    vga_line(vertices[0].x, vertices[0].y, vertices[num_vertices - 1].x, vertices[num_vertices - 1].y, c);
 }
 
 /**
- * @brief draw a rectangle (outline).
+ * @brief draw an anti-aliased line using Wu's algorithm. The line must be clipped already and y1 <= y2.
+ * The 16bit error accumulator is the distance of the ideal line from the drawn pixel, its upper bits select the intensity
+ * of the pixel pair straddling the line.
  *
- * @param left x start
- * @param top y start
- * @param right x end
- * @param bottom y end
- * @param c color index.
+ * @param s the surface.
+ * @param x1 x start
+ * @param y1 y start
+ * @param x2 x end
+ * @param y2 y end, must be >= y1.
+ * @param base first (darkest) color of the ramp.
  */
-void vga_rect(uint16_t left, uint16_t top, uint16_t right, uint16_t bottom, color_t c) {
-    uint16_t top_offset, bottom_offset, i, temp;
+static void vga_wu_line(surface_t *s, int16_t x1, int16_t y1, int16_t x2, int16_t y2, color_t base) {
+    uint16_t acc = 0, old, adj;
+    int16_t dx, dy, sdx, i;
+    uint8_t w;
 
-    if (top > bottom) {
-        temp = top;
-        top = bottom;
-        bottom = temp;
-    }
-    if (left > right) {
-        temp = left;
-        left = right;
-        right = temp;
-    }
+    dx = x2 - x1;
+    dy = y2 - y1;
+    sdx = VGA_SIGN(dx);
+    dx = abs(dx);
 
-    top_offset = (top << 8) + (top << 6);
-    bottom_offset = (bottom << 8) + (bottom << 6);
+    vga_aa_pixel(s, x1, y1, base, VGA_AA_LEVELS - 1);
 
-    for (i = left; i <= right; i++) {
-        VGA_MEMORY[top_offset + i] = c;
-        VGA_MEMORY[bottom_offset + i] = c;
+    if (dx > dy) {
+        adj = (uint16_t)(((uint32_t)dy << 16) / dx);
+        for (i = 1; i < dx; i++) {
+            old = acc;
+            acc += adj;
+            if (acc < old) {
+                y1++;
+            }
+            x1 += sdx;
+            w = acc >> VGA_AA_SHIFT;
+            vga_aa_pixel(s, x1, y1, base, (VGA_AA_LEVELS - 1) - w);
+            if (w) {
+                vga_aa_pixel(s, x1, y1 + 1, base, w);
+            }
+        }
+    } else if (dy > dx) {
+        adj = (uint16_t)(((uint32_t)dx << 16) / dy);
+        for (i = 1; i < dy; i++) {
+            old = acc;
+            acc += adj;
+            if (acc < old) {
+                x1 += sdx;
+            }
+            y1++;
+            w = acc >> VGA_AA_SHIFT;
+            vga_aa_pixel(s, x1, y1, base, (VGA_AA_LEVELS - 1) - w);
+            if (w) {
+                vga_aa_pixel(s, x1 + sdx, y1, base, w);
+            }
+        }
+    } else {
+        // diagonal, every pixel is exactly on the line
+        for (i = 1; i < dx; i++) {
+            x1 += sdx;
+            y1++;
+            vga_aa_pixel(s, x1, y1, base, VGA_AA_LEVELS - 1);
+        }
     }
-    for (i = top_offset; i <= bottom_offset; i += VGA_SCREEN_WIDTH) {
-        VGA_MEMORY[left + i] = c;
-        VGA_MEMORY[right + i] = c;
+
+    if (dx || dy) {
+        vga_aa_pixel(s, x2, y2, base, VGA_AA_LEVELS - 1);
     }
 }
 
 /**
- * @brief draw a filled rectangle.
+ * @brief read a pixel for the flood fill. No clipping is done.
  *
- * @param left x start
- * @param top y start
- * @param right x end
- * @param bottom y end
- * @param c color index.
+ * @param s the surface.
+ * @param x x position.
+ * @param y y position.
+ *
+ * @return color index.
  */
-void vga_filled_rect(uint16_t left, uint16_t top, uint16_t right, uint16_t bottom, color_t c) {
-    uint16_t top_offset, bottom_offset, i, temp, width;
-
-    if (top > bottom) {
-        temp = top;
-        top = bottom;
-        bottom = temp;
-    }
-    if (left > right) {
-        temp = left;
-        left = right;
-        right = temp;
-    }
-
-    top_offset = (top << 8) + (top << 6) + left;
-    bottom_offset = (bottom << 8) + (bottom << 6) + left;
-    width = right - left + 1;
-
-    for (i = top_offset; i <= bottom_offset; i += VGA_SCREEN_WIDTH) {
-        memset(&VGA_MEMORY[i], c, width);
+static color_t vga_fill_get(surface_t *s, int16_t x, int16_t y) {
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        return modex_get_pixel(s, x, y);
     }
+    return s->data[(uint16_t)y * s->stride + x];
 }
 
 /**
- * @brief hide the mouse pointer before updating the screen. restores pixels previously saved by vga_show_mouse().
+ * @brief find the left end of a run of fillable pixels.
  *
- * @param mouse the mouse info struct from mouse_init()
+ * @param f the flood fill.
+ * @param x x position to start searching leftwards.
+ * @param y y position.
+ *
+ * @return x of the leftmost fillable pixel of the run or x + 1 if the pixel at x is not fillable.
  */
-void vga_hide_mouse(mouse_t *mouse) {
-    int x, y;
-    int mx = mouse->x - mouse->cursor->x;
-    int my = mouse->y - mouse->cursor->y;
-    uint32_t screen_offset = (my << 8) + (my << 6);
-    uint16_t bitmap_offset = 0;
-
-    vga_wait_for_retrace();
-    for (y = 0; y < MOUSE_CURSOR_HEIGHT; y++) {
-        for (x = 0; x < MOUSE_CURSOR_WIDTH; x++, bitmap_offset++) {
-            /* check for screen boundries */
-            if (mx + x < VGA_SCREEN_WIDTH && mx + x >= 0 && my + y < VGA_SCREEN_HEIGHT && my + y >= 0) {
-                VGA_MEMORY[(uint16_t)(screen_offset + mx + x)] = mouse->under->img[bitmap_offset];
-            }
-        }
+static int16_t vga_fill_left(vga_fill_t *f, int16_t x, int16_t y) {
+    surface_t *s = f->s;
+    uint8_t *p;
 
-        screen_offset += VGA_SCREEN_WIDTH;
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        while ((x >= s->clip.left) && VGA_FILLABLE(f, modex_get_pixel(s, x, y))) {
+            x--;
+        }
+    } else {
+        p = &s->data[(uint16_t)y * s->stride + x];
+        while ((x >= s->clip.left) && VGA_FILLABLE(f, *p)) {
+            x--;
+            p--;
+        }
     }
+    return x + 1;
 }
 
 /**
- * @brief draw the mouse pointer over the current screen content. modified pixels are saved for restauration by vga_hide_mouse().
+ * @brief find the right end of a run of fillable pixels.
  *
- * @param mouse the mouse info struct from mouse_init()
+ * @param f the flood fill.
+ * @param x x position to start searching rightwards.
+ * @param y y position.
+ *
+ * @return x of the rightmost fillable pixel of the run or x - 1 if the pixel at x is not fillable.
  */
-void vga_show_mouse(mouse_t *mouse) {
-    int x, y;
-    int mx = mouse->x - mouse->cursor->x;
-    int my = mouse->y - mouse->cursor->y;
-    uint32_t screen_offset = (my << 8) + (my << 6);
-    uint16_t bitmap_offset = 0;
-    uint8_t data;
-
-    for (y = 0; y < MOUSE_CURSOR_HEIGHT; y++) {
-        for (x = 0; x < MOUSE_CURSOR_WIDTH; x++, bitmap_offset++) {
-            mouse->under->img[bitmap_offset] = VGA_MEMORY[(uint16_t)(screen_offset + mx + x)];
-            /* check for screen boundries */
-            if (mx + x < VGA_SCREEN_WIDTH && mx + x >= 0 && my + y < VGA_SCREEN_HEIGHT && my + y >= 0) {
-                data = mouse->cursor->img[bitmap_offset];
-                if (data) {
-                    VGA_MEMORY[(uint16_t)(screen_offset + mx + x)] = data;
-                }
-            }
+static int16_t vga_fill_right(vga_fill_t *f, int16_t x, int16_t y) {
+    surface_t *s = f->s;
+    uint8_t *p;
+
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        while ((x <= s->clip.right) && VGA_FILLABLE(f, modex_get_pixel(s, x, y))) {
+            x++;
+        }
+    } else {
+        p = &s->data[(uint16_t)y * s->stride + x];
+        while ((x <= s->clip.right) && VGA_FILLABLE(f, *p)) {
+            x++;
+            p++;
         }
-        screen_offset += VGA_SCREEN_WIDTH;
     }
+    return x - 1;
 }
 
 /**
- * @brief draw a circle (outline).
+ * @brief skip pixels that are not fillable.
  *
- * @param x center x position.
- * @param y center y position.
- * @param radius radius.
- * @param c color index.
+ * @param f the flood fill.
+ * @param x1 x start
+ * @param x2 x end
+ * @param y y position.
+ *
+ * @return x of the first fillable pixel or x2 + 1 if there is none.
  */
-void vga_circle(uint16_t x, uint16_t y, uint16_t radius, color_t color) {
-    fixed16_16 n = 0, invradius = TO_FIXED(1 / (float)radius);
-    int dx = 0, dy = radius - 1;
-    uint16_t dxoffset, dyoffset, offset = (y << 8) + (y << 6) + x;
+static int16_t vga_fill_skip(vga_fill_t *f, int16_t x1, int16_t x2, int16_t y) {
+    surface_t *s = f->s;
+    uint8_t *p;
 
-    while (dx <= dy) {
-        dxoffset = (dx << 8) + (dx << 6);
-        dyoffset = (dy << 8) + (dy << 6);
-        VGA_MEMORY[offset + dy - dxoffset] = color; /* octant 0 */
-        VGA_MEMORY[offset + dx - dyoffset] = color; /* octant 1 */
-        VGA_MEMORY[offset - dx - dyoffset] = color; /* octant 2 */
-        VGA_MEMORY[offset - dy - dxoffset] = color; /* octant 3 */
-        VGA_MEMORY[offset - dy + dxoffset] = color; /* octant 4 */
-        VGA_MEMORY[offset - dx + dyoffset] = color; /* octant 5 */
-        VGA_MEMORY[offset + dx + dyoffset] = color; /* octant 6 */
-        VGA_MEMORY[offset + dy + dxoffset] = color; /* octant 7 */
-        dx++;
-        n += invradius;
-        dy = (int)((radius * SIN_ACOS[(int)(n >> 6)]) >> 16);
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        while ((x1 <= x2) && !VGA_FILLABLE(f, modex_get_pixel(s, x1, y))) {
+            x1++;
+        }
+    } else {
+        p = &s->data[(uint16_t)y * s->stride + x1];
+        while ((x1 <= x2) && !VGA_FILLABLE(f, *p)) {
+            x1++;
+            p++;
+        }
     }
+    return x1;
 }
 
 /**
- * @brief draw a filled circle.
+ * @brief remember a span that does not fit onto the stack in the pending bitmap, which is allocated on first use.
  *
- * @param x center x position.
- * @param y center y position.
+ * @param f the flood fill.
+ * @param y y position.
+ * @param x1 x start
+ * @param x2 x end
+ */
+static void vga_fill_defer(vga_fill_t *f, int16_t y, int16_t x1, int16_t x2) {
+    surface_t *s = f->s;
+    uint32_t size;
+    uint8_t *row;
+
+    if (!f->pending) {
+        f->pending_stride = ((s->clip.right - s->clip.left) >> 3) + 1;
+        size = (uint32_t)f->pending_stride * (s->clip.bottom - s->clip.top + 1);
+        if (size <= 0xFFF0) {
+            f->pending = calloc((size_t)size, 1);
+        }
+        if (!f->pending) {
+            f->failed = true;
+            return;
+        }
+    }
+
+    row = &f->pending[(uint16_t)(y - s->clip.top) * f->pending_stride];
+    for (x1 -= s->clip.left, x2 -= s->clip.left; x1 <= x2; x1++) {
+        row[x1 >> 3] |= 0x80 >> (x1 & 7);
+    }
+    if (y < f->pending_top) {
+        f->pending_top = y;
+    }
+    if (y > f->pending_bottom) {
+        f->pending_bottom = y;
+    }
+}
+
+/**
+ * @brief put a span onto the flood fill stack, it is ignored if it is outside the clipping rectangle.
+ *
+ * @param f the flood fill.
+ * @param y y position.
+ * @param x1 x start
+ * @param x2 x end
+ * @param dy direction from the filled parent scanline or 0 if unknown.
+ */
+static void vga_fill_push(vga_fill_t *f, int16_t y, int16_t x1, int16_t x2, int16_t dy) {
+    fill_span_t *span;
+
+    if ((y < f->s->clip.top) || (y > f->s->clip.bottom)) {
+        return;
+    }
+    if (vga_fill_sp >= VGA_FILL_STACK) {
+        vga_fill_defer(f, y, x1, x2);
+        return;
+    }
+    span = &vga_fill_stack[vga_fill_sp++];
+    span->y = y;
+    span->x1 = x1;
+    span->x2 = x2;
+    span->dy = dy;
+}
+
+/**
+ * @brief fill all runs of fillable pixels on a scanline that touch a span and push the neighboring scanlines.
+ * Only the parts of the parent scanline that stick out of the span are searched again (Heckbert's seed fill).
+ *
+ * @param f the flood fill.
+ * @param y y position.
+ * @param x1 x start
+ * @param x2 x end
+ * @param dy direction from the filled parent scanline or 0 if both neighbors must be searched.
+ */
+static void vga_fill_scan(vga_fill_t *f, int16_t y, int16_t x1, int16_t x2, int16_t dy) {
+    surface_t *s = f->s;
+    int16_t x, l, r, first = x1, last = x2;
+
+    if (f->flags & VGA_FILL_8) {
+        // diagonal neighbors, the parent scanline must be searched again next to the span
+        if (first > s->clip.left) {
+            first--;
+        }
+        if (last < s->clip.right) {
+            last++;
+        }
+    }
+
+    x = first;
+    while (x <= last) {
+        x = vga_fill_skip(f, x, last, y);
+        if (x > last) {
+            break;
+        }
+        l = (x == first) ? vga_fill_left(f, x, y) : x;
+        r = vga_fill_right(f, x, y);
+        vga_surface_fill_span(s, y, l, r, f->c);
+        if (l < f->area.left) {
+            f->area.left = l;
+        }
+        if (r > f->area.right) {
+            f->area.right = r;
+        }
+        if (y < f->area.top) {
+            f->area.top = y;
+        }
+        if (y > f->area.bottom) {
+            f->area.bottom = y;
+        }
+
+        if (dy) {
+            vga_fill_push(f, y + dy, l, r, dy);
+            if (l < x1) {
+                vga_fill_push(f, y - dy, l, x1 - 1, -dy);
+            }
+            if (r > x2) {
+                vga_fill_push(f, y - dy, x2 + 1, r, -dy);
+            }
+        } else {
+            vga_fill_push(f, y + 1, l, r, 1);
+            vga_fill_push(f, y - 1, l, r, -1);
+        }
+        x = r + 2;  // r + 1 is not fillable
+    }
+}
+
+/**
+ * @brief process the flood fill stack until it is empty.
+ *
+ * @param f the flood fill.
+ */
+static void vga_fill_drain(vga_fill_t *f) {
+    fill_span_t span;
+
+    while (vga_fill_sp) {
+        span = vga_fill_stack[--vga_fill_sp];
+        vga_fill_scan(f, span.y, span.x1, span.x2, span.dy);
+    }
+}
+
+/**
+ * @brief search all spans in the pending bitmap. Spans that do not fit onto the stack while doing this are added to the bitmap again.
+ *
+ * @param f the flood fill.
+ */
+static void vga_fill_pending(vga_fill_t *f) {
+    surface_t *s = f->s;
+    int16_t y, top = f->pending_top, bottom = f->pending_bottom, x, x1, width = s->clip.right - s->clip.left + 1;
+    uint8_t *row;
+
+    f->pending_top = INT16_MAX;
+    f->pending_bottom = INT16_MIN;
+    for (y = top; y <= bottom; y++) {
+        row = &f->pending[(uint16_t)(y - s->clip.top) * f->pending_stride];
+        x = 0;
+        while (x < width) {
+            if (!row[x >> 3]) {
+                x = (x | 7) + 1;  // skip empty bytes
+                continue;
+            }
+            if (!(row[x >> 3] & (0x80 >> (x & 7)))) {
+                x++;
+                continue;
+            }
+            for (x1 = x; (x < width) && (row[x >> 3] & (0x80 >> (x & 7))); x++) {
+                row[x >> 3] &= ~(0x80 >> (x & 7));
+            }
+            vga_fill_scan(f, y, s->clip.left + x1, s->clip.left + x - 1, 0);
+            vga_fill_drain(f);
+        }
+    }
+}
+
+/**
+ * @brief get the x step per scanline of an edge. The difference is divided before it is scaled, so edges wider than
+ * 32767 pixels do not overflow.
+ *
+ * @param dx x difference.
+ * @param dy y difference, must be > 0.
+ *
+ * @return the step, limited to VGA_MAX_SLOPE pixels per scanline.
+ */
+static fixed16_16 vga_slope(int32_t dx, int32_t dy) {
+    uint32_t ud = dx < 0 ? -dx : dx, q, r;
+
+    q = ud / dy;
+    r = ud % dy;
+    if (q > VGA_MAX_SLOPE) {
+        q = VGA_MAX_SLOPE;
+        r = 0;
+    }
+
+    // the fraction in two 8bit steps, r < dy
+    r <<= 8;
+    q = (q << 8) + r / dy;
+    r = (r % dy) << 8;
+    q = (q << 8) + r / dy;
+    return dx < 0 ? -(fixed16_16)q : (fixed16_16)q;
+}
+
+/**
+ * @brief move an edge down by several scanlines. The product of step and scanlines can exceed 32 bits for wide edges,
+ * so it is added in two halves. The result lies on the edge and always fits.
+ *
+ * @param x x of the edge.
+ * @param dxdy x step per scanline.
+ * @param n number of scanlines.
+ *
+ * @return x n scanlines further down.
+ */
+static fixed16_16 vga_edge_step(fixed16_16 x, fixed16_16 dxdy, uint16_t n) {
+    x += dxdy * (n >> 1);
+    return x + dxdy * (n - (n >> 1));
+}
+
+/**
+ * @brief fill the scanlines y1 <= y < y2 between two edges, clipped to the clipping rectangle.
+ * Pixels are filled if xa <= x < xb (or xb <= x < xa), so polygons sharing an edge do not overlap.
+ *
+ * @param s the surface.
+ * @param y1 first scanline.
+ * @param y2 first scanline after the area.
+ * @param xa x of the first edge at y1, returns x at y2.
+ * @param da x step per scanline of the first edge.
+ * @param xb x of the second edge at y1, returns x at y2.
+ * @param db x step per scanline of the second edge.
+ * @param c color index.
+ */
+static void vga_fill_trapezoid(surface_t *s, int16_t y1, int16_t y2, fixed16_16 *xa, fixed16_16 da, fixed16_16 *xb, fixed16_16 db, color_t c) {
+    fixed16_16 a = *xa, b = *xb;
+    int16_t y = y1, end = y2;
+
+    *xa = vga_edge_step(*xa, da, (uint16_t)y2 - (uint16_t)y1);
+    *xb = vga_edge_step(*xb, db, (uint16_t)y2 - (uint16_t)y1);
+
+    if (y < s->clip.top) {
+        if (end <= s->clip.top) {
+            return;
+        }
+        a = vga_edge_step(a, da, (uint16_t)s->clip.top - (uint16_t)y);
+        b = vga_edge_step(b, db, (uint16_t)s->clip.top - (uint16_t)y);
+        y = s->clip.top;
+    }
+    if (end > s->clip.bottom + 1) {
+        end = s->clip.bottom + 1;
+    }
+
+    for (; y < end; y++) {
+        if (a < b) {
+            vga_hspan(s, y, (int16_t)FROM_FIXED_CEIL(a), (int16_t)FROM_FIXED_CEIL(b) - 1, c);
+        } else {
+            vga_hspan(s, y, (int16_t)FROM_FIXED_CEIL(b), (int16_t)FROM_FIXED_CEIL(a) - 1, c);
+        }
+        a += da;
+        b += db;
+    }
+}
+
+/**
+ * @brief fill a triangle. This is the fast path of vga_surface_filled_polygon() for three vertices.
+ *
+ * @param s the surface.
+ * @param v0 first vertex.
+ * @param v1 second vertex.
+ * @param v2 third vertex.
+ * @param c color index.
+ */
+static void vga_filled_triangle(surface_t *s, vertex_t *v0, vertex_t *v1, vertex_t *v2, color_t c) {
+    vertex_t *temp;
+    fixed16_16 x_long, d_long, x_short, d_short;
+
+    // sort by y
+    if (v0->y > v1->y) {
+        temp = v0;
+        v0 = v1;
+        v1 = temp;
+    }
+    if (v1->y > v2->y) {
+        temp = v1;
+        v1 = v2;
+        v2 = temp;
+    }
+    if (v0->y > v1->y) {
+        temp = v0;
+        v0 = v1;
+        v1 = temp;
+    }
+    if (v0->y == v2->y) {
+        return;  // no scanlines
+    }
+
+    // edge v0->v2 spans all scanlines, v0->v1 and v1->v2 the upper and lower part
+    x_long = TO_FIXED((fixed16_16)v0->x);
+    d_long = vga_slope((int32_t)v2->x - v0->x, (int32_t)v2->y - v0->y);
+    if (v0->y != v1->y) {
+        x_short = TO_FIXED((fixed16_16)v0->x);
+        d_short = vga_slope((int32_t)v1->x - v0->x, (int32_t)v1->y - v0->y);
+        vga_fill_trapezoid(s, v0->y, v1->y, &x_long, d_long, &x_short, d_short, c);
+    }
+    if (v1->y != v2->y) {
+        x_short = TO_FIXED((fixed16_16)v1->x);
+        d_short = vga_slope((int32_t)v2->x - v1->x, (int32_t)v2->y - v1->y);
+        vga_fill_trapezoid(s, v1->y, v2->y, &x_long, d_long, &x_short, d_short, c);
+    }
+}
+
+
+/**
+ * @brief initialize the sector of an arc.
+ *
+ * @param arc the sector to initialize.
+ * @param sx x offset of a point on the start ray, relative to the center.
+ * @param sy y offset of a point on the start ray, relative to the center.
+ * @param ex x offset of a point on the end ray, relative to the center.
+ * @param ey y offset of a point on the end ray, relative to the center.
+ */
+static void vga_arc_init(vga_arc_t *arc, int16_t sx, int16_t sy, int16_t ex, int16_t ey) {
+    int32_t cross = VGA_CROSS(sx, sy, ex, ey);
+
+    arc->sx = sx;
+    arc->sy = sy;
+    arc->ex = ex;
+    arc->ey = ey;
+    arc->full = (!sx && !sy) || (!ex && !ey) || (!cross && ((int32_t)sx * ex + (int32_t)sy * ey > 0));
+    arc->wide = cross < 0;
+}
+
+/**
+ * @brief draw a pixel of an arc if it is inside the sector and the clipping rectangle.
+ *
+ * @param s the surface.
+ * @param x center x position.
+ * @param y center y position.
+ * @param dx x offset from the center.
+ * @param dy y offset from the center.
+ * @param c color index.
+ * @param arc the sector.
+ */
+static void vga_arc_pixel(surface_t *s, int16_t x, int16_t y, int16_t dx, int16_t dy, color_t c, vga_arc_t *arc) {
+    bool after_start = VGA_CROSS(arc->sx, arc->sy, dx, dy) >= 0;
+    bool before_end = VGA_CROSS(dx, dy, arc->ex, arc->ey) >= 0;
+
+    if (!arc->full && (arc->wide ? !(after_start || before_end) : !(after_start && before_end))) {
+        return;
+    }
+    x += dx;
+    y += dy;
+    if ((x >= s->clip.left) && (x <= s->clip.right) && (y >= s->clip.top) && (y <= s->clip.bottom)) {
+        vga_surface_put_pixel(s, x, y, c);
+    }
+}
+
+/**
+ * @brief draw the four points of an ellipse outline that mirror each other around the center.
+ *
+ * @param s the surface.
+ * @param x center x position.
+ * @param y center y position.
+ * @param dx x offset from the center.
+ * @param dy y offset from the center.
+ * @param c color index.
+ * @param arc only draw points inside this sector or NULL to draw all points.
+ */
+static void vga_ellipse_points(surface_t *s, int16_t x, int16_t y, int16_t dx, int16_t dy, color_t c, vga_arc_t *arc) {
+    if (arc) {
+        vga_arc_pixel(s, x, y, dx, -dy, c, arc);
+        vga_arc_pixel(s, x, y, -dx, -dy, c, arc);
+        vga_arc_pixel(s, x, y, -dx, dy, c, arc);
+        vga_arc_pixel(s, x, y, dx, dy, c, arc);
+    } else {
+        vga_hpair(s, y - dy, x - dx, x + dx, c);
+        vga_hpair(s, y + dy, x - dx, x + dx, c);
+    }
+}
+
+/**
+ * @brief draw an ellipse outline with the integer algorithm from John Kennedy's "A Fast Bresenham Type Algorithm For Drawing Ellipses".
+ * The flat quadrant edge is walked column by column first, then the steep edge scanline by scanline until it meets the flat part.
+ * The error terms grow with rx * rx * ry and overflow 32 bits for radii above about 800, so they are kept in 64 bits.
+ *
+ * @param s the surface.
+ * @param x center x position.
+ * @param y center y position.
+ * @param rx horizontal radius.
+ * @param ry vertical radius.
+ * @param c color index.
+ * @param arc only draw points inside this sector or NULL to draw the whole ellipse.
+ */
+static void vga_ellipse_outline(surface_t *s, int16_t x, int16_t y, uint16_t rx, uint16_t ry, color_t c, vga_arc_t *arc) {
+    int64_t two_a2 = 2 * (int64_t)rx * rx, two_b2 = 2 * (int64_t)ry * ry;
+    int64_t x_change, y_change, error, stop_x, stop_y;
+    int16_t dx, dy, i, end, prev_dx, flat_dx, flat_dy;
+
+    if (!rx || !ry) {
+        // degenerated to a line
+        for (dx = 0; dx <= (int16_t)rx; dx++) {
+            for (dy = 0; dy <= (int16_t)ry; dy++) {
+                vga_ellipse_points(s, x, y, dx, dy, c, arc);
+            }
+        }
+        return;
+    }
+
+    // flat part: one step per column
+    dx = 0;
+    dy = ry;
+    x_change = (int64_t)ry * ry;
+    y_change = (int64_t)rx * rx * (1 - 2 * (int32_t)ry);
+    error = 0;
+    stop_x = 0;
+    stop_y = two_a2 * ry;
+    while (stop_x <= stop_y) {
+        vga_ellipse_points(s, x, y, dx, dy, c, arc);
+        dx++;
+        stop_x += two_b2;
+        error += x_change;
+        x_change += two_b2;
+        if (2 * error + y_change > 0) {
+            dy--;
+            stop_y -= two_a2;
+            error += y_change;
+            y_change += two_a2;
+        }
+    }
+    flat_dx = dx;
+    flat_dy = dy;
+
+    // steep part: one step per scanline up to the scanline where the flat part stopped. Near that scanline dx can
+    // change by more than one, the skipped points are drawn so the outline stays connected.
+    dx = rx;
+    prev_dx = rx;
+    x_change = (int64_t)ry * ry * (1 - 2 * (int32_t)rx);
+    y_change = (int64_t)rx * rx;
+    error = 0;
+    for (dy = 0; dy <= flat_dy; dy++) {
+        // on the last scanline the points up to where the flat part stopped are drawn as well
+        i = ((dy == flat_dy) && (flat_dx < dx)) ? flat_dx : dx;
+        end = prev_dx - 1 > dx ? prev_dx - 1 : dx;
+        for (; i <= end; i++) {
+            vga_ellipse_points(s, x, y, i, dy, c, arc);
+        }
+        prev_dx = dx;
+        error += y_change;
+        y_change += two_a2;
+        while ((dx > 0) && (2 * error + x_change > 0)) {
+            dx--;
+            error += x_change;
+            x_change += two_b2;
+        }
+    }
+}
+
+/**
+ * @brief draw a filled ellipse as horizontal spans, using the same steps as vga_ellipse_outline(). Every scanline is drawn once.
+ *
+ * @param s the surface.
+ * @param x center x position.
+ * @param y center y position.
+ * @param rx horizontal radius.
+ * @param ry vertical radius.
+ * @param c color index.
+ */
+static void vga_ellipse_fill(surface_t *s, int16_t x, int16_t y, uint16_t rx, uint16_t ry, color_t c) {
+    int64_t two_a2 = 2 * (int64_t)rx * rx, two_b2 = 2 * (int64_t)ry * ry;
+    int64_t x_change, y_change, error, stop_x, stop_y;
+    int16_t dx, dy, row_dx, flat_dy;
+
+    if (!rx || !ry) {
+        // degenerated to a line
+        for (dy = 0; dy <= (int16_t)ry; dy++) {
+            vga_hspan(s, y - dy, x - rx, x + rx, c);
+            if (dy) {
+                vga_hspan(s, y + dy, x - rx, x + rx, c);
+            }
+        }
+        return;
+    }
+
+    // flat part: the span of a scanline is drawn with the last dx before dy changes
+    dx = 0;
+    dy = ry;
+    x_change = (int64_t)ry * ry;
+    y_change = (int64_t)rx * rx * (1 - 2 * (int32_t)ry);
+    error = 0;
+    stop_x = 0;
+    stop_y = two_a2 * ry;
+    while (stop_x <= stop_y) {
+        row_dx = dx;
+        dx++;
+        stop_x += two_b2;
+        error += x_change;
+        x_change += two_b2;
+        if (2 * error + y_change > 0) {
+            vga_hspan(s, y - dy, x - row_dx, x + row_dx, c);
+            vga_hspan(s, y + dy, x - row_dx, x + row_dx, c);
+            dy--;
+            stop_y -= two_a2;
+            error += y_change;
+            y_change += two_a2;
+        }
+    }
+    flat_dy = dy;  // the first scanline the flat part did not finish, never 0
+
+    // steep part: one step per scanline up to and including flat_dy, dx can change by more than one near the end
+    dx = rx;
+    x_change = (int64_t)ry * ry * (1 - 2 * (int32_t)rx);
+    y_change = (int64_t)rx * rx;
+    error = 0;
+    for (dy = 0; dy <= flat_dy; dy++) {
+        vga_hspan(s, y - dy, x - dx, x + dx, c);
+        if (dy) {
+            vga_hspan(s, y + dy, x - dx, x + dx, c);
+        }
+        error += y_change;
+        y_change += two_a2;
+        while ((dx > 0) && (2 * error + x_change > 0)) {
+            dx--;
+            error += x_change;
+            x_change += two_b2;
+        }
+    }
+}
+
+/* ======================================================================
+** public functions
+** ====================================================================== */
+/**
+ * @brief switch to VGA 320x200 256 colors.
+ *
+ * @return true if VGA was available and activated, else false.
+ */
+bool vga_init(void) {
+    union REGS regs;
+
+    regs.x.ax = INT_VBIOS_GET_COMBINATION;
+    int86(INT_VBIOS, &regs, &regs);
+
+    // check of VGA is available
+    if ((regs.h.bl != VGA_MONOCHROME) && (regs.h.bl != VGA_COLOR)) {
+        ERR_AVAIL();
+        return false;
+    }
+
+    vga_set_mode(VGA_256);
+    modex_exit();
+    vga_surface_init(&vga_screen_surface, VGA_BUFFER, VGA_SCREEN_WIDTH, VGA_SCREEN_WIDTH, VGA_SCREEN_HEIGHT);
+    vga_active = true;
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief switch back to 80 column text mode.
+ */
+void vga_exit(void) {
+    vga_release_back_buffer();
+    modex_exit();
+    vga_surface_init(&vga_screen_surface, VGA_BUFFER, VGA_SCREEN_WIDTH, VGA_SCREEN_WIDTH, VGA_SCREEN_HEIGHT);
+    if (vga_active) {
+        vga_set_mode(TEXT_80);
+        vga_active = false;
+    }
+}
+
+/**
+ * @brief set the whole VGA palette.
+ *
+ * @param palette pointer to an array of colors.
+ * @param size number of colors in the palette.
+ */
+void vga_set_palette(palette_color_t *palette, uint16_t size) {
+    int i;
+    vga_palette_changes++;
+    outp(VGA_WRITE_PALETTE_INDEX, 0);
+    for (i = 0; (i < VGA_MAX_COLORS) && (i < size); i++) {
+        outp(VGA_PALETTE_DATA, palette[i].red >> VGA_COLOR_SHIFT);
+        outp(VGA_PALETTE_DATA, palette[i].green >> VGA_COLOR_SHIFT);
+        outp(VGA_PALETTE_DATA, palette[i].blue >> VGA_COLOR_SHIFT);
+    }
+}
+
+/**
+ * @brief set a single color in the VGA palette.
+ *
+ * @param idx color index.
+ * @param c the new color.
+ */
+void vga_set_color(uint16_t idx, palette_color_t *c) {
+    vga_palette_changes++;
+    outp(VGA_WRITE_PALETTE_INDEX, idx);
+
+    outp(VGA_PALETTE_DATA, c->red >> VGA_COLOR_SHIFT);
+    outp(VGA_PALETTE_DATA, c->green >> VGA_COLOR_SHIFT);
+    outp(VGA_PALETTE_DATA, c->blue >> VGA_COLOR_SHIFT);
+}
+
+/**
+ * @brief get the whole VGA palette.
+ *
+ * @param palette pointer to memory to hold the colors.
+ * @param size max number  of colors to copy.
+ */
+void vga_get_palette(palette_color_t *palette, uint16_t size) {
+    int i;
+    outp(VGA_READ_PALETTE_INDEX, 0);
+    for (i = 0; (i < VGA_MAX_COLORS) && (i < size); i++) {
+        palette[i].red = inp(VGA_PALETTE_DATA) << VGA_COLOR_SHIFT;
+        palette[i].green = inp(VGA_PALETTE_DATA) << VGA_COLOR_SHIFT;
+        palette[i].blue = inp(VGA_PALETTE_DATA) << VGA_COLOR_SHIFT;
+    }
+}
+
+/**
+ * @brief get a single color from the VGA palette.
+ *
+ * @param idx color index.
+ * @param c the memory to read to
+ */
+void vga_get_color(uint16_t idx, palette_color_t *c) {
+    outp(VGA_READ_PALETTE_INDEX, idx);
+
+    c->red = inp(VGA_PALETTE_DATA) << VGA_COLOR_SHIFT;
+    c->green = inp(VGA_PALETTE_DATA) << VGA_COLOR_SHIFT;
+    c->blue = inp(VGA_PALETTE_DATA) << VGA_COLOR_SHIFT;
+}
+
+/**
+ * @brief set a grayscale palette.
+ * 000..063 := black..gray..white
+ * 064..127 := black..red
+ * 128..191 := black..green
+ * 192..255 := black..blue
+ */
+void vga_grayscale_palette() {
+    int i;
+    vga_palette_changes++;
+    outp(VGA_WRITE_PALETTE_INDEX, 0);
+    for (i = 0; i < VGA_MAX_COLORS / 4; i++) {
+        outp(VGA_PALETTE_DATA, i);
+        outp(VGA_PALETTE_DATA, i);
+        outp(VGA_PALETTE_DATA, i);
+    }
+    for (i = 0; i < VGA_MAX_COLORS / 4; i++) {
+        outp(VGA_PALETTE_DATA, i);
+        outp(VGA_PALETTE_DATA, 0);
+        outp(VGA_PALETTE_DATA, 0);
+    }
+    for (i = 0; i < VGA_MAX_COLORS / 4; i++) {
+        outp(VGA_PALETTE_DATA, 0);
+        outp(VGA_PALETTE_DATA, i);
+        outp(VGA_PALETTE_DATA, 0);
+    }
+    for (i = 0; i < VGA_MAX_COLORS / 4; i++) {
+        outp(VGA_PALETTE_DATA, 0);
+        outp(VGA_PALETTE_DATA, 0);
+        outp(VGA_PALETTE_DATA, i);
+    }
+}
+
+/**
+ * @brief get the surface for the screen. It draws to the back buffer if vga_begin_frame() was called, else directly to VGA_MEMORY.
+ * In the unchained modes it draws to the page selected with modex_set_draw_page().
+ *
+ * @return the screen surface.
+ */
+surface_t *vga_screen(void) {
+    if (modex_height) {
+        vga_screen_surface.data = modex_page(modex_draw_page);
+    } else {
+        vga_screen_surface.data = VGA_BUFFER;
+    }
+    return &vga_screen_surface;
+}
+
+/**
+ * @brief mark an area of a surface as modified. Only the screen surface tracks modifications, see vga_mark_dirty().
+ * The area is limited to the clipping rectangle. Coordinates must be ordered (left <= right, top <= bottom).
+ *
+ * @param s the surface.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ */
+void vga_surface_dirty(surface_t *s, int16_t left, int16_t top, int16_t right, int16_t bottom) {
+    if (s == &vga_screen_surface) {
+        vga_mark_dirty(left < s->clip.left ? s->clip.left : left, top < s->clip.top ? s->clip.top : top, right > s->clip.right ? s->clip.right : right,
+                       bottom > s->clip.bottom ? s->clip.bottom : bottom);
+    }
+}
+
+/**
+ * @brief initialize a surface for arbitrary memory. The clipping rectangle is set to the whole surface.
+ *
+ * @param s the surface to initialize.
+ * @param data pointer to the first pixel.
+ * @param stride number of bytes from one scanline to the next.
+ * @param width width in pixels.
+ * @param height height in pixels.
+ */
+void vga_surface_init(surface_t *s, uint8_t *data, uint16_t stride, uint16_t width, uint16_t height) {
+    s->data = data;
+    s->stride = stride;
+    s->width = width;
+    s->height = height;
+    s->clip.left = 0;
+    s->clip.top = 0;
+    s->clip.right = width - 1;
+    s->clip.bottom = height - 1;
+    s->flags = 0;
+}
+
+/**
+ * @brief restrict drawing on a surface to a rectangle. The rectangle is limited to the surface area.
+ *
+ * @param s the surface.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ */
+void vga_surface_set_clip(surface_t *s, int16_t left, int16_t top, int16_t right, int16_t bottom) {
+    s->clip.left = left < 0 ? 0 : left;
+    s->clip.top = top < 0 ? 0 : top;
+    s->clip.right = right >= (int16_t)s->width ? s->width - 1 : right;
+    s->clip.bottom = bottom >= (int16_t)s->height ? s->height - 1 : bottom;
+}
+
+/**
+ * @brief write a pixel to a surface. No clipping is done and the pixel is not marked as modified.
+ *
+ * @param s the surface.
+ * @param x x position.
+ * @param y y position.
+ * @param c color index.
+ */
+void vga_surface_put_pixel(surface_t *s, int16_t x, int16_t y, color_t c) {
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        modex_put_pixel(s, x, y, c);
+    } else {
+        s->data[(uint16_t)y * s->stride + x] = c;
+    }
+}
+
+/**
+ * @brief copy a horizontal run of pixels to a surface. No clipping is done and the area is not marked as modified.
+ *
+ * @param s the surface.
+ * @param x x start
+ * @param y y position.
+ * @param src the pixels to copy.
+ * @param len number of pixels.
+ */
+void vga_surface_put_span(surface_t *s, int16_t x, int16_t y, const uint8_t *src, uint16_t len) {
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        modex_copy_span(s, x, y, src, len);
+    } else {
+        span_copy(&s->data[(uint16_t)y * s->stride + x], src, len);
+    }
+}
+
+/**
+ * @brief draw a pixel on a surface.
+ *
+ * @param s the surface.
+ * @param x x position.
+ * @param y y position.
+ * @param c color index.
+ */
+void vga_surface_set_pixel(surface_t *s, int16_t x, int16_t y, color_t c) {
+    if (vga_inside(s, x, y)) {
+        vga_surface_put_pixel(s, x, y, c);
+        vga_surface_dirty(s, x, y, x, y);
+    }
+}
+
+/**
+ * @brief get a pixel from a surface.
+ *
+ * @param s the surface.
+ * @param x x position.
+ * @param y y position.
+ *
+ * @return color index or 0 if x/y are outside of the surface.
+ */
+color_t vga_surface_get_pixel(surface_t *s, int16_t x, int16_t y) {
+    if ((x < 0) || (y < 0) || (x >= (int16_t)s->width) || (y >= (int16_t)s->height)) {
+        return 0;
+    }
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        return modex_get_pixel(s, x, y);
+    }
+    return s->data[(uint16_t)y * s->stride + x];
+}
+
+/**
+ * @brief draw a line on a surface. The line is clipped to the clipping rectangle before it is drawn.
+ *
+ * @param s the surface.
+ * @param x1 x start
+ * @param y1 y start
+ * @param x2 x end
+ * @param y2 y end
+ * @param c color index.
+ */
+void vga_surface_line(surface_t *s, int16_t x1, int16_t y1, int16_t x2, int16_t y2, color_t c) {
+    int i, dx, dy, sdx, sdy, dxabs, dyabs, x, y;
+    uint8_t *p;
+
+    if (!vga_clip_line(s, &x1, &y1, &x2, &y2)) {
+        return;
+    }
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        vga_planar_line(s, x1, y1, x2, y2, c);
+        vga_surface_dirty(s, x1 < x2 ? x1 : x2, y1 < y2 ? y1 : y2, x1 < x2 ? x2 : x1, y1 < y2 ? y2 : y1);
+        return;
+    }
+
+    dx = x2 - x1; /* the horizontal distance of the line */
+    dy = y2 - y1; /* the vertical distance of the line */
+    dxabs = abs(dx);
+    dyabs = abs(dy);
+    sdx = VGA_SIGN(dx);
+    sdy = VGA_SIGN(dy) * (int)s->stride;
+    x = dyabs >> 1;
+    y = dxabs >> 1;
+    p = &s->data[(uint16_t)y1 * s->stride + x1];
+
+    *p = c;
+
+    if (dxabs >= dyabs) { /* the line is more horizontal than vertical */
+        for (i = 0; i < dxabs; i++) {
+            y += dyabs;
+            if (y >= dxabs) {
+                y -= dxabs;
+                p += sdy;
+            }
+            p += sdx;
+            *p = c;
+        }
+    } else { /* the line is more vertical than horizontal */
+        for (i = 0; i < dyabs; i++) {
+            x += dxabs;
+            if (x >= dyabs) {
+                x -= dyabs;
+                p += sdx;
+            }
+            p += sdy;
+            *p = c;
+        }
+    }
+    vga_surface_dirty(s, x1 < x2 ? x1 : x2, y1 < y2 ? y1 : y2, x1 < x2 ? x2 : x1, y1 < y2 ? y2 : y1);
+}
+
+/**
+ * @brief draw a polygon onto a surface.
+ *
+ * @param s the surface.
+ * @param vertices a array of vertices.
+ * @param num_vertices number of vertices in the array.
+ * @param c color index.
+ */
+void vga_surface_polygon(surface_t *s, vertex_t *vertices, uint16_t num_vertices, color_t c) {
+    uint16_t i;
+
+    if (num_vertices < 2) {
+        return;
+    }
+
+    for (i = 0; i < num_vertices - 1; i++) {
+        vga_surface_line(s, vertices[i].x, vertices[i].y, vertices[i + 1].x, vertices[i + 1].y, c);
+    }
+    vga_surface_line(s, vertices[0].x, vertices[0].y, vertices[num_vertices - 1].x, vertices[num_vertices - 1].y, c);
+}
+
+/**
+ * @brief draw an anti-aliased line on a surface using an intensity ramp of VGA_AA_LEVELS colors from black to the line color,
+ * e.g. one of the ramps of vga_grayscale_palette(). The line is clipped to the clipping rectangle before it is drawn.
+ *
+ * @param s the surface.
+ * @param x1 x start
+ * @param y1 y start
+ * @param x2 x end
+ * @param y2 y end
+ * @param base first (darkest) color of the ramp, base + VGA_AA_LEVELS - 1 is the line color.
+ */
+void vga_surface_aa_line(surface_t *s, int16_t x1, int16_t y1, int16_t x2, int16_t y2, color_t base) {
+    if (!vga_clip_line(s, &x1, &y1, &x2, &y2)) {
+        return;
+    }
+    if (y1 > y2) {
+        vga_wu_line(s, x2, y2, x1, y1, base);
+        vga_surface_dirty(s, x1 < x2 ? x1 : x2, y2, x1 < x2 ? x2 : x1, y1);
+    } else {
+        vga_wu_line(s, x1, y1, x2, y2, base);
+        vga_surface_dirty(s, x1 < x2 ? x1 : x2, y1, x1 < x2 ? x2 : x1, y2);
+    }
+}
+
+/**
+ * @brief draw connected anti-aliased lines onto a surface, e.g. a chart. Unlike vga_surface_polygon() the last vertex is
+ * not connected to the first. The modified area is marked once for all lines.
+ *
+ * @param s the surface.
+ * @param vertices a array of vertices.
+ * @param num_vertices number of vertices in the array.
+ * @param base first (darkest) color of the ramp, see vga_surface_aa_line().
+ */
+void vga_surface_aa_polyline(surface_t *s, vertex_t *vertices, uint16_t num_vertices, color_t base) {
+    int16_t x1, y1, x2, y2, left, top, right, bottom;
+    uint16_t i;
+
+    if (num_vertices < 2) {
+        return;
+    }
+
+    left = right = vertices[0].x;
+    top = bottom = vertices[0].y;
+    for (i = 0; i < num_vertices - 1; i++) {
+        x1 = vertices[i].x;
+        y1 = vertices[i].y;
+        x2 = vertices[i + 1].x;
+        y2 = vertices[i + 1].y;
+        if (x2 < left) {
+            left = x2;
+        }
+        if (x2 > right) {
+            right = x2;
+        }
+        if (y2 < top) {
+            top = y2;
+        }
+        if (y2 > bottom) {
+            bottom = y2;
+        }
+        if (vga_clip_line(s, &x1, &y1, &x2, &y2)) {
+            if (y1 > y2) {
+                vga_wu_line(s, x2, y2, x1, y1, base);
+            } else {
+                vga_wu_line(s, x1, y1, x2, y2, base);
+            }
+        }
+    }
+    vga_surface_dirty(s, left, top, right, bottom);
+}
+
+/**
+ * @brief flood fill an area of a surface, starting at a seed pixel and limited to the clipping rectangle.
+ * Runs of pixels are filled scanline by scanline using an explicit stack of spans. If the stack is full, further spans are
+ * remembered in a bitmap of the clipping rectangle (clip width * height / 8 bytes) which is searched when the stack is empty.
+ *
+ * @param s the surface.
+ * @param x x position of the seed pixel.
+ * @param y y position of the seed pixel.
+ * @param c fill color.
+ * @param border the color the area is bounded by if VGA_FILL_BORDER is set, ignored otherwise.
+ * @param flags VGA_FILL_BORDER to fill everything up to the border color instead of all pixels with the color of the seed pixel,
+ * VGA_FILL_8 to also spread to diagonal neighbors.
+ *
+ * @return true if the area was filled completely, false if the bitmap could not be allocated.
+ */
+bool vga_surface_flood_fill(surface_t *s, int16_t x, int16_t y, color_t c, color_t border, uint8_t flags) {
+    vga_fill_t f;
+
+    ERR_OK();
+    if (!vga_inside(s, x, y)) {
+        return true;
+    }
+
+    f.s = s;
+    f.flags = flags;
+    f.c = c;
+    f.old = vga_fill_get(s, x, y);
+    f.border = border;
+    f.pending = NULL;
+    f.pending_top = INT16_MAX;
+    f.pending_bottom = INT16_MIN;
+    f.area.left = f.area.top = INT16_MAX;
+    f.area.right = f.area.bottom = INT16_MIN;
+    f.failed = false;
+    if ((!(flags & VGA_FILL_BORDER) && (f.old == c)) || !VGA_FILLABLE(&f, f.old)) {
+        return true;  // nothing to do
+    }
+
+    vga_fill_sp = 0;
+    vga_fill_push(&f, y, x, x, 0);
+    vga_fill_drain(&f);
+    while (!f.failed && (f.pending_top <= f.pending_bottom)) {
+        vga_fill_pending(&f);
+    }
+    free(f.pending);
+
+    if (f.area.left <= f.area.right) {
+        vga_surface_dirty(s, f.area.left, f.area.top, f.area.right, f.area.bottom);
+    }
+    if (f.failed) {
+        ERR_NOMEM();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief draw a filled polygon onto a surface. Convex and concave (also self intersecting) polygons are filled using the even-odd rule.
+ * Pixels on the right and bottom edges are not filled, so polygons sharing an edge do not overlap.
+ *
+ * @param s the surface.
+ * @param vertices a array of vertices.
+ * @param num_vertices number of vertices in the array (max VGA_MAX_POLY_EDGES).
+ * @param c color index.
+ */
+void vga_surface_filled_polygon(surface_t *s, vertex_t *vertices, uint16_t num_vertices, color_t c) {
+    uint16_t i;
+    uint8_t num_edges = 0, num_active = 0, next_edge = 0, j, k, idx;
+    int16_t y, y_end, left, top, right, bottom;
+    vertex_t *v1, *v2, *temp;
+    poly_edge_t edge;
+
+    if ((num_vertices < 3) || (num_vertices > VGA_MAX_POLY_EDGES)) {
+        return;
+    }
+
+    // bounding box
+    left = right = vertices[0].x;
+    top = bottom = vertices[0].y;
+    for (i = 1; i < num_vertices; i++) {
+        if (vertices[i].x < left) {
+            left = vertices[i].x;
+        } else if (vertices[i].x > right) {
+            right = vertices[i].x;
+        }
+        if (vertices[i].y < top) {
+            top = vertices[i].y;
+        } else if (vertices[i].y > bottom) {
+            bottom = vertices[i].y;
+        }
+    }
+    if ((right < s->clip.left) || (left > s->clip.right) || (bottom < s->clip.top) || (top > s->clip.bottom)) {
+        return;  // completely outside
+    }
+
+    if (num_vertices == 3) {
+        vga_filled_triangle(s, &vertices[0], &vertices[1], &vertices[2], c);
+        vga_surface_dirty(s, left, top, right, bottom);
+        return;
+    }
+
+    // build the global edge table. horizontal edges never cross a scanline and are dropped
+    for (i = 0; i < num_vertices; i++) {
+        v1 = &vertices[i];
+        v2 = &vertices[i + 1 < num_vertices ? i + 1 : 0];
+        if (v1->y == v2->y) {
+            continue;
+        }
+        if (v1->y > v2->y) {
+            temp = v1;
+            v1 = v2;
+            v2 = temp;
+        }
+        if (v2->y <= s->clip.top) {
+            continue;  // completely above the clipping rectangle
+        }
+
+        edge.y_top = v1->y;
+        edge.y_bottom = v2->y;
+        edge.x = TO_FIXED((fixed16_16)v1->x);
+        edge.dxdy = vga_slope((int32_t)v2->x - v1->x, (int32_t)v2->y - v1->y);
+        if (edge.y_top < s->clip.top) {
+            edge.x = vga_edge_step(edge.x, edge.dxdy, (uint16_t)s->clip.top - (uint16_t)edge.y_top);
+            edge.y_top = s->clip.top;
+        }
+
+        // insertion sort by y_top
+        for (j = num_edges; (j > 0) && (vga_edges[j - 1].y_top > edge.y_top); j--) {
+            vga_edges[j] = vga_edges[j - 1];
+        }
+        vga_edges[j] = edge;
+        num_edges++;
+    }
+    if (!num_edges) {
+        return;
+    }
+
+    y_end = bottom > s->clip.bottom ? s->clip.bottom + 1 : bottom;
+    for (y = vga_edges[0].y_top; y < y_end; y++) {
+        // activate edges starting on this scanline
+        while ((next_edge < num_edges) && (vga_edges[next_edge].y_top == y)) {
+            vga_active_edges[num_active++] = next_edge++;
+        }
+
+        // drop edges ending above this scanline
+        for (j = 0; j < num_active;) {
+            if (vga_edges[vga_active_edges[j]].y_bottom <= y) {
+                vga_active_edges[j] = vga_active_edges[--num_active];
+            } else {
+                j++;
+            }
+        }
+
+        // insertion sort by x, the order only changes where edges cross
+        for (j = 1; j < num_active; j++) {
+            idx = vga_active_edges[j];
+            for (k = j; (k > 0) && (vga_edges[vga_active_edges[k - 1]].x > vga_edges[idx].x); k--) {
+                vga_active_edges[k] = vga_active_edges[k - 1];
+            }
+            vga_active_edges[k] = idx;
+        }
+
+        // fill between pairs of edges and step to the next scanline
+        for (j = 0; j + 1 < num_active; j += 2) {
+            vga_hspan(s, y, (int16_t)FROM_FIXED_CEIL(vga_edges[vga_active_edges[j]].x), (int16_t)FROM_FIXED_CEIL(vga_edges[vga_active_edges[j + 1]].x) - 1, c);
+        }
+        for (j = 0; j < num_active; j++) {
+            vga_edges[vga_active_edges[j]].x += vga_edges[vga_active_edges[j]].dxdy;
+        }
+    }
+    vga_surface_dirty(s, left, top, right, bottom);
+}
+
+/**
+ * @brief draw a rectangle (outline) on a surface.
+ *
+ * @param s the surface.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ * @param c color index.
+ */
+void vga_surface_rect(surface_t *s, int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c) {
+    int16_t temp, x1, x2, y1, y2;
+    uint16_t offset;
+
+    if (top > bottom) {
+        temp = top;
+        top = bottom;
+        bottom = temp;
+    }
+    if (left > right) {
+        temp = left;
+        left = right;
+        right = temp;
+    }
+
+    x1 = left < s->clip.left ? s->clip.left : left;
+    x2 = right > s->clip.right ? s->clip.right : right;
+    y1 = top < s->clip.top ? s->clip.top : top;
+    y2 = bottom > s->clip.bottom ? s->clip.bottom : bottom;
+    if ((x1 > x2) || (y1 > y2)) {
+        return;
+    }
+
+    // horizontal edges
+    if (top == y1) {
+        vga_surface_fill_span(s, top, x1, x2, c);
+    }
+    if (bottom == y2) {
+        vga_surface_fill_span(s, bottom, x1, x2, c);
+    }
+
+    // vertical edges
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        for (; y1 <= y2; y1++) {
+            if (left == x1) {
+                modex_put_pixel(s, left, y1, c);
+            }
+            if (right == x2) {
+                modex_put_pixel(s, right, y1, c);
+            }
+        }
+    } else {
+        for (offset = (uint16_t)y1 * s->stride; y1 <= y2; y1++, offset += s->stride) {
+            if (left == x1) {
+                s->data[offset + left] = c;
+            }
+            if (right == x2) {
+                s->data[offset + right] = c;
+            }
+        }
+    }
+    vga_surface_dirty(s, left, top, right, bottom);
+}
+
+/**
+ * @brief draw a filled rectangle on a surface.
+ *
+ * @param s the surface.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ * @param c color index.
+ */
+void vga_surface_filled_rect(surface_t *s, int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c) {
+    int16_t temp;
+    uint16_t offset, width;
+
+    if (top > bottom) {
+        temp = top;
+        top = bottom;
+        bottom = temp;
+    }
+    if (left > right) {
+        temp = left;
+        left = right;
+        right = temp;
+    }
+
+    if (left < s->clip.left) {
+        left = s->clip.left;
+    }
+    if (right > s->clip.right) {
+        right = s->clip.right;
+    }
+    if (top < s->clip.top) {
+        top = s->clip.top;
+    }
+    if (bottom > s->clip.bottom) {
+        bottom = s->clip.bottom;
+    }
+    if ((left > right) || (top > bottom)) {
+        return;
+    }
+
+    if (s->flags & VGA_SURFACE_PLANAR) {
+        for (temp = top; temp <= bottom; temp++) {
+            modex_fill_span(s, temp, left, right, c);
+        }
+    } else {
+        width = right - left + 1;
+        offset = (uint16_t)top * s->stride + left;
+        for (temp = top; temp <= bottom; temp++, offset += s->stride) {
+            span_fill(&s->data[offset], c, width);
+        }
+    }
+    vga_surface_dirty(s, left, top, right, bottom);
+}
+
+/**
+ * @brief draw a circle (outline) on a surface with the integer midpoint algorithm. Circles crossing the clipping rectangle are clipped per scanline.
+ *
+ * @param s the surface.
+ * @param x center x position.
+ * @param y center y position.
+ * @param radius radius.
+ * @param color color index.
+ */
+void vga_surface_circle(surface_t *s, int16_t x, int16_t y, uint16_t radius, color_t color) {
+    int16_t dx = 0, dy = radius, d = 1 - (int16_t)radius;
+    uint16_t dxoffset, dyoffset, offset;
+    uint8_t *buf = s->data;
+
+    if (!radius) {
+        return;
+    }
+    if ((x + (int16_t)radius < s->clip.left) || (x - (int16_t)radius > s->clip.right) || (y + (int16_t)radius < s->clip.top) || (y - (int16_t)radius > s->clip.bottom)) {
+        return;  // completely outside
+    }
+
+    if (!(s->flags & VGA_SURFACE_PLANAR) && (x - (int16_t)radius >= s->clip.left) && (x + (int16_t)radius <= s->clip.right) && (y - (int16_t)radius >= s->clip.top) && (y + (int16_t)radius <= s->clip.bottom)) {
+        // completely inside a linear surface, no clipping needed
+        offset = (uint16_t)y * s->stride + x;
+        while (dx <= dy) {
+            dxoffset = dx * s->stride;
+            dyoffset = dy * s->stride;
+            buf[offset + dy - dxoffset] = color; /* octant 0 */
+            buf[offset + dx - dyoffset] = color; /* octant 1 */
+            buf[offset - dx - dyoffset] = color; /* octant 2 */
+            buf[offset - dy - dxoffset] = color; /* octant 3 */
+            buf[offset - dy + dxoffset] = color; /* octant 4 */
+            buf[offset - dx + dyoffset] = color; /* octant 5 */
+            buf[offset + dx + dyoffset] = color; /* octant 6 */
+            buf[offset + dy + dxoffset] = color; /* octant 7 */
+            if (d < 0) {
+                d += 2 * dx + 3;
+            } else {
+                d += 2 * (dx - dy) + 5;
+                dy--;
+            }
+            dx++;
+        }
+    } else {
+        while (dx <= dy) {
+            vga_hpair(s, y - dx, x - dy, x + dy, color); /* octant 0 + 3 */
+            vga_hpair(s, y - dy, x - dx, x + dx, color); /* octant 1 + 2 */
+            vga_hpair(s, y + dx, x - dy, x + dy, color); /* octant 4 + 7 */
+            vga_hpair(s, y + dy, x - dx, x + dx, color); /* octant 5 + 6 */
+            if (d < 0) {
+                d += 2 * dx + 3;
+            } else {
+                d += 2 * (dx - dy) + 5;
+                dy--;
+            }
+            dx++;
+        }
+    }
+    vga_surface_dirty(s, x - radius, y - radius, x + radius, y + radius);
+}
+
+/**
+ * @brief draw a filled circle on a surface with the integer midpoint algorithm. The circle is drawn as horizontal spans
+ * which are clipped per scanline, every scanline is drawn once.
+ *
+ * @param s the surface.
+ * @param x center x position.
+ * @param y center y position.
  * @param radius radius.
+ * @param color color index.
+ */
+void vga_surface_filled_circle(surface_t *s, int16_t x, int16_t y, uint16_t radius, color_t color) {
+    int16_t dx = 0, dy = radius, d = 1 - (int16_t)radius;
+
+    if (!radius) {
+        return;
+    }
+    if ((x + (int16_t)radius < s->clip.left) || (x - (int16_t)radius > s->clip.right) || (y + (int16_t)radius < s->clip.top) || (y - (int16_t)radius > s->clip.bottom)) {
+        return;  // completely outside
+    }
+
+    while (dx <= dy) {
+        // the two scanlines dx above/below the center are dy wide (octants 0, 3, 4, 7)
+        vga_hspan(s, y - dx, x - dy, x + dy, color);
+        if (dx) {
+            vga_hspan(s, y + dx, x - dy, x + dy, color);
+        }
+
+        if (d < 0) {
+            d += 2 * dx + 3;
+        } else {
+            // the scanlines dy above/below the center are left behind, they are as wide as the current dx (octants 1, 2, 5, 6)
+            if (dy > dx) {
+                vga_hspan(s, y - dy, x - dx, x + dx, color);
+                vga_hspan(s, y + dy, x - dx, x + dx, color);
+            }
+            d += 2 * (dx - dy) + 5;
+            dy--;
+        }
+        dx++;
+    }
+    vga_surface_dirty(s, x - radius, y - radius, x + radius, y + radius);
+}
+
+/**
+ * @brief draw an axis aligned ellipse (outline) on a surface. The ellipse is clipped per pixel.
+ *
+ * @param s the surface.
+ * @param x center x position.
+ * @param y center y position.
+ * @param rx horizontal radius.
+ * @param ry vertical radius.
+ * @param color color index.
+ */
+void vga_surface_ellipse(surface_t *s, int16_t x, int16_t y, uint16_t rx, uint16_t ry, color_t color) {
+    if ((x + (int16_t)rx < s->clip.left) || (x - (int16_t)rx > s->clip.right) || (y + (int16_t)ry < s->clip.top) || (y - (int16_t)ry > s->clip.bottom)) {
+        return;  // completely outside
+    }
+    vga_ellipse_outline(s, x, y, rx, ry, color, NULL);
+    vga_surface_dirty(s, x - rx, y - ry, x + rx, y + ry);
+}
+
+/**
+ * @brief draw a filled axis aligned ellipse on a surface. The ellipse is drawn as horizontal spans which are clipped per scanline.
+ *
+ * @param s the surface.
+ * @param x center x position.
+ * @param y center y position.
+ * @param rx horizontal radius.
+ * @param ry vertical radius.
+ * @param color color index.
+ */
+void vga_surface_filled_ellipse(surface_t *s, int16_t x, int16_t y, uint16_t rx, uint16_t ry, color_t color) {
+    if ((x + (int16_t)rx < s->clip.left) || (x - (int16_t)rx > s->clip.right) || (y + (int16_t)ry < s->clip.top) || (y - (int16_t)ry > s->clip.bottom)) {
+        return;  // completely outside
+    }
+    vga_ellipse_fill(s, x, y, rx, ry, color);
+    vga_surface_dirty(s, x - rx, y - ry, x + rx, y + ry);
+}
+
+/**
+ * @brief draw an arc of an axis aligned ellipse on a surface. The arc runs counterclockwise (as seen on screen) from the ray through
+ * the start offset to the ray through the end offset, the offsets are relative to the center and only their direction matters.
+ * Identical directions draw the whole ellipse. Use rx == ry for circular arcs.
+ *
+ * @param s the surface.
+ * @param x center x position.
+ * @param y center y position.
+ * @param rx horizontal radius.
+ * @param ry vertical radius.
+ * @param sx x offset of a point on the start ray, e.g. 1 for 0 degrees.
+ * @param sy y offset of a point on the start ray, e.g. -1 for 90 degrees.
+ * @param ex x offset of a point on the end ray.
+ * @param ey y offset of a point on the end ray.
+ * @param color color index.
+ */
+void vga_surface_arc(surface_t *s, int16_t x, int16_t y, uint16_t rx, uint16_t ry, int16_t sx, int16_t sy, int16_t ex, int16_t ey, color_t color) {
+    vga_arc_t arc;
+
+    if ((x + (int16_t)rx < s->clip.left) || (x - (int16_t)rx > s->clip.right) || (y + (int16_t)ry < s->clip.top) || (y - (int16_t)ry > s->clip.bottom)) {
+        return;  // completely outside
+    }
+    vga_arc_init(&arc, sx, sy, ex, ey);
+    vga_ellipse_outline(s, x, y, rx, ry, color, &arc);
+    vga_surface_dirty(s, x - rx, y - ry, x + rx, y + ry);
+}
+
+/**
+ * @brief draw a pixel on screen.
+ *
+ * @param x x position.
+ * @param y y position.
  * @param c color index.
  */
-void vga_filled_circle(uint16_t x, uint16_t y, uint16_t radius, color_t color) {
-    fixed16_16 n = 0, invradius = TO_FIXED(1 / (float)radius);
-    int dx = 0, dy = radius - 1, i;
-    uint16_t dxoffset, dyoffset, offset = (y << 8) + (y << 6) + x;
+void vga_set_pixel(int16_t x, int16_t y, color_t c) { vga_surface_set_pixel(vga_screen(), x, y, c); }
 
-    while (dx <= dy) {
-        dxoffset = (dx << 8) + (dx << 6);
-        dyoffset = (dy << 8) + (dy << 6);
-        for (i = dy; i >= dx; i--, dyoffset -= VGA_SCREEN_WIDTH) {
-            VGA_MEMORY[offset + i - dxoffset] = color;  /* octant 0 */
-            VGA_MEMORY[offset + dx - dyoffset] = color; /* octant 1 */
-            VGA_MEMORY[offset - dx - dyoffset] = color; /* octant 2 */
-            VGA_MEMORY[offset - i - dxoffset] = color;  /* octant 3 */
-            VGA_MEMORY[offset - i + dxoffset] = color;  /* octant 4 */
-            VGA_MEMORY[offset - dx + dyoffset] = color; /* octant 5 */
-            VGA_MEMORY[offset + dx + dyoffset] = color; /* octant 6 */
-            VGA_MEMORY[offset + i + dxoffset] = color;  /* octant 7 */
+/**
+ * @brief get a pixel from screen.
+ *
+ * @param x x position.
+ * @param y y position.
+ *
+ * @return color index.
+ */
+color_t vga_get_pixel(int16_t x, int16_t y) { return vga_surface_get_pixel(vga_screen(), x, y); }
+
+/**
+ * @brief draw a line on screen
+ *
+ * @param x1 x start
+ * @param y1 y start
+ * @param x2 x end
+ * @param y2 y end
+ * @param c color index.
+ */
+void vga_line(int16_t x1, int16_t y1, int16_t x2, int16_t y2, color_t c) { vga_surface_line(vga_screen(), x1, y1, x2, y2, c); }
+
+/**
+ * @brief draw a polygon onto the screen.
+ *
+ * @param vertices a array of vertices.
+ * @param num_vertices number of vertices in the array.
+ * @param c color index.
+ */
+void vga_polygon(vertex_t *vertices, uint16_t num_vertices, color_t c) { vga_surface_polygon(vga_screen(), vertices, num_vertices, c); }
+
+/**
+ * @brief draw an anti-aliased line on screen, see vga_surface_aa_line().
+ *
+ * @param x1 x start
+ * @param y1 y start
+ * @param x2 x end
+ * @param y2 y end
+ * @param base first (darkest) color of the ramp.
+ */
+void vga_aa_line(int16_t x1, int16_t y1, int16_t x2, int16_t y2, color_t base) { vga_surface_aa_line(vga_screen(), x1, y1, x2, y2, base); }
+
+/**
+ * @brief draw connected anti-aliased lines on screen, see vga_surface_aa_polyline().
+ *
+ * @param vertices a array of vertices.
+ * @param num_vertices number of vertices in the array.
+ * @param base first (darkest) color of the ramp.
+ */
+void vga_aa_polyline(vertex_t *vertices, uint16_t num_vertices, color_t base) { vga_surface_aa_polyline(vga_screen(), vertices, num_vertices, base); }
+
+/**
+ * @brief draw a filled polygon onto the screen, see vga_surface_filled_polygon().
+ *
+ * @param vertices a array of vertices.
+ * @param num_vertices number of vertices in the array.
+ * @param c color index.
+ */
+void vga_filled_polygon(vertex_t *vertices, uint16_t num_vertices, color_t c) { vga_surface_filled_polygon(vga_screen(), vertices, num_vertices, c); }
+
+/**
+ * @brief flood fill an area of the screen, see vga_surface_flood_fill().
+ *
+ * @param x x position of the seed pixel.
+ * @param y y position of the seed pixel.
+ * @param c fill color.
+ * @param border the color the area is bounded by if VGA_FILL_BORDER is set, ignored otherwise.
+ * @param flags VGA_FILL_* flags.
+ *
+ * @return true if the area was filled completely, false if memory ran out.
+ */
+bool vga_flood_fill(int16_t x, int16_t y, color_t c, color_t border, uint8_t flags) { return vga_surface_flood_fill(vga_screen(), x, y, c, border, flags); }
+
+/**
+ * @brief draw a rectangle (outline).
+ *
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ * @param c color index.
+ */
+void vga_rect(int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c) { vga_surface_rect(vga_screen(), left, top, right, bottom, c); }
+
+/**
+ * @brief draw a filled rectangle.
+ *
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ * @param c color index.
+ */
+void vga_filled_rect(int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c) { vga_surface_filled_rect(vga_screen(), left, top, right, bottom, c); }
+
+/**
+ * @brief restrict all drawing on screen to a rectangle. Use vga_set_clip(0, 0, VGA_SCREEN_WIDTH - 1, VGA_SCREEN_HEIGHT - 1) to reset.
+ *
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ */
+void vga_set_clip(int16_t left, int16_t top, int16_t right, int16_t bottom) { vga_surface_set_clip(vga_screen(), left, top, right, bottom); }
+
+/**
+ * @brief hide the mouse pointer before updating the screen. restores pixels previously saved by vga_show_mouse().
+ * Does nothing if the pointer is not visible. Call vga_wait_for_retrace() before if the pointer must not flicker.
+ *
+ * @param mouse the mouse info struct from mouse_init()
+ */
+void vga_hide_mouse(mouse_t *mouse) {
+    int16_t y;
+    uint8_t *under = mouse->under;
+    surface_t *s;
+
+    if (!mouse->visible) {
+        return;
+    }
+    mouse->visible = false;
+    if (!mouse->under_width) {
+        return;  // off screen
+    }
+
+    s = vga_screen();
+    for (y = mouse->under_y; y < mouse->under_y + mouse->under_height; y++, under += mouse->under_width) {
+        vga_surface_put_span(s, mouse->under_x, y, under, mouse->under_width);
+    }
+    vga_mark_dirty(mouse->under_x, mouse->under_y, mouse->under_x + mouse->under_width - 1, mouse->under_y + mouse->under_height - 1);
+}
+
+/**
+ * @brief draw the mouse pointer over the current screen content. modified pixels are saved for restauration by vga_hide_mouse().
+ * The pointer is clipped to the screen once, the area below is saved row by row and the pointer is drawn from its runs of
+ * opaque pixels (or its compiled code if it is completely on screen). If the pointer is already visible it is only redrawn
+ * if it has moved.
+ *
+ * @param mouse the mouse info struct from mouse_init()
+ */
+void vga_show_mouse(mouse_t *mouse) {
+    int16_t mx = mouse->x - mouse->cursor.x;
+    int16_t my = mouse->y - mouse->cursor.y;
+    int16_t x, y, x1, y1, x2, y2, left, right;
+    const uint8_t *rle = mouse->rle;
+    uint8_t *under = mouse->under;
+    uint8_t skip, len;
+    rect_t clip;
+    surface_t *s = vga_screen();
+
+    if (mouse->visible) {
+        if ((mx == mouse->shown_x) && (my == mouse->shown_y)) {
+            return;
+        }
+        vga_hide_mouse(mouse);
+    }
+    mouse->visible = true;
+    mouse->shown_x = mx;
+    mouse->shown_y = my;
+
+    // clip to the screen
+    x1 = mx < 0 ? 0 : mx;
+    y1 = my < 0 ? 0 : my;
+    x2 = mx + MOUSE_CURSOR_WIDTH - 1;
+    y2 = my + MOUSE_CURSOR_HEIGHT - 1;
+    if (x2 >= (int16_t)s->width) {
+        x2 = s->width - 1;
+    }
+    if (y2 >= (int16_t)s->height) {
+        y2 = s->height - 1;
+    }
+    if ((x1 > x2) || (y1 > y2)) {
+        mouse->under_width = 0;
+        return;
+    }
+    mouse->under_x = x1;
+    mouse->under_y = y1;
+    mouse->under_width = x2 - x1 + 1;
+    mouse->under_height = y2 - y1 + 1;
+
+    // save the area below
+    for (y = y1; y <= y2; y++, under += mouse->under_width) {
+        if (s->flags & VGA_SURFACE_PLANAR) {
+            for (x = x1; x <= x2; x++) {
+                under[x - x1] = modex_get_pixel(s, x, y);
+            }
+        } else {
+            span_copy(under, &s->data[(uint16_t)y * s->stride + x1], mouse->under_width);
+        }
+    }
+
+    if (mouse->compiled && (mouse->under_width == MOUSE_CURSOR_WIDTH) && (mouse->under_height == MOUSE_CURSOR_HEIGHT)) {
+        // the cursor ignores the clipping rectangle
+        clip = s->clip;
+        vga_surface_set_clip(s, 0, 0, s->width - 1, s->height - 1);
+        csprite_surface_draw(s, mouse->compiled, mx, my);
+        s->clip = clip;
+    } else {
+        for (y = my; y <= y2; y++) {
+            x = mx;
+            while ((skip = *rle++) != MOUSE_RLE_END) {
+                x += skip;
+                len = *rle++;
+                if (y >= y1) {
+                    left = x < x1 ? x1 : x;
+                    right = x + len - 1 > x2 ? x2 : x + len - 1;
+                    if (left <= right) {
+                        vga_surface_put_span(s, left, y, rle + (left - x), right - left + 1);
+                    }
+                }
+                rle += len;
+                x += len;
+            }
         }
-        dx++;
-        n += invradius;
-        dy = (int)((radius * SIN_ACOS[(int)(n >> 6)]) >> 16);
     }
+    vga_mark_dirty(x1, y1, x2, y2);
+}
+
+/**
+ * @brief draw a circle (outline).
+ *
+ * @param x center x position.
+ * @param y center y position.
+ * @param radius radius.
+ * @param c color index.
+ */
+void vga_circle(int16_t x, int16_t y, uint16_t radius, color_t color) { vga_surface_circle(vga_screen(), x, y, radius, color); }
+
+/**
+ * @brief draw a filled circle.
+ *
+ * @param x center x position.
+ * @param y center y position.
+ * @param radius radius.
+ * @param c color index.
+ */
+void vga_filled_circle(int16_t x, int16_t y, uint16_t radius, color_t color) { vga_surface_filled_circle(vga_screen(), x, y, radius, color); }
+
+/**
+ * @brief draw an axis aligned ellipse (outline) on screen.
+ *
+ * @param x center x position.
+ * @param y center y position.
+ * @param rx horizontal radius.
+ * @param ry vertical radius.
+ * @param color color index.
+ */
+void vga_ellipse(int16_t x, int16_t y, uint16_t rx, uint16_t ry, color_t color) { vga_surface_ellipse(vga_screen(), x, y, rx, ry, color); }
+
+/**
+ * @brief draw a filled axis aligned ellipse on screen.
+ *
+ * @param x center x position.
+ * @param y center y position.
+ * @param rx horizontal radius.
+ * @param ry vertical radius.
+ * @param color color index.
+ */
+void vga_filled_ellipse(int16_t x, int16_t y, uint16_t rx, uint16_t ry, color_t color) { vga_surface_filled_ellipse(vga_screen(), x, y, rx, ry, color); }
+
+/**
+ * @brief draw an arc of an axis aligned ellipse on screen, see vga_surface_arc().
+ *
+ * @param x center x position.
+ * @param y center y position.
+ * @param rx horizontal radius.
+ * @param ry vertical radius.
+ * @param sx x offset of a point on the start ray.
+ * @param sy y offset of a point on the start ray.
+ * @param ex x offset of a point on the end ray.
+ * @param ey y offset of a point on the end ray.
+ * @param color color index.
+ */
+void vga_arc(int16_t x, int16_t y, uint16_t rx, uint16_t ry, int16_t sx, int16_t sy, int16_t ex, int16_t ey, color_t color) {
+    vga_surface_arc(vga_screen(), x, y, rx, ry, sx, sy, ex, ey, color);
 }
 
 /**
@@ -539,3 +2328,160 @@ void vga_wait_for_retrace(void) {
         ;
     }
 }
+
+/**
+ * @brief mark an area of the back buffer as modified so vga_present() copies it to VGA memory.
+ * Overlapping or adjacent areas are merged. This is a NOP if no back buffer is active.
+ *
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ */
+void vga_mark_dirty(int16_t left, int16_t top, int16_t right, int16_t bottom) {
+    rect_t r;
+    uint8_t i, best;
+    uint32_t area, best_area;
+    int16_t temp;
+
+    if (!vga_back_buffer) {
+        return;
+    }
+
+    if (top > bottom) {
+        temp = top;
+        top = bottom;
+        bottom = temp;
+    }
+    if (left > right) {
+        temp = left;
+        left = right;
+        right = temp;
+    }
+
+    // clamp to screen, everything outside is never copied
+    if ((right < 0) || (bottom < 0) || (left >= VGA_SCREEN_WIDTH) || (top >= VGA_SCREEN_HEIGHT)) {
+        return;
+    }
+    r.left = left < 0 ? 0 : left;
+    r.top = top < 0 ? 0 : top;
+    r.right = right >= VGA_SCREEN_WIDTH ? VGA_SCREEN_WIDTH - 1 : right;
+    r.bottom = bottom >= VGA_SCREEN_HEIGHT ? VGA_SCREEN_HEIGHT - 1 : bottom;
+
+    // merge with every rectangle it touches. a merge can make the result touch other rectangles, so start over after each one
+    i = 0;
+    while (i < vga_num_dirty) {
+        if (vga_touches(&vga_dirty[i], &r)) {
+            vga_union(&r, &vga_dirty[i]);
+            vga_dirty[i] = vga_dirty[--vga_num_dirty];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+
+    // list is full: merge with the rectangle that grows the least
+    if (vga_num_dirty >= VGA_MAX_DIRTY) {
+        best = 0;
+        best_area = 0xFFFFFFFFUL;
+        for (i = 0; i < vga_num_dirty; i++) {
+            area = vga_union_area(&vga_dirty[i], &r);
+            if (area < best_area) {
+                best_area = area;
+                best = i;
+            }
+        }
+        vga_union(&vga_dirty[best], &r);
+        return;
+    }
+
+    vga_dirty[vga_num_dirty++] = r;
+}
+
+/**
+ * @brief get the areas of the back buffer that were modified since the last vga_present().
+ *
+ * @param rects receives a pointer to the areas, valid until the next drawing function is called.
+ *
+ * @return number of areas, 0 if nothing was modified or there is no back buffer.
+ */
+uint8_t vga_get_dirty(const rect_t **rects) {
+    *rects = vga_dirty;
+    return vga_back_buffer ? vga_num_dirty : 0;
+}
+
+/**
+ * @brief start drawing a new frame into the off-screen back buffer. The back buffer is allocated on the first call
+ * and initialized with the current screen content. All drawing functions write to the back buffer until vga_release_back_buffer() is called.
+ * In the unchained modes no back buffer is needed, drawing always goes to the hidden draw page.
+ *
+ * @return true if the back buffer is active, false if out of memory.
+ */
+bool vga_begin_frame(void) {
+    if (modex_height) {
+        // the unchained modes draw to a hidden page, see vga_present()
+        ERR_OK();
+        return true;
+    }
+    if (!vga_back_buffer) {
+        vga_back_buffer = malloc(VGA_SCREEN_SIZE);
+        if (!vga_back_buffer) {
+            ERR_NOMEM();
+            return false;
+        }
+        memcpy(vga_back_buffer, VGA_MEMORY, VGA_SCREEN_SIZE);
+        vga_num_dirty = 0;
+    }
+    ERR_OK();
+    return true;
+}
+
+/**
+ * @brief copy all areas modified since the last call from the back buffer to VGA memory.
+ * The copy starts right after the beginning of the vertical retrace. Retrace is not waited for when VGA mode is not active,
+ * e.g. when VGA_MEMORY points to plain RAM. In the unchained modes the draw page is displayed with modex_flip().
+ */
+void vga_present(void) {
+    uint8_t i;
+    int16_t y;
+    uint16_t offset, width;
+
+    if (modex_height) {
+        modex_flip();
+        return;
+    }
+    if (!vga_back_buffer || !vga_num_dirty) {
+        return;
+    }
+
+    if (vga_active) {
+        vga_wait_for_retrace();
+    }
+
+    for (i = 0; i < vga_num_dirty; i++) {
+        offset = (uint16_t)vga_dirty[i].top * VGA_SCREEN_WIDTH + vga_dirty[i].left;
+        width = vga_dirty[i].right - vga_dirty[i].left + 1;
+
+        if (width == VGA_SCREEN_WIDTH) {
+            // full scanlines are contiguous
+            span_copy(&VGA_MEMORY[offset], &vga_back_buffer[offset], (uint16_t)(vga_dirty[i].bottom - vga_dirty[i].top + 1) * VGA_SCREEN_WIDTH);
+        } else {
+            for (y = vga_dirty[i].top; y <= vga_dirty[i].bottom; y++, offset += VGA_SCREEN_WIDTH) {
+                span_copy(&VGA_MEMORY[offset], &vga_back_buffer[offset], width);
+            }
+        }
+    }
+    vga_num_dirty = 0;
+}
+
+/**
+ * @brief copy pending changes to VGA memory, free the back buffer and continue drawing directly to VGA memory.
+ */
+void vga_release_back_buffer(void) {
+    if (vga_back_buffer) {
+        vga_present();
+        free(vga_back_buffer);
+        vga_back_buffer = NULL;
+        vga_num_dirty = 0;
+    }
+}
@@ -22,6 +22,19 @@
 #define VGA_MAX_COLORS 256     //!< max number of colors
 #define VGA_SCREEN_WIDTH 320   //< screen width
 #define VGA_SCREEN_HEIGHT 200  //!< screen height
+#define VGA_SCREEN_SIZE ((uint16_t)VGA_SCREEN_WIDTH * VGA_SCREEN_HEIGHT)  //!< number of bytes in VGA memory
+
+#define VGA_MAX_DIRTY 16  //!< max number of dirty rectangles tracked between two calls to vga_present()
+
+#define VGA_SURFACE_PLANAR 0x01  //!< surface flag: pixels are stored in four planes (Mode X), see modex.h
+
+#define VGA_AA_LEVELS 64  //!< number of colors in an intensity ramp for the anti-aliased lines
+
+#define VGA_FILL_8 0x01       //!< flood fill flag: spread to diagonal neighbors too
+#define VGA_FILL_BORDER 0x02  //!< flood fill flag: fill up to a border color instead of replacing the color of the seed pixel
+
+//! memory all drawing functions write to: the back buffer between vga_begin_frame() and vga_release_back_buffer(), else VGA_MEMORY
+#define VGA_BUFFER (vga_back_buffer ? vga_back_buffer : VGA_MEMORY)
 
 /* ======================================================================
 ** typedefs
@@ -35,17 +48,37 @@ typedef struct __color {
 
 //! a vertex for a polygon
 typedef struct __vertex {
-    uint16_t x;  //!< x coordinate
-    uint16_t y;  //!< y coordinate
+    int16_t x;  //!< x coordinate
+    int16_t y;  //!< y coordinate
 } vertex_t;
 
 //! color index into the palette
 typedef uint8_t color_t;
 
+//! a rectangle (all coordinates inclusive)
+typedef struct __rect {
+    int16_t left;    //!< x start
+    int16_t top;     //!< y start
+    int16_t right;   //!< x end
+    int16_t bottom;  //!< y end
+} rect_t;
+
+//! a render target for the drawing functions, e.g. the screen or a bitmap_t
+typedef struct __surface {
+    uint8_t *data;    //!< pointer to the first pixel
+    uint16_t stride;  //!< number of bytes from one scanline to the next
+    uint16_t width;   //!< width in pixels
+    uint16_t height;  //!< height in pixels
+    rect_t clip;      //!< drawing is restricted to this area
+    uint8_t flags;    //!< VGA_SURFACE_* flags
+} surface_t;
+
 /* ======================================================================
 ** prototypes
 ** ====================================================================== */
 extern uint8_t *VGA_MEMORY;
+extern uint8_t *vga_back_buffer;
+extern uint16_t vga_palette_changes;
 
 extern bool vga_init(void);
 extern void vga_exit(void);
@@ -54,16 +87,51 @@ extern void vga_set_color(uint16_t idx, palette_color_t *col);
 extern void vga_get_palette(palette_color_t *palette, uint16_t size);
 extern void vga_get_color(uint16_t idx, palette_color_t *c);
 extern void vga_grayscale_palette();
-extern void vga_set_pixel(uint16_t x, uint16_t y, color_t c);
-extern color_t vga_get_pixel(uint16_t x, uint16_t y);
-extern void vga_line(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, color_t c);
+extern void vga_set_pixel(int16_t x, int16_t y, color_t c);
+extern color_t vga_get_pixel(int16_t x, int16_t y);
+extern void vga_line(int16_t x1, int16_t y1, int16_t x2, int16_t y2, color_t c);
 extern void vga_polygon(vertex_t *vertices, uint16_t num_vertices, color_t c);
-extern void vga_rect(uint16_t left, uint16_t top, uint16_t right, uint16_t bottom, color_t c);
-extern void vga_filled_rect(uint16_t left, uint16_t top, uint16_t right, uint16_t bottom, color_t c);
+extern void vga_aa_line(int16_t x1, int16_t y1, int16_t x2, int16_t y2, color_t base);
+extern void vga_aa_polyline(vertex_t *vertices, uint16_t num_vertices, color_t base);
+extern void vga_filled_polygon(vertex_t *vertices, uint16_t num_vertices, color_t c);
+extern bool vga_flood_fill(int16_t x, int16_t y, color_t c, color_t border, uint8_t flags);
+extern void vga_rect(int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c);
+extern void vga_filled_rect(int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c);
+extern void vga_set_clip(int16_t left, int16_t top, int16_t right, int16_t bottom);
 extern void vga_hide_mouse(mouse_t *mouse);
 extern void vga_show_mouse(mouse_t *mouse);
-extern void vga_circle(uint16_t x, uint16_t y, uint16_t radius, color_t color);
-extern void vga_filled_circle(uint16_t x, uint16_t y, uint16_t radius, color_t color);
+extern void vga_circle(int16_t x, int16_t y, uint16_t radius, color_t color);
+extern void vga_filled_circle(int16_t x, int16_t y, uint16_t radius, color_t color);
+extern void vga_ellipse(int16_t x, int16_t y, uint16_t rx, uint16_t ry, color_t color);
+extern void vga_filled_ellipse(int16_t x, int16_t y, uint16_t rx, uint16_t ry, color_t color);
+extern void vga_arc(int16_t x, int16_t y, uint16_t rx, uint16_t ry, int16_t sx, int16_t sy, int16_t ex, int16_t ey, color_t color);
 extern void vga_wait_for_retrace(void);
+extern bool vga_begin_frame(void);
+extern void vga_present(void);
+extern void vga_release_back_buffer(void);
+extern void vga_mark_dirty(int16_t left, int16_t top, int16_t right, int16_t bottom);
+extern uint8_t vga_get_dirty(const rect_t **rects);
+extern surface_t *vga_screen(void);
+extern void vga_surface_dirty(surface_t *s, int16_t left, int16_t top, int16_t right, int16_t bottom);
+extern void vga_surface_init(surface_t *s, uint8_t *data, uint16_t stride, uint16_t width, uint16_t height);
+extern void vga_surface_set_clip(surface_t *s, int16_t left, int16_t top, int16_t right, int16_t bottom);
+extern void vga_surface_put_pixel(surface_t *s, int16_t x, int16_t y, color_t c);
+extern void vga_surface_put_span(surface_t *s, int16_t x, int16_t y, const uint8_t *src, uint16_t len);
+extern void vga_surface_fill_span(surface_t *s, int16_t y, int16_t x1, int16_t x2, color_t c);
+extern void vga_surface_set_pixel(surface_t *s, int16_t x, int16_t y, color_t c);
+extern color_t vga_surface_get_pixel(surface_t *s, int16_t x, int16_t y);
+extern void vga_surface_line(surface_t *s, int16_t x1, int16_t y1, int16_t x2, int16_t y2, color_t c);
+extern void vga_surface_polygon(surface_t *s, vertex_t *vertices, uint16_t num_vertices, color_t c);
+extern void vga_surface_aa_line(surface_t *s, int16_t x1, int16_t y1, int16_t x2, int16_t y2, color_t base);
+extern void vga_surface_aa_polyline(surface_t *s, vertex_t *vertices, uint16_t num_vertices, color_t base);
+extern void vga_surface_filled_polygon(surface_t *s, vertex_t *vertices, uint16_t num_vertices, color_t c);
+extern bool vga_surface_flood_fill(surface_t *s, int16_t x, int16_t y, color_t c, color_t border, uint8_t flags);
+extern void vga_surface_rect(surface_t *s, int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c);
+extern void vga_surface_filled_rect(surface_t *s, int16_t left, int16_t top, int16_t right, int16_t bottom, color_t c);
+extern void vga_surface_circle(surface_t *s, int16_t x, int16_t y, uint16_t radius, color_t color);
+extern void vga_surface_filled_circle(surface_t *s, int16_t x, int16_t y, uint16_t radius, color_t color);
+extern void vga_surface_ellipse(surface_t *s, int16_t x, int16_t y, uint16_t rx, uint16_t ry, color_t color);
+extern void vga_surface_filled_ellipse(surface_t *s, int16_t x, int16_t y, uint16_t rx, uint16_t ry, color_t color);
+extern void vga_surface_arc(surface_t *s, int16_t x, int16_t y, uint16_t rx, uint16_t ry, int16_t sx, int16_t sy, int16_t ex, int16_t ey, color_t color);
 
 #endif  // __VGA_H_
@@ -2,7 +2,9 @@
 #include <stdlib.h>
 #include <dos.h>
 #include <stdio.h>
+#include <string.h>
 #include <strings.h>
+#include <time.h>
 
 #include "lib16.h"
 
@@ -48,6 +50,638 @@ void hexdump(uint8_t *data, uint16_t len) {
     printf("\n\n");
 }
 
+/**
+ * @brief check that a scanline of a filled ellipse centered on x = 100 is a single span that ends on the ellipse.
+ *
+ * @param row the scanline, 200 pixels.
+ * @param dy distance of the scanline from the center.
+ * @param rx horizontal radius.
+ * @param ry vertical radius.
+ *
+ * @return true if the scanline is correct.
+ */
+bool check_ellipse_row(uint8_t *row, int dy, int rx, int ry) {
+    int x, runs = 0, left = 0, right = 0;
+    float fy, fx;
+
+    for (x = 0; x < 200; x++) {
+        if (row[x] && (!x || !row[x - 1])) {
+            runs++;
+            left = x;
+        }
+        if (row[x]) {
+            right = x;
+        }
+    }
+    if (dy < 0) {
+        dy = -dy;
+    }
+    if (dy > ry) {
+        return !runs;
+    }
+    if ((runs != 1) || ((left + right != 200) && left && (right < 199))) {
+        return false;
+    }
+
+    // the last pixel must touch the ellipse, the next one must be outside of it
+    fy = (float)(dy ? dy - 1 : 0) / ry;
+    fx = (float)(right > 100 ? right - 101 : 0) / rx;
+    if (fx * fx + fy * fy > 1) {
+        return false;
+    }
+    fy = (float)(dy + 1) / ry;
+    fx = (float)(right - 98) / rx;
+    return (right == 199) || (fx * fx + fy * fy >= 1);
+}
+
+/**
+ * @brief draw filled ellipses into memory and check that every scanline between top and bottom holds exactly one span,
+ * centered on the ellipse and ending on its edge. All radius pairs 1..89 are drawn completely. Pairs of large radii,
+ * where the error terms need more than 32 bits, are drawn with the top of the ellipse on the bitmap.
+ *
+ * @return number of radius pairs with a missing, split or misplaced scanline.
+ */
+uint16_t check_ellipses(void) {
+    static const int radii[] = {100, 400, 900, 1300, 5000, 20000, 32000};
+    int rx, ry, i, j, y;
+    uint16_t bad = 0;
+    bitmap_t *bm;
+    surface_t s;
+
+    bm = bitmap_create(200, 200, 0);
+    if (!bm) {
+        return 0;
+    }
+    bitmap_get_surface(bm, &s);
+    for (rx = 1; rx < 90; rx++) {
+        for (ry = 1; ry < 90; ry++) {
+            memset(bm->data, 0, 200 * 200);
+            vga_surface_filled_ellipse(&s, 100, 100, rx, ry, 1);
+            for (y = 0; y < 200; y++) {
+                if (!check_ellipse_row(&bm->data[y * 200], y - 100, rx, ry)) {
+                    bad++;
+                    break;
+                }
+            }
+        }
+    }
+    for (i = 0; i < 7; i++) {
+        for (j = 0; j < 7; j++) {
+            rx = radii[i];
+            ry = radii[j];
+            memset(bm->data, 0, 200 * 200);
+            vga_surface_filled_ellipse(&s, 100, 10 + ry, rx, ry, 1);
+            for (y = 0; y < 200; y++) {
+                if (!check_ellipse_row(&bm->data[y * 200], 10 + ry - y, rx, ry)) {
+                    bad++;
+                    break;
+                }
+            }
+        }
+    }
+    bitmap_free(bm);
+    return bad;
+}
+
+/**
+ * @brief save a bitmap with runs, single pixels and an odd width as PCX and load it again. Also load a hand made
+ * 4x1 PCX with an empty run (0xC0) in the middle of the data.
+ *
+ * @return number of wrong pixels, 0xFFFF if a file could not be written or read.
+ */
+uint16_t check_pcx(void) {
+    static const uint8_t empty_run[] = {0x01, 0xC0, 0x05, 0xC3, 0x07};
+    static const uint8_t expected[] = {1, 7, 7, 7};
+    uint8_t header[128];
+    uint16_t i, bad = 0;
+    bitmap_t *bm, *loaded;
+    FILE *f;
+
+    bm = bitmap_create(37, 5, VGA_MAX_COLORS);
+    if (!bm) {
+        return 0xFFFF;
+    }
+    for (i = 0; i < 37 * 5; i++) {
+        bm->data[i] = (i % 11 < 4) ? 0xC5 : i * 7;
+    }
+    loaded = bitmap_save_pcx(bm, "CHECK.PCX") ? bitmap_load_pcx("CHECK.PCX", true) : NULL;
+    if (loaded && (loaded->width == bm->width) && (loaded->height == bm->height)) {
+        for (i = 0; i < 37 * 5; i++) {
+            bad += loaded->data[i] != bm->data[i];
+        }
+    } else {
+        bad = 0xFFFF;
+    }
+    bitmap_free(loaded);
+    bitmap_free(bm);
+    if (bad == 0xFFFF) {
+        remove("CHECK.PCX");
+        return bad;
+    }
+
+    // version 5, RLE, 8 bits, xmax 3, one plane, 4 bytes per line
+    memset(header, 0, sizeof(header));
+    header[0] = 0x0A;
+    header[1] = 5;
+    header[2] = 1;
+    header[3] = 8;
+    header[8] = 3;
+    header[65] = 1;
+    header[66] = 4;
+    f = fopen("CHECK.PCX", "wb");
+    if (f) {
+        fwrite(header, sizeof(header), 1, f);
+        fwrite(empty_run, sizeof(empty_run), 1, f);
+        fclose(f);
+    }
+    loaded = bitmap_load_pcx("CHECK.PCX", false);
+    if (loaded && (loaded->width == 4) && (loaded->height == 1)) {
+        for (i = 0; i < 4; i++) {
+            bad += loaded->data[i] != expected[i];
+        }
+    } else {
+        bad = 0xFFFF;
+    }
+    bitmap_free(loaded);
+    remove("CHECK.PCX");
+    return bad;
+}
+
+/**
+ * @brief measure the pixel throughput of the span based drawing functions. The same areas are also drawn the way
+ * they were drawn before the span kernels (memset()/memcpy() per row, byte loops for circles) as a baseline.
+ *
+ * @param rect receives Mpixel/s of vga_filled_rect()
+ * @param circle receives Mpixel/s of vga_filled_circle()
+ * @param blit receives Mpixel/s of bitmap_draw()
+ * @param rect_base receives Mpixel/s of memset() per row
+ * @param circle_base receives Mpixel/s of byte loops per row
+ * @param blit_base receives Mpixel/s of memcpy() per row
+ */
+void benchmark(float *rect, float *circle, float *blit, float *rect_base, float *circle_base, float *blit_base) {
+    int i, x, y;
+    int half[60];
+    clock_t start;
+    bitmap_t *bm;
+    uint8_t *screen = vga_screen()->data, *dst;
+
+    start = clock();
+    for (i = 0; i < 500; i++) {
+        vga_filled_rect(i & 15, i & 7, 100 + (i & 15), 99 + (i & 7), i);
+    }
+    *rect = 500.0f * 100 * 100 / ((float)(clock() - start) / CLOCKS_PER_SEC) / 1000000.0f;
+
+    start = clock();
+    for (i = 0; i < 500; i++) {
+        dst = &screen[(i & 7) * VGA_SCREEN_WIDTH + (i & 15)];
+        for (y = 0; y < 100; y++, dst += VGA_SCREEN_WIDTH) {
+            memset(dst, i, 101);
+        }
+    }
+    *rect_base = 500.0f * 100 * 100 / ((float)(clock() - start) / CLOCKS_PER_SEC) / 1000000.0f;
+
+    start = clock();
+    for (i = 0; i < 500; i++) {
+        vga_filled_circle(100 + (i & 7), 100, 60, i);
+    }
+    *circle = 500.0f * 3.14159f * 60 * 60 / ((float)(clock() - start) / CLOCKS_PER_SEC) / 1000000.0f;
+
+    // half width of every scanline of the circle
+    for (y = 0; y < 60; y++) {
+        for (x = 60; (long)x * x + (long)y * y > 60L * 60; x--) {
+        }
+        half[y] = x;
+    }
+    start = clock();
+    for (i = 0; i < 500; i++) {
+        for (y = -59; y < 60; y++) {
+            dst = &screen[(100 + y) * VGA_SCREEN_WIDTH + 100 + (i & 7)];
+            for (x = -half[y < 0 ? -y : y]; x <= half[y < 0 ? -y : y]; x++) {
+                dst[x] = i;
+            }
+        }
+    }
+    *circle_base = 500.0f * 3.14159f * 60 * 60 / ((float)(clock() - start) / CLOCKS_PER_SEC) / 1000000.0f;
+
+    *blit = *blit_base = 0;
+    bm = bitmap_create(100, 100, 0);
+    if (bm) {
+        start = clock();
+        for (i = 0; i < 500; i++) {
+            bitmap_draw(bm, 3 + (i & 15), 5, false);
+        }
+        *blit = 500.0f * 100 * 100 / ((float)(clock() - start) / CLOCKS_PER_SEC) / 1000000.0f;
+
+        start = clock();
+        for (i = 0; i < 500; i++) {
+            dst = &screen[5 * VGA_SCREEN_WIDTH + 3 + (i & 15)];
+            for (y = 0; y < 100; y++, dst += VGA_SCREEN_WIDTH) {
+                memcpy(dst, &bm->data[y * 100], 100);
+            }
+        }
+        *blit_base = 500.0f * 100 * 100 / ((float)(clock() - start) / CLOCKS_PER_SEC) / 1000000.0f;
+        bitmap_free(bm);
+    }
+}
+
+/**
+ * @brief measure the scanline polygon fill against stacking one vga_surface_line() per scanline for the same 290x180 triangle.
+ *
+ * @param s the surface to draw on.
+ * @param filled receives triangles/s of vga_surface_filled_polygon().
+ * @param lines receives triangles/s with vga_surface_line().
+ */
+void benchmark_polygon(surface_t *s, float *filled, float *lines) {
+    int i, y;
+    float secs;
+    clock_t start;
+    vertex_t v[3] = {{10, 10}, {300, 10}, {10, 190}};
+
+    *filled = *lines = 0;
+    start = clock();
+    for (i = 0; i < 200; i++) {
+        vga_surface_filled_polygon(s, v, 3, i);
+    }
+    secs = (float)(clock() - start) / CLOCKS_PER_SEC;
+    if (secs > 0) {
+        *filled = 200 / secs;
+    }
+
+    start = clock();
+    for (i = 0; i < 200; i++) {
+        for (y = 10; y < 190; y++) {
+            vga_surface_line(s, 10, y, 300 - (int)(290L * (y - 10) / 180) - 1, y, i);
+        }
+    }
+    secs = (float)(clock() - start) / CLOCKS_PER_SEC;
+    if (secs > 0) {
+        *lines = 200 / secs;
+    }
+}
+
+/**
+ * @brief scroll callback for benchmark_scroll(), draws a world of 16x16 tiles.
+ *
+ * @param s surface in world coordinates, clipped to the area.
+ * @param left x start
+ * @param top y start
+ * @param right x end
+ * @param bottom y end
+ */
+void scroll_tiles(surface_t *s, int16_t left, int16_t top, int16_t right, int16_t bottom) {
+    int16_t x, y;
+
+    for (y = top & ~15; y <= bottom; y += 16) {
+        for (x = left & ~15; x <= right; x += 16) {
+            vga_surface_filled_rect(s, x, y, x + 15, y + 15, 32 + (((x >> 4) ^ (y >> 4)) & 15));
+        }
+    }
+}
+
+/**
+ * @brief scroll a tile world in 320x240 Mode X with the CRTC start address and pel panning, one pixel per step.
+ * Switches to Mode X and leaves it active.
+ *
+ * @param right receives the average pixels drawn by the callback for a one pixel step right.
+ * @param down receives the average pixels drawn by the callback for a one pixel step down.
+ * @param steps receives steps/s, each step waits for the vertical retrace.
+ */
+void benchmark_scroll(uint32_t *right, uint32_t *down, float *steps) {
+    int i;
+    float secs;
+    clock_t start;
+
+    *right = *down = 0;
+    *steps = 0;
+    if (!modex_init(MODEX_HEIGHT_240) || !scroll_init(scroll_tiles, 0, 0)) {
+        return;
+    }
+
+    start = clock();
+    for (i = 0; i < 100; i++) {
+        scroll_by(1, 0);
+        *right += scroll_last_drawn;
+    }
+    for (i = 0; i < 100; i++) {
+        scroll_by(0, 1);
+        *down += scroll_last_drawn;
+    }
+    secs = (float)(clock() - start) / CLOCKS_PER_SEC;
+    if (secs > 0) {
+        *steps = 200 / secs;
+    }
+    *right /= 100;
+    *down /= 100;
+
+    scroll_exit();
+    modex_exit();
+}
+
+/**
+ * @brief measure how many tiles a tile map draws per frame with and without incremental redraw.
+ *
+ * @param full receives the tiles drawn for the first frame.
+ * @param animated receives the average tiles drawn per frame with one animated tile and one changed cell per frame.
+ */
+void benchmark_tilemap(uint16_t *full, float *animated) {
+    int i, x, y;
+    uint32_t total = 0;
+    bitmap_t *tiles;
+    tilemap_t *tm;
+
+    *full = 0;
+    *animated = 0;
+    tiles = bitmap_create(16 * 8, 16, 0);
+    if (!tiles) {
+        return;
+    }
+    for (i = 0; i < tiles->width * tiles->height; i++) {
+        tiles->data[i] = 32 + (i & 15) + (i % tiles->width) / 16;
+    }
+    tm = tilemap_create(tiles, 16, 16, 64, 64);
+    if (tm) {
+        for (y = 0; y < tm->height; y++) {
+            for (x = 0; x < tm->width; x++) {
+                tilemap_set(tm, x, y, (x + y) & 3);
+            }
+        }
+        tilemap_set(tm, 5, 5, 4);
+        tilemap_add_anim(tm, 4, 4, 1);
+        *full = tilemap_draw(tm, vga_screen());
+        for (i = 0; i < 100; i++) {
+            tilemap_animate(tm);
+            tilemap_set(tm, i % 20, 10, i & 3);
+            total += tilemap_draw(tm, vga_screen());
+        }
+        *animated = total / 100.0f;
+        tilemap_free(tm);
+    }
+    bitmap_free(tiles);
+}
+
+/**
+ * @brief measure textured triangle throughput on a surface.
+ *
+ * @param s the surface to draw on.
+ * @param tris receives triangles/s.
+ * @param pixels receives pixels/s.
+ */
+void benchmark_texture(surface_t *s, float *tris, float *pixels) {
+    int i;
+    float secs;
+    clock_t start;
+    bitmap_t *bm;
+    texture_t tex;
+    tex_vertex_t v[4] = {
+        {20, 10, 0, 0, TO_FIXED(1L)},                            // top left
+        {180, 30, TO_FIXED(63L), 0, TO_FIXED(2L)},               // top right
+        {170, 170, TO_FIXED(63L), TO_FIXED(63L), TO_FIXED(2L)},  // bottom right
+        {30, 190, 0, TO_FIXED(63L), TO_FIXED(1L)},               // bottom left
+    };
+
+    *tris = 0;
+    *pixels = 0;
+    bm = bitmap_create(64, 64, 0);
+    if (!bm) {
+        return;
+    }
+    for (i = 0; i < 64 * 64; i++) {
+        bm->data[i] = 32 + ((i ^ (i >> 6)) & 15);
+    }
+    tex_init(&tex, bm);
+    tex_set_perspective(&tex, true);
+
+    tex_pixels = 0;
+    start = clock();
+    for (i = 0; i < 100; i++) {
+        v[0].x = 20 + (i & 15);
+        tex_surface_quad(s, &tex, v);
+    }
+    secs = (float)(clock() - start) / CLOCKS_PER_SEC;
+    if (secs > 0) {
+        *tris = 200 / secs;
+        *pixels = tex_pixels / secs;
+    }
+    bitmap_free(bm);
+}
+
+/**
+ * @brief measure how often a chart with 300 anti-aliased segments can be drawn.
+ *
+ * @param charts receives charts/s.
+ */
+void benchmark_chart(float *charts) {
+    int i, j;
+    float secs;
+    clock_t start;
+    vertex_t v[301];
+
+    for (i = 0; i < 301; i++) {
+        v[i].x = 10 + i;
+        v[i].y = 100 + ((i * 37) % 61) - 30;
+    }
+    *charts = 0;
+    start = clock();
+    for (i = 0; i < 50; i++) {
+        for (j = 0; j < 301; j++) {
+            v[j].y ^= 1;
+        }
+        vga_aa_polyline(v, 301, 64 * (i & 3));
+    }
+    secs = (float)(clock() - start) / CLOCKS_PER_SEC;
+    if (secs > 0) {
+        *charts = 50 / secs;
+    }
+}
+
+/**
+ * @brief measure how often the whole screen can be flood filled, alternating between two colors.
+ *
+ * @param fills receives full screen fills/s.
+ */
+void benchmark_fill(float *fills) {
+    int i;
+    float secs;
+    clock_t start;
+
+    *fills = 0;
+    vga_filled_rect(0, 0, VGA_SCREEN_WIDTH - 1, VGA_SCREEN_HEIGHT - 1, 0);
+    start = clock();
+    for (i = 0; i < 50; i++) {
+        vga_flood_fill(VGA_SCREEN_WIDTH / 2, VGA_SCREEN_HEIGHT / 2, (i & 1) ? 0 : 1, 0, 0);
+    }
+    secs = (float)(clock() - start) / CLOCKS_PER_SEC;
+    if (secs > 0) {
+        *fills = 50 / secs;
+    }
+}
+
+/**
+ * @brief draw a frame of the animation used by the FLC benchmarks, a rectangle moving to the right.
+ *
+ * @param i number of the frame.
+ */
+void draw_flc_frame(int i) {
+    vga_filled_rect(i * 4, 50, i * 4 + 39, 89, 0);
+    vga_filled_rect(i * 4 + 4, 50, i * 4 + 43, 89, 1 + i);
+}
+
+/**
+ * @brief measure the cost of recording an animation with a moving rectangle into an FLC file.
+ *
+ * @param plain receives frames/s without recording.
+ * @param recorded receives frames/s while recording.
+ * @param bytes receives the average size of a recorded frame.
+ */
+void benchmark_flc(float *plain, float *recorded, float *bytes) {
+    int i, pass;
+    float secs;
+    clock_t start;
+    flc_t *flc = NULL;
+    uint32_t total = 0;
+
+    *plain = *recorded = *bytes = 0;
+    for (pass = 0; pass < 2; pass++) {
+        if (pass) {
+            flc = flc_open("BENCH.FLC", 70);
+            if (!flc) {
+                break;
+            }
+        }
+        start = clock();
+        for (i = 0; i < 50; i++) {
+            if (!vga_begin_frame()) {
+                break;
+            }
+            draw_flc_frame(i);
+            if (flc) {
+                flc_frame(flc);
+                total += flc_last_size;
+            }
+            vga_present();
+        }
+        secs = (float)(clock() - start) / CLOCKS_PER_SEC;
+        if (secs > 0) {
+            *(pass ? recorded : plain) = 50 / secs;
+        }
+    }
+    if (flc) {
+        flc_close(flc);
+        remove("BENCH.FLC");
+        *bytes = total / 50.0f;
+    }
+    vga_release_back_buffer();
+}
+
+/**
+ * @brief record the animation of benchmark_flc() in memory and measure how fast it can be decoded into memory.
+ * A bitmap stands in for VGA memory, so no VGA mode is needed.
+ *
+ * @param frames receives frames/s.
+ */
+void benchmark_flc_play(float *frames) {
+    int i;
+    float secs;
+    clock_t start;
+    bitmap_t *bm;
+    surface_t s;
+    flc_t *flc;
+    flc_player_t *p;
+    uint8_t *screen = VGA_MEMORY;
+    bool ok;
+
+    *frames = 0;
+    bm = bitmap_create(VGA_SCREEN_WIDTH, VGA_SCREEN_HEIGHT, 0);
+    if (!bm) {
+        return;
+    }
+
+    flc = flc_open("BENCH.FLC", 70);
+    if (!flc) {
+        bitmap_free(bm);
+        return;
+    }
+    VGA_MEMORY = bm->data;
+    for (i = 0; (i < 50) && vga_begin_frame(); i++) {
+        draw_flc_frame(i);
+        flc_frame(flc);
+        vga_present();
+    }
+    vga_release_back_buffer();
+    VGA_MEMORY = screen;
+    ok = flc_close(flc);
+
+    p = ok ? flc_play_open("BENCH.FLC") : NULL;
+    if (p) {
+        bitmap_get_surface(bm, &s);
+        start = clock();
+        for (i = 0; (i < 200) && flc_play_frame(p, &s); i++) {
+        }
+        secs = (float)(clock() - start) / CLOCKS_PER_SEC;
+        if (secs > 0) {
+            *frames = i / secs;
+        }
+        flc_play_close(p);
+    }
+    remove("BENCH.FLC");
+    bitmap_free(bm);
+}
+
+/**
+ * @brief save a generated image as PCX and measure how fast it can be decoded into memory. No VGA mode is needed.
+ *
+ * @param pixels receives decoded Mpixel/s.
+ */
+void benchmark_pcx(float *pixels) {
+    int i;
+    uint16_t x, y;
+    float secs;
+    clock_t start;
+    bitmap_t *bm;
+    surface_t s;
+    bool ok;
+
+    *pixels = 0;
+    bm = bitmap_create(VGA_SCREEN_WIDTH, VGA_SCREEN_HEIGHT, VGA_MAX_COLORS);
+    if (!bm) {
+        return;
+    }
+    for (i = 0; i < VGA_MAX_COLORS; i++) {
+        bm->palette[i].red = i;
+        bm->palette[i].green = 255 - i;
+        bm->palette[i].blue = i / 2;
+    }
+
+    // flat areas for runs and a band of noise for literal bytes
+    bitmap_get_surface(bm, &s);
+    for (i = 0; i < 20; i++) {
+        vga_surface_filled_circle(&s, (i * 37) % VGA_SCREEN_WIDTH, (i * 23) % 150, 10 + i * 2, 1 + i);
+    }
+    for (y = 150; y < VGA_SCREEN_HEIGHT; y++) {
+        for (x = 0; x < VGA_SCREEN_WIDTH; x++) {
+            bm->data[y * VGA_SCREEN_WIDTH + x] = rand();
+        }
+    }
+    ok = bitmap_save_pcx(bm, "BENCH.PCX");
+    bitmap_free(bm);
+
+    if (ok) {
+        start = clock();
+        for (i = 0; i < 20; i++) {
+            bm = bitmap_load_pcx("BENCH.PCX", true);
+            if (!bm) {
+                break;
+            }
+            bitmap_free(bm);
+        }
+        secs = (float)(clock() - start) / CLOCKS_PER_SEC;
+        if (secs > 0) {
+            *pixels = (float)i * VGA_SCREEN_WIDTH * VGA_SCREEN_HEIGHT / secs / 1000000.0f;
+        }
+    }
+    remove("BENCH.PCX");
+}
+
 int main(int argc, char *argv[]) {
     bool send = false;
     ipx_data_t data;
@@ -62,6 +696,11 @@ int main(int argc, char *argv[]) {
     char *fname;
 
     int i, x, y;
+    float bench_rect, bench_circle, bench_blit, bench_rect_base, bench_circle_base, bench_blit_base, bench_tiles, bench_tris_ram, bench_tpix_ram, bench_tris_vga, bench_tpix_vga, bench_chart, bench_fill, bench_frames, bench_flc, bench_flc_bytes, bench_flc_play, bench_pcx, bench_poly, bench_poly_lines;
+    uint16_t bench_tiles_full;
+    uint32_t bench_scroll_right, bench_scroll_down;
+    float bench_scroll;
+    surface_t ram;
     vertex_t v[3] = {{100, 10}, {120, 30}, {90, 30}};
 
     rawdisk_t *rd;
@@ -190,6 +829,14 @@ int main(int argc, char *argv[]) {
         printf("Mouse NOT available: %s\n", err_str);
     }
 
+    printf("ellipse_check %u of 7970 radius pairs with missing or split scanlines\n", check_ellipses());
+    printf("pcx_check     %u wrong pixels\n", check_pcx());
+
+    benchmark_flc_play(&bench_flc_play);
+    printf("flc_play      %.1f frames/s decoded to memory\n", bench_flc_play);
+    benchmark_pcx(&bench_pcx);
+    printf("load_pcx      %.2f Mpixel/s decoded to memory\n", bench_pcx);
+
     if (vga_init()) {
         for (x = 10; x < 40; x += 2) {
             for (y = 10; y < 40; y += 2) {
@@ -219,14 +866,41 @@ int main(int argc, char *argv[]) {
         draw("3DFX.BMP");
 
         fname = "OUT.BMP";
-        bm = bitmap_copy(0, 0, VGA_SCREEN_WIDTH, VGA_SCREEN_HEIGHT, true);
-        if (!bitmap_save(bm, fname)) {
+        if (!bitmap_save_screen(fname, 0, 0, VGA_SCREEN_WIDTH, VGA_SCREEN_HEIGHT, false)) {
             printf("Could not save %s: %s\n", fname, err_str);
         }
-        bitmap_free(bm);
-        bm = NULL;
+
+        benchmark(&bench_rect, &bench_circle, &bench_blit, &bench_rect_base, &bench_circle_base, &bench_blit_base);
+        benchmark_tilemap(&bench_tiles_full, &bench_tiles);
+        benchmark_texture(vga_screen(), &bench_tris_vga, &bench_tpix_vga);
+        benchmark_chart(&bench_chart);
+        benchmark_fill(&bench_fill);
+        benchmark_flc(&bench_frames, &bench_flc, &bench_flc_bytes);
+        bench_tris_ram = bench_tpix_ram = bench_poly = bench_poly_lines = 0;
+        bm = bitmap_create(VGA_SCREEN_WIDTH, VGA_SCREEN_HEIGHT, 0);
+        if (bm) {
+            bitmap_get_surface(bm, &ram);
+            benchmark_texture(&ram, &bench_tris_ram, &bench_tpix_ram);
+            benchmark_polygon(&ram, &bench_poly, &bench_poly_lines);
+            bitmap_free(bm);
+            bm = NULL;
+        }
+        benchmark_scroll(&bench_scroll_right, &bench_scroll_down, &bench_scroll);
 
         vga_exit();
+
+        printf("filled_rect   %.2f Mpixel/s, before %.2f Mpixel/s (memset)\n", bench_rect, bench_rect_base);
+        printf("filled_circle %.2f Mpixel/s, before %.2f Mpixel/s (byte loop)\n", bench_circle, bench_circle_base);
+        printf("bitmap_draw   %.2f Mpixel/s, before %.2f Mpixel/s (memcpy)\n", bench_blit, bench_blit_base);
+        printf("tilemap_draw  %u tiles full, %.1f tiles/frame incremental\n", bench_tiles_full, bench_tiles);
+        printf("tex RAM       %.0f triangles/s, %.2f Mpixel/s\n", bench_tris_ram, bench_tpix_ram / 1000000.0f);
+        printf("tex VGA       %.0f triangles/s, %.2f Mpixel/s\n", bench_tris_vga, bench_tpix_vga / 1000000.0f);
+        printf("filled_poly   %.1f triangles/s, %.1f triangles/s with vga_line() (290x180 in RAM)\n", bench_poly, bench_poly_lines);
+        printf("scroll_by     %lu pixels drawn per step right, %lu per step down (instead of %lu), %.1f steps/s\n", bench_scroll_right, bench_scroll_down,
+               (uint32_t)VGA_SCREEN_WIDTH * MODEX_HEIGHT_240, bench_scroll);
+        printf("aa_polyline   %.1f charts/s (300 segments)\n", bench_chart);
+        printf("flood_fill    %.1f full screen fills/s\n", bench_fill);
+        printf("flc_frame     %.1f frames/s, %.1f frames/s recorded, %.0f bytes/frame\n", bench_frames, bench_flc, bench_flc_bytes);
     } else {
         printf("VGA is not supported:%s", err_str);
     }
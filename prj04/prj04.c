@@ -26,10 +26,13 @@
         lua_setglobal(L, n);   \
     }
 
+#define L_DL_SIZE 1000  //!< max number of commands in the display list
+
 /* ======================================================================
 ** local variables
 ** ====================================================================== */
 static mouse_t *l_mouse = NULL;
+static dlist_t *l_dl = NULL;
 
 /* ======================================================================
 ** private functions
@@ -73,6 +76,17 @@ static int pos_int_noop(lua_State *L, int arg, unsigned int max) {
     return i;
 }
 
+static int16_t coord(lua_State *L, int arg) {
+    lua_Integer i = (lua_Integer)luaL_checknumber(L, arg);
+    if (i < INT16_MIN) {
+        return INT16_MIN;
+    }
+    if (i > INT16_MAX) {
+        return INT16_MAX;
+    }
+    return (int16_t)i;
+}
+
 static int l_sleep(lua_State *L) {
     int i = luaL_checkinteger(L, 1);
     if (i < 0) {
@@ -143,11 +157,8 @@ static int l_vga_set_color(lua_State *L) {
 
 static int l_vga_set_pixel(lua_State *L) {
     UNUSED(L);
-    int x = pos_int_noop(L, 1, VGA_SCREEN_WIDTH);
-    int y = pos_int_noop(L, 2, VGA_SCREEN_HEIGHT);
-    if (x == -1 || y == -1) {
-        return 0;
-    }
+    int16_t x = coord(L, 1);
+    int16_t y = coord(L, 2);
     int idx = pos_int(L, 3, VGA_MAX_COLORS, "color index");
 
     vga_set_pixel(x, y, idx);
@@ -170,13 +181,10 @@ static int l_vga_get_pixel(lua_State *L) {
 
 static int l_vga_line(lua_State *L) {
     UNUSED(L);
-    int x1 = pos_int_noop(L, 1, VGA_SCREEN_WIDTH);
-    int y1 = pos_int_noop(L, 2, VGA_SCREEN_HEIGHT);
-    int x2 = pos_int_noop(L, 3, VGA_SCREEN_WIDTH);
-    int y2 = pos_int_noop(L, 4, VGA_SCREEN_HEIGHT);
-    if (x1 == -1 || y1 == -1 || x2 == -1 || y2 == -1) {
-        return 0;
-    }
+    int16_t x1 = coord(L, 1);
+    int16_t y1 = coord(L, 2);
+    int16_t x2 = coord(L, 3);
+    int16_t y2 = coord(L, 4);
     int idx = pos_int(L, 5, VGA_MAX_COLORS, "color index");
 
     vga_line(x1, y1, x2, y2, idx);
@@ -186,13 +194,10 @@ static int l_vga_line(lua_State *L) {
 
 static int l_vga_rect(lua_State *L) {
     UNUSED(L);
-    int l = pos_int_noop(L, 1, VGA_SCREEN_WIDTH);
-    int t = pos_int_noop(L, 2, VGA_SCREEN_HEIGHT);
-    int r = pos_int_noop(L, 3, VGA_SCREEN_WIDTH);
-    int b = pos_int_noop(L, 4, VGA_SCREEN_HEIGHT);
-    if (l == -1 || t == -1 || r == -1 || b == -1) {
-        return 0;
-    }
+    int16_t l = coord(L, 1);
+    int16_t t = coord(L, 2);
+    int16_t r = coord(L, 3);
+    int16_t b = coord(L, 4);
     int idx = pos_int(L, 5, VGA_MAX_COLORS, "color index");
 
     vga_rect(l, t, r, b, idx);
@@ -202,13 +207,10 @@ static int l_vga_rect(lua_State *L) {
 
 static int l_vga_filled_rect(lua_State *L) {
     UNUSED(L);
-    int l = pos_int_noop(L, 1, VGA_SCREEN_WIDTH);
-    int t = pos_int_noop(L, 2, VGA_SCREEN_HEIGHT);
-    int r = pos_int_noop(L, 3, VGA_SCREEN_WIDTH);
-    int b = pos_int_noop(L, 4, VGA_SCREEN_HEIGHT);
-    if (l == -1 || t == -1 || r == -1 || b == -1) {
-        return 0;
-    }
+    int16_t l = coord(L, 1);
+    int16_t t = coord(L, 2);
+    int16_t r = coord(L, 3);
+    int16_t b = coord(L, 4);
     int idx = pos_int(L, 5, VGA_MAX_COLORS, "color index");
 
     vga_filled_rect(l, t, r, b, idx);
@@ -216,13 +218,22 @@ static int l_vga_filled_rect(lua_State *L) {
     return 0;
 }
 
+static int l_vga_set_clip(lua_State *L) {
+    UNUSED(L);
+    int16_t l = coord(L, 1);
+    int16_t t = coord(L, 2);
+    int16_t r = coord(L, 3);
+    int16_t b = coord(L, 4);
+
+    vga_set_clip(l, t, r, b);
+
+    return 0;
+}
+
 static int l_vga_circle(lua_State *L) {
     UNUSED(L);
-    int x = pos_int_noop(L, 1, VGA_SCREEN_WIDTH);
-    int y = pos_int_noop(L, 2, VGA_SCREEN_HEIGHT);
-    if (x == -1 || y == -1) {
-        return 0;
-    }
+    int16_t x = coord(L, 1);
+    int16_t y = coord(L, 2);
     int r = pos_int(L, 3, VGA_SCREEN_WIDTH, "radius");
     int idx = pos_int(L, 4, VGA_MAX_COLORS, "color index");
 
@@ -233,11 +244,8 @@ static int l_vga_circle(lua_State *L) {
 
 static int l_vga_filled_circle(lua_State *L) {
     UNUSED(L);
-    int x = pos_int_noop(L, 1, VGA_SCREEN_WIDTH);
-    int y = pos_int_noop(L, 2, VGA_SCREEN_HEIGHT);
-    if (x == -1 || y == -1) {
-        return 0;
-    }
+    int16_t x = coord(L, 1);
+    int16_t y = coord(L, 2);
     int r = pos_int(L, 3, VGA_SCREEN_WIDTH, "radius");
     int idx = pos_int(L, 4, VGA_MAX_COLORS, "color index");
 
@@ -286,6 +294,80 @@ static int l_mouse_update(lua_State *L) {
     return 1;
 }
 
+static int l_dl_clear(lua_State *L) {
+    UNUSED(L);
+    dl_clear(l_dl);
+    return 0;
+}
+
+static int l_dl_pixel(lua_State *L) {
+    int16_t x = coord(L, 1);
+    int16_t y = coord(L, 2);
+    int idx = pos_int(L, 3, VGA_MAX_COLORS, "color index");
+
+    lua_pushboolean(L, dl_pixel(l_dl, x, y, idx));
+    return 1;
+}
+
+static int l_dl_line(lua_State *L) {
+    int16_t x1 = coord(L, 1);
+    int16_t y1 = coord(L, 2);
+    int16_t x2 = coord(L, 3);
+    int16_t y2 = coord(L, 4);
+    int idx = pos_int(L, 5, VGA_MAX_COLORS, "color index");
+
+    lua_pushboolean(L, dl_line(l_dl, x1, y1, x2, y2, idx));
+    return 1;
+}
+
+static int l_dl_rect(lua_State *L) {
+    int16_t l = coord(L, 1);
+    int16_t t = coord(L, 2);
+    int16_t r = coord(L, 3);
+    int16_t b = coord(L, 4);
+    int idx = pos_int(L, 5, VGA_MAX_COLORS, "color index");
+
+    lua_pushboolean(L, dl_rect(l_dl, l, t, r, b, idx));
+    return 1;
+}
+
+static int l_dl_filled_rect(lua_State *L) {
+    int16_t l = coord(L, 1);
+    int16_t t = coord(L, 2);
+    int16_t r = coord(L, 3);
+    int16_t b = coord(L, 4);
+    int idx = pos_int(L, 5, VGA_MAX_COLORS, "color index");
+
+    lua_pushboolean(L, dl_filled_rect(l_dl, l, t, r, b, idx));
+    return 1;
+}
+
+static int l_dl_circle(lua_State *L) {
+    int16_t x = coord(L, 1);
+    int16_t y = coord(L, 2);
+    int r = pos_int(L, 3, VGA_SCREEN_WIDTH, "radius");
+    int idx = pos_int(L, 4, VGA_MAX_COLORS, "color index");
+
+    lua_pushboolean(L, dl_circle(l_dl, x, y, r, idx));
+    return 1;
+}
+
+static int l_dl_filled_circle(lua_State *L) {
+    int16_t x = coord(L, 1);
+    int16_t y = coord(L, 2);
+    int r = pos_int(L, 3, VGA_SCREEN_WIDTH, "radius");
+    int idx = pos_int(L, 4, VGA_MAX_COLORS, "color index");
+
+    lua_pushboolean(L, dl_filled_circle(l_dl, x, y, r, idx));
+    return 1;
+}
+
+static int l_dl_submit(lua_State *L) {
+    UNUSED(L);
+    dl_submit(l_dl, vga_screen());
+    return 0;
+}
+
 /* ======================================================================
 ** public functions
 ** ====================================================================== */
@@ -299,6 +381,11 @@ int main(int argc, char *argv[]) {
     }
     const char *filename = argv[1];
 
+    l_dl = dl_create(L_DL_SIZE, 0);
+    if (!l_dl) {
+        error(L, "cannot create display list: %s", err_str);
+    }
+
     NIVAR(VGA_MAX_COLORS, "num_colors");
     NIVAR(VGA_SCREEN_WIDTH, "width");
     NIVAR(VGA_SCREEN_HEIGHT, "height");
@@ -315,6 +402,7 @@ int main(int argc, char *argv[]) {
     NFUNC(l_vga_line, "vga_line");
     NFUNC(l_vga_rect, "vga_rect");
     NFUNC(l_vga_filled_rect, "vga_filled_rect");
+    NFUNC(l_vga_set_clip, "vga_set_clip");
     NFUNC(l_vga_circle, "vga_circle");
     NFUNC(l_vga_filled_circle, "vga_filled_circle");
     NFUNC(l_vga_hide_mouse, "vga_hide_mouse");
@@ -322,6 +410,14 @@ int main(int argc, char *argv[]) {
     NFUNC(l_vga_wait_for_retrace, "vga_wait_for_retrace");
     NFUNC(l_mouse_init, "mouse_init");
     NFUNC(l_mouse_update, "mouse_update");
+    NFUNC(l_dl_clear, "dl_clear");
+    NFUNC(l_dl_pixel, "dl_pixel");
+    NFUNC(l_dl_line, "dl_line");
+    NFUNC(l_dl_rect, "dl_rect");
+    NFUNC(l_dl_filled_rect, "dl_filled_rect");
+    NFUNC(l_dl_circle, "dl_circle");
+    NFUNC(l_dl_filled_circle, "dl_filled_circle");
+    NFUNC(l_dl_submit, "dl_submit");
 
     // NFUNC(l_, "");
 
@@ -330,6 +426,7 @@ int main(int argc, char *argv[]) {
     }
 
     vga_exit();
+    dl_free(l_dl);
     lua_close(L);
     exit(EXIT_SUCCESS);
 }
@@ -18,6 +18,13 @@ vga_filled_rect(100, 100, 150, 150, 3);
 vga_circle(200, 100, 20, 4);
 vga_filled_circle(250, 150, 30, 5);
 
+-- record once, draw with a single call
+dl_clear()
+for i = 0, 9 do
+	dl_filled_circle(20 + i * 30, 185, 10, 16 + i)
+end
+dl_submit()
+
 for x = 0, 1000 do
 	k = getkey()
 	if k == 27 then